@@ -32,12 +32,15 @@ extern "C" {
 
 /* USER CODE END Includes */
 
+extern TIM_HandleTypeDef htim2;
+
 extern TIM_HandleTypeDef htim14;
 
 /* USER CODE BEGIN Private defines */
 
 /* USER CODE END Private defines */
 
+void MX_TIM2_Init(void);
 void MX_TIM14_Init(void);
 
 /* USER CODE BEGIN Prototypes */
@@ -10,29 +10,79 @@
 #include "gpio.h"
 #include "tim.h"
 #include "main.h"
+#include "Timing/CycleCounter.h"
+#include "Timing/Timebase.h"
+#include "CanBusLoadCalculator/CanFrameBits.h"
+#include "ProtocolFormatter/DigitEmitter.h"
 #include <cstdarg>
 
-static void usbSendCallback(CanMessage_t& msg, uint32_t data_size);
+static uint16_t usbFormatCallback(const CanMessage_t& msg, uint8_t* out, uint16_t out_size);
+static uint16_t usbFlushCallback(uint8_t* out, uint16_t out_size);
+static uint8_t* usbReserveCallback(uint16_t length);
+static void usbCommitCallback(uint16_t length);
+static void usbWriteCallback(const uint8_t* data, uint16_t length);
 static void canStartCallback(void);
 static void canStopCallback(void);
 static void canInfoCallback(void);
+static void canStatsCallback(void);
+static void canBatchCallback(uint16_t max_frames, uint32_t budget_us);
+static void canBenchCallback(void);
+static void benchCapturePipeline(uint16_t iterations);
 static void filterAddCallback(uint32_t id, uint32_t mask, FilterType type);
 static void filterDeleteCallback(uint32_t id, bool delete_all);
 static void filterListCallback(void);
+static void filterLoadCallback(FilterLoadPhase phase);
+static void swFilterAddCallback(SwRuleKind kind, uint32_t first, uint32_t second, FilterType type);
+static void swFilterDeleteCallback(uint16_t index, bool delete_all);
+static void swFilterListCallback(void);
 static void writeCallback(uint32_t id, uint8_t* data, uint8_t dlc);
 static void writeSequenceCallback(uint32_t id, uint8_t* data, uint8_t dlc,
-        uint32_t count, uint32_t interval_ms);
+        uint32_t count, uint32_t interval_us);
+static void seqListCallback(void);
+static void seqStopCallback(uint32_t id, bool stop_all);
+static void seqDataCallback(uint32_t id, uint8_t* data, uint8_t dlc);
+static void replayStatusCallback(void);
+static void replayStopCallback(void);
+static void traceAddCallback(uint32_t delta_us, uint32_t id, uint8_t* data, uint8_t dlc);
+static void traceControlCallback(TraceAction action, uint32_t loops, uint16_t speed_percent);
+static void traceReportStep(void);
+static void seqListStep(void);
 static void readRawCallback(void);
 static void readParsedCallback(void);
+static void readBinaryCallback(void);
+static void readColorCallback(bool enable);
+static void readChangesCallback(uint32_t interval_ms);
+static void changesRefreshStep(uint32_t current_time_ms);
 static void errorCallback(const char *error_msg);
 static void handleBusLoadMonitor(bool enable);
 static void handleBusLoadStatus(void);
-static void canSendCallback(uint32_t id, bool is_extended, bool is_remote, uint8_t* data, uint8_t dlc);
-static bool configureFilterCallback(uint8_t bank, uint8_t slot,
-                                   uint32_t id, uint32_t mask,
-                                   bool is_extended);
-static bool disableFilterCallback(uint8_t bank, uint8_t slot);
-static void disableAllFiltersCallback();
+static void statsCallback(uint16_t limit);
+static void statsResetCallback(void);
+static void statsDumpStep(void);
+static bool canSendCallback(uint32_t id, bool is_extended, bool is_remote, uint8_t* data, uint8_t dlc);
+static ReplayPlayer::SendResult replaySendCallback(uint32_t id, bool is_extended, bool is_remote,
+		const uint8_t* data, uint8_t dlc);
+static TracePlayer::SendResult traceSendCallback(uint32_t id, bool is_extended, bool is_remote,
+		const uint8_t* data, uint8_t dlc);
+static bool applyFilterPlanCallback(const FilterBankPlanner::Plan& plan);
+static bool binaryFrameCallback(const uint8_t* frame, uint16_t length);
+static BinaryProtocol::Status binSendCallback(uint32_t id, bool is_extended, bool is_remote,
+		const uint8_t* data, uint8_t dlc);
+static BinaryProtocol::Status binCanControlCallback(bool start);
+static BinaryProtocol::Status binSeqStartCallback(uint32_t id, const uint8_t* data, uint8_t dlc,
+		uint32_t count, uint32_t interval_us);
+static BinaryProtocol::Status binSeqStopCallback(uint32_t id, bool stop_all);
+static BinaryProtocol::Status binSeqDataCallback(uint32_t id, const uint8_t* data, uint8_t dlc);
+static BinaryProtocol::Status binFilterAddCallback(uint32_t id, uint32_t mask, bool is_extended);
+static BinaryProtocol::Status binFilterDelCallback(uint32_t id, bool delete_all);
+static BinaryProtocol::Status binStreamControlCallback(BinaryProtocol::StreamAction action, uint16_t prebuffer);
+static uint32_t binStreamSpaceCallback(void);
+static BinaryProtocol::Status binStreamPushCallback(uint32_t delta_us, uint32_t id, bool is_extended,
+		bool is_remote, const uint8_t* data, uint8_t dlc);
+static BinaryProtocol::Status binTraceAddCallback(uint32_t delta_us, uint32_t id, bool is_extended,
+		bool is_remote, const uint8_t* data, uint8_t dlc);
+static BinaryProtocol::Status binTraceClearCallback(void);
+static uint32_t binTraceSpaceCallback(void);
 static void usbPrint(const char* format, ...);
 
 static void debugPrintInternal(const char* format, ...);
@@ -51,37 +101,82 @@ void appLoop(void){
 System::System(){
 	timersInit();
 
+	usb_tx = new UsbTxStream(CDC_Transmit_FS);
+
 	protocol_formatter = new ProtocolFormatter(ProtocolFormatter::Format::Raw);
 
-	bus_monitor = new CanBusMonitor();
+	text_formatter = new TextFrameFormatter(TextFrameFormatter::Layout::Raw);
+
+	bus_monitor = new CanBusMonitor(usbWriteCallback);
+
+	led = new Led(LED_CAN_GPIO_Port, LED_CAN_Pin, LED_USB_GPIO_Port, LED_USB_Pin);
+
+	id_stats = new IdStatsTable();
 
-	can_processor = new CanProcessor(usbSendCallback, &can_msg_queue, bus_monitor, led);
+	soft_filter = new SoftwareFilter();
 
-	command_handler = new CommandHandler(&command_queue);
+	can_processor = new CanProcessor(usbFormatCallback, usbFlushCallback,
+									 usbReserveCallback, usbCommitCallback,
+									 &can_msg_queue, bus_monitor, id_stats, soft_filter, led);
+
+	binary_protocol = new BinaryProtocol(binSendCallback,
+										 binCanControlCallback,
+										 binSeqStartCallback,
+										 binSeqStopCallback,
+										 binSeqDataCallback,
+										 binFilterAddCallback,
+										 binFilterDelCallback,
+										 binStreamControlCallback,
+										 binStreamSpaceCallback,
+										 binStreamPushCallback,
+										 binTraceAddCallback,
+										 binTraceClearCallback,
+										 binTraceSpaceCallback,
+										 usbWriteCallback);
+
+	command_handler = new CommandHandler(&command_queue, binaryFrameCallback);
 
 	command_processor = new CommandProcessor(&command_queue,
 											canStartCallback,
 											canStopCallback,
 											canInfoCallback,
+											canStatsCallback,
+											canBatchCallback,
+											canBenchCallback,
 											filterAddCallback,
 											filterDeleteCallback,
 											filterListCallback,
+											filterLoadCallback,
+											swFilterAddCallback,
+											swFilterDeleteCallback,
+											swFilterListCallback,
 											writeCallback,
 											writeSequenceCallback,
+											seqListCallback,
+											seqStopCallback,
+											seqDataCallback,
+											replayStatusCallback,
+											replayStopCallback,
+											traceAddCallback,
+											traceControlCallback,
 											readRawCallback,
 											readParsedCallback,
+											readBinaryCallback,
+											readColorCallback,
+											readChangesCallback,
 											errorCallback,
 											handleBusLoadMonitor,
-											handleBusLoadStatus);
+											handleBusLoadStatus,
+											statsCallback,
+											statsResetCallback);
 
 	seq_manager = new SequenceManager(canSendCallback);
 
-	filter_manager = new FilterManager(usbPrint,
-										configureFilterCallback,
-										disableFilterCallback,
-										disableAllFiltersCallback);
+	replay_player = new ReplayPlayer(replaySendCallback);
 
-	led = new Led(LED_CAN_GPIO_Port, LED_CAN_Pin, LED_USB_GPIO_Port, LED_USB_Pin);
+	trace_player = new TracePlayer(traceSendCallback);
+
+	filter_manager = new FilterManager(usbPrint, applyFilterPlanCallback);
 
 	CanDriver::Status can_status;
 
@@ -105,21 +200,43 @@ System::System(){
 void System::loop(){
 	uint32_t current_time = HAL_GetTick();
 
+	// Не дает пропустить переполнение 32-битного счетчика при тихой шине
+	Timebase::update();
+
 	if (bus_monitor && state.timer_100ms_ready){
 		bus_monitor->update(current_time);
 		state.timer_100ms_ready = false;
 	}
 
-	seq_manager->update(current_time);
-
 	led->update(current_time);
 
+	// Строки, принятые прерыванием USB, разбираются здесь порциями
+	command_handler->poll();
+	CDC_ResumeReceive_FS();
+
 	command_processor->processCommand();
 
-	can_processor->processMessage();
+	can_processor->processBatch();
+
+	statsDumpStep();
+
+	seqListStep();
+
+	traceReportStep();
+
+	changesRefreshStep(current_time);
+
+	// Досылаем хвост, если предыдущая попытка передачи не удалась
+	usb_tx->flush();
 }
 
 void System::timersInit(){
+	// Счетчик тактов для бюджета времени и замеров
+	CycleCounter::init();
+
+	// Микросекундные метки времени кадров
+	Timebase::init();
+
 	// 100 ms timer
 	if (HAL_TIM_Base_Start_IT(&htim14) != HAL_OK){
 		debugPrintInternal("Timer14 dont started.\n\r");
@@ -127,92 +244,47 @@ void System::timersInit(){
 	 state.timer_100ms_ready = false;
 }
 
-void usbSendCallback(CanMessage_t& msg, uint32_t data_size){
-    char buffer[256];
-    int len = 0;
-
-    // Очищаем буфер
-    memset(buffer, 0, sizeof(buffer));
-
-    const char* color_start = "";
-    const char* color_end = "";
-
-	if (msg.header.RTR == CAN_RTR_REMOTE)
-		color_start = COLOR_YELLOW;  // RTR запросы - желтые
-	else if (msg.header.IDE == CAN_ID_STD)
-		color_start = COLOR_GREEN;   // Стандартные ID - зеленые
-	else
-		color_start = COLOR_CYAN;    // Расширенные ID - голубые
-
-	color_end = COLOR_RESET;
+uint16_t usbFormatCallback(const CanMessage_t& msg, uint8_t* out, uint16_t out_size){
+    // Бинарный поток копит кадры в пакеты внутри форматтера
+    if (sys->state.output_mode == System::OUTPUT_BINARY) {
+        if (out == nullptr) {
+            return sys->protocol_formatter->hold(msg);
+        }
+        return sys->protocol_formatter->format(msg, out, out_size);
+    }
 
-    switch (sys->state.parsing) {
-        case false: {
-			len = snprintf(buffer, sizeof(buffer), "%s%08lu%s ", color_start, msg.timestamp_ms, color_end);
+    // Текст пишется прямо в зарезервированный участок кольца передачи
+    if (out == nullptr) {
+        return TextFrameFormatter::MAX_LINE_SIZE;
+    }
+    return sys->text_formatter->format(msg, out, out_size);
+}
 
-            len += snprintf(buffer + len, sizeof(buffer) - len,
-                          "%s%c%s %03lX [%d] ",
-                          color_start,
-                          (msg.header.RTR == CAN_RTR_REMOTE) ? 'R' : 'T',
-                          color_end,
-                          (msg.header.IDE == CAN_ID_STD) ? msg.header.StdId : msg.header.ExtId,
-                          msg.header.DLC);
+uint16_t usbFlushCallback(uint8_t* out, uint16_t out_size){
+	// Конец прохода: незаполненный бинарный пакет уходит сразу
+	if (sys->state.output_mode != System::OUTPUT_BINARY) {
+		return 0;
+	}
 
-            for (uint8_t i = 0; i < msg.header.DLC; i++) {
-                len += snprintf(buffer + len, sizeof(buffer) - len,
-                              "%02X ", msg.data[i]);
-            }
+	if (out == nullptr) {
+		return sys->protocol_formatter->pendingBatchSize();
+	}
 
-            for (uint8_t i = msg.header.DLC; i < 8; i++) {
-                len += snprintf(buffer + len, sizeof(buffer) - len, "   ");
-            }
+	return sys->protocol_formatter->flushBatch(out, out_size);
+}
 
-            len += snprintf(buffer + len, sizeof(buffer) - len, "\r\n");
-            break;
-        }
+uint8_t* usbReserveCallback(uint16_t length){
+	return sys->usb_tx->reserve(length);
+}
 
-        case true: {
-            len = snprintf(buffer, sizeof(buffer),
-                          "\r\n%s=== CAN Message ===%s\r\n"
-                          "Timestamp: %lu ms\r\n"
-                          "ID:        %s0x%08lX%s (%s, %s)\r\n"
-                          "DLC:       %d bytes\r\n"
-                          "Data:      ",
-                          color_start, color_end,
-                          msg.timestamp_ms,
-                          color_start,
-                          (msg.header.IDE == CAN_ID_STD) ? msg.header.StdId : msg.header.ExtId,
-                          color_end,
-                          (msg.header.IDE == CAN_ID_STD) ? "STD" : "EXT",
-                          (msg.header.RTR == CAN_RTR_REMOTE) ? "RTR" : "DATA",
-                          msg.header.DLC);
-
-            for (uint8_t i = 0; i < msg.header.DLC; i++) {
-                len += snprintf(buffer + len, sizeof(buffer) - len,
-                              "%02X ", msg.data[i]);
-            }
-
-            len += snprintf(buffer + len, sizeof(buffer) - len,
-                          "\r\nASCII:    \"");
-
-            for (uint8_t i = 0; i < msg.header.DLC; i++) {
-                char c = msg.data[i];
-                if (c >= 32 && c <= 126) {
-                    len += snprintf(buffer + len, sizeof(buffer) - len, "%c", c);
-                } else {
-                    len += snprintf(buffer + len, sizeof(buffer) - len, ".");
-                }
-            }
-
-            len += snprintf(buffer + len, sizeof(buffer) - len, "\"\r\n");
-            break;
-        }
-    }
+void usbCommitCallback(uint16_t length){
+	// Передача стартует в System::loop() через usb_tx->flush()
+	sys->usb_tx->commit(length);
+}
 
-    // Отправляем через USB CDC
-    if (len > 0 && len < (int)sizeof(buffer)) {
-        CDC_Transmit_FS((uint8_t*)buffer, len);
-    }
+void usbWriteCallback(const uint8_t* data, uint16_t length){
+	// Данные уходят в кольцо передачи, USB забирает их по мере готовности
+	sys->usb_tx->write(data, length);
 }
 
 static void canStartCallback(void){
@@ -231,69 +303,324 @@ static void canStopCallback(void){
 	sys->led->indicateCanStarted(false);
 }
 
+// Разделы справки пишутся в кольцо передачи по одному: целиком текст
+// больше любого буфера на стеке
+static const char INFO_HEADER[] =
+		"\r\n"
+		"========================================\r\n"
+		"          CAN SNIFFER SYSTEM INFO       \r\n"
+		"========================================\r\n\r\n";
+
+static const char INFO_COMMANDS_CAN[] =
+		"AVAILABLE COMMANDS:\r\n"
+		"  can start       - Start CAN interface\r\n"
+		"  can stop        - Stop CAN interface\r\n"
+		"  can info        - This information\r\n"
+		"  can stats       - Runtime statistics\r\n"
+		"  can batch <frames> <budget_us> - RX batch config\r\n"
+		"  can bench       - Formatter cost per frame\r\n"
+		"  filter add <id> [mask] [type] - Add filter\r\n"
+		"  filter del <id|all> - Delete filter\r\n"
+		"  filter list     - List active filters\r\n"
+		"  filter load begin|end|abort - Bulk filter load\r\n"
+		"  filter sw add <id|lo-hi|id/mask> [type] - Software rule\r\n"
+		"  filter sw del <n|all> - Delete software rule\r\n"
+		"  filter sw list  - List software rules\r\n";
+
+static const char INFO_COMMANDS_TX[] =
+		"  write <id> <data> - Send CAN message\r\n"
+		"  write seq <id> <data> <count> <ms|Nus>\r\n"
+		"  seq list        - Running sequences and timing\r\n"
+		"  seq stop <id|all> - Stop sequence\r\n"
+		"  seq data <id> <data> - Update sequence payload\r\n"
+		"  replay status   - Host stream replay state\r\n"
+		"  replay stop     - Abort stream replay\r\n"
+		"  trace add <delta> <id> <data> - Append trace record\r\n"
+		"  trace clear     - Drop loaded trace\r\n"
+		"  trace play [loops] [speed%] - Play loaded trace\r\n"
+		"  trace pause|resume|stop|status - Trace control\r\n";
+
+static const char INFO_COMMANDS_RX[] =
+		"  read raw        - Raw message monitoring\r\n"
+		"  read parsed     - Parsed message monitoring\r\n"
+		"  read binary     - COBS-framed binary stream\r\n"
+		"  read changes [ms] - Changed bytes per ID\r\n"
+		"  read color on|off - ANSI colors in text output\r\n"
+		"  bus load on     - Start bus load monitoring\r\n"
+		"  bus load off    - Stop bus load monitoring\r\n"
+		"  bus load status - Show current bus load\r\n"
+		"  stats [top_n]   - Per-ID statistics by frame count\r\n"
+		"  stats reset     - Clear per-ID statistics\r\n\r\n";
+
+static const char INFO_FORMATS[] =
+		"DATA FORMATS:\r\n"
+		"  ID:            decimal or 0xhex (0x100)\r\n"
+		"  Data:          hex bytes (01 A2 FF or 01A2FF)\r\n"
+		"  Filter type:   std (11-bit) or ext (29-bit)\r\n"
+		"  Mask:          hex value (0x7F0 for range)\r\n\r\n";
+
+static const char INFO_EXAMPLES[] =
+		"EXAMPLES:\r\n"
+		"  can start\r\n"
+		"  filter add 0x100 0x7F0 std\r\n"
+		"  write 0x123 01 02 03 04\r\n"
+		"  write seq 0x200 AABB 10 100\r\n"
+		"  write seq 0x201 CC 0 500us\r\n"
+		"  trace play 3 200\r\n"
+		"  read raw\r\n\r\n";
+
+static const char INFO_SYSTEM[] =
+		"SYSTEM INFO:\r\n"
+		"  MCU:           STM32F407VET6\r\n"
+		"  Clock:         64 MHz\r\n"
+		"  Memory:        128 kB RAM, 512 kB Flash\r\n"
+		"  Version:       1.0.0\r\n"
+		"  Build date:    12.01.2026\r\n"
+		"========================================\r\n\r\n";
+
 static void canInfoCallback(void){
 	// TODO: добавить класс со вссеми состояниями сниффера
 
 	sys->led->flashOnCommand();
-	char buffer[2048];
-	int len = 0;
-
-    memset(buffer, 0, sizeof(buffer));
-
-    // ====== ЗАГОЛОВОК ======
-    len += snprintf(buffer + len, sizeof(buffer) - len,
-                   "\r\n"
-                   "========================================\r\n"
-                   "          CAN SNIFFER SYSTEM INFO       \r\n"
-                   "========================================\r\n\r\n");
-
-    // ====== ДОСТУПНЫЕ КОМАНДЫ ======
-    len += snprintf(buffer + len, sizeof(buffer) - len,
-                   "AVAILABLE COMMANDS:\r\n"
-                   "  can start       - Start CAN interface\r\n"
-                   "  can stop        - Stop CAN interface\r\n"
-                   "  can info        - This information\r\n"
-                   "  filter add <id> [mask] [type] - Add filter\r\n"
-                   "  filter del <id|all> - Delete filter\r\n"
-                   "  filter list     - List active filters\r\n"
-                   "  write <id> <data> - Send CAN message\r\n"
-                   "  write seq <id> <data> <count> <interval_ms>\r\n"
-                   "  read raw        - Raw message monitoring\r\n"
-				   "  read parsed     - Parsed message monitoring\r\n"
-				   "  bus load on     - Start bus load monitoring\r\n"
-				   "  bus load off    - Stop bus load monitoring\r\n"
-				   "  bus load status - Show current bus load\r\n\r\n");
-
-    // ====== ФОРМАТ ДАННЫХ ======
-    len += snprintf(buffer + len, sizeof(buffer) - len,
-                   "DATA FORMATS:\r\n"
-                   "  ID:            decimal or 0xhex (0x100)\r\n"
-                   "  Data:          hex bytes (01 A2 FF or 01A2FF)\r\n"
-                   "  Filter type:   std (11-bit) or ext (29-bit)\r\n"
-                   "  Mask:          hex value (0x7F0 for range)\r\n\r\n");
-
-    // ====== ПРИМЕРЫ ======
-    len += snprintf(buffer + len, sizeof(buffer) - len,
-                   "EXAMPLES:\r\n"
-                   "  can start\r\n"
-                   "  filter add 0x100 0x7F0 std\r\n"
-                   "  write 0x123 01 02 03 04\r\n"
-                   "  write seq 0x200 AABB 10 100\r\n"
-                   "  read raw\r\n\r\n");
-
-    // ====== СИСТЕМНАЯ ИНФОРМАЦИЯ ======
-    len += snprintf(buffer + len, sizeof(buffer) - len,
-                   "SYSTEM INFO:\r\n"
-                   "  MCU:           STM32F407VET6\r\n"
-                   "  Clock:         64 MHz\r\n"
-                   "  Memory:        128 kB RAM, 512 kB Flash\r\n"
-                   "  Version:       1.0.0\r\n"
-                   "  Build date:    12.01.2026\r\n");
-
-    len += snprintf(buffer + len, sizeof(buffer) - len,
-                   "========================================\r\n\r\n");
-
-	CDC_Transmit_FS((uint8_t*)buffer, len);
+
+	static const char* const sections[] = {
+		INFO_HEADER, INFO_COMMANDS_CAN, INFO_COMMANDS_TX, INFO_COMMANDS_RX,
+		INFO_FORMATS, INFO_EXAMPLES, INFO_SYSTEM
+	};
+
+	for (const char* section : sections) {
+		usbWriteCallback((const uint8_t*)section, (uint16_t)strlen(section));
+	}
+}
+
+static void canStatsCallback(void){
+	sys->led->flashOnCommand();
+
+	const CanProcessor::BatchConfig& batch = sys->can_processor->getBatchConfig();
+	const volatile CanDriver::RxStats& rx = sys->can_driver->getRxStats();
+	const IsrProfiler& rx_isr = sys->can_driver->getRxIsrProfile();
+	CanDriver::TxStats tx;
+	sys->can_driver->getTxStats(tx);
+	const IsrProfiler& usb_isr = sys->command_handler->getRxIsrProfile();
+
+	// Отчет больше буфера usbPrint - печатаем по разделам
+	usbPrint("\r\n=== CAN RX Statistics ===\r\n"
+			 "Frames/s:      %lu\r\n"
+			 "Processed:     %lu\r\n"
+			 "Errors:        %lu\r\n"
+			 "Max batch:     %lu frames\r\n"
+			 "Batch config:  %u frames, %lu us\r\n"
+			 "RX ring:       %lu/%lu, overflows %lu\r\n",
+			 sys->can_processor->getFramesPerSecond(),
+			 sys->can_processor->getProcessedCount(),
+			 sys->can_processor->getErrorCount(),
+			 sys->can_processor->getMaxBatchFrames(),
+			 batch.max_frames, batch.budget_us,
+			 sys->can_msg_queue.size(), CanMessageRing::CAPACITY,
+			 sys->can_msg_queue.getOverflowCount());
+
+	usbPrint("USB TX:        %lu/%lu bytes, peak %lu\r\n"
+			 "USB dropped:   %lu bytes, %lu overruns\r\n"
+			 "Output drops:  %lu frames\r\n",
+			 sys->usb_tx->getUsedSpace(), UsbTxStream::BUFFER_SIZE,
+			 sys->usb_tx->getStats().peak_usage,
+			 sys->usb_tx->getDroppedBytes(),
+			 sys->usb_tx->getOverrunCount(),
+			 sys->can_processor->getOutputDroppedCount());
+
+	usbPrint("FIFO0:         %lu frames, %lu full, %lu overruns\r\n"
+			 "FIFO1:         %lu frames, %lu full, %lu overruns\r\n"
+			 "RX ISR:        avg %lu, worst %lu cycles (%lu us), max drain %lu\r\n",
+			 rx.frames[CAN_RX_FIFO0], rx.full[CAN_RX_FIFO0], rx.overruns[CAN_RX_FIFO0],
+			 rx.frames[CAN_RX_FIFO1], rx.full[CAN_RX_FIFO1], rx.overruns[CAN_RX_FIFO1],
+			 rx_isr.getAverageCycles(), rx_isr.getWorstCycles(),
+			 CycleCounter::cyclesToMicros(rx_isr.getWorstCycles()), rx.max_drain);
+
+	usbPrint("TX queue:      %u/%u, peak %u\r\n"
+			 "TX frames:     %lu queued, %lu sent, %lu dropped, %lu failed\r\n"
+			 "TX latency:    avg %lu us, max %lu us\r\n",
+			 tx.depth, CanTxQueue::CAPACITY, tx.peak,
+			 tx.enqueued, tx.sent, tx.dropped, tx.failed,
+			 tx.latency_avg_us, tx.latency_max_us);
+
+	usbPrint("USB RX ISR:    avg %lu, worst %lu cycles (%lu us), %lu bytes dropped\r\n"
+			 "Binary cmds:   %lu requests, %lu NAK\r\n"
+			 "Sequences:     %u/%u active\r\n"
+			 "=========================\r\n",
+			 usb_isr.getAverageCycles(), usb_isr.getWorstCycles(),
+			 CycleCounter::cyclesToMicros(usb_isr.getWorstCycles()),
+			 sys->command_handler->getRxDroppedBytes(),
+			 sys->binary_protocol->getRequestCount(), sys->binary_protocol->getNakCount(),
+			 (unsigned)sys->seq_manager->getActiveCount(), SequenceManager::MAX_SEQUENCES);
+}
+
+static void canBatchCallback(uint16_t max_frames, uint32_t budget_us){
+	sys->led->flashOnCommand();
+
+	if (sys->can_processor->setBatchConfig(max_frames, budget_us)) {
+		usbPrint("OK: RX batch %u frames, budget %lu us\r\n", max_frames, budget_us);
+	} else {
+		usbPrint("ERROR: Batch size must be 1..%u\r\n", CanProcessor::MAX_BATCH_FRAMES);
+	}
+}
+
+static void canBenchCallback(void){
+	sys->led->flashOnCommand();
+
+	static const uint16_t ITERATIONS = 1000;
+	static const struct {
+		ProtocolFormatter::Format format;
+		const char* name;
+	} formats[] = {
+		{ ProtocolFormatter::Format::Raw,    "Raw"    },
+		{ ProtocolFormatter::Format::Cobs,   "Cobs"   },
+		{ ProtocolFormatter::Format::Ascii,  "Ascii"  },
+		{ ProtocolFormatter::Format::Binary, "Binary" },
+	};
+
+	// Худший случай: расширенный ID и 8 байт данных
+	CanMessage_t msg = {};
+	msg.timestamp_us = 12345678901ULL;
+	msg.header.IDE = CAN_ID_EXT;
+	msg.header.ExtId = 0x18DAF110;
+	msg.header.RTR = CAN_RTR_DATA;
+	msg.header.DLC = 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		msg.data[i] = 0x11 * (i + 1);
+	}
+
+	ProtocolFormatter formatter;
+	uint8_t out[256];
+
+	usbPrint("\r\n=== Formatter benchmark (%u frames) ===\r\n", ITERATIONS);
+
+	for (const auto& fmt : formats) {
+		formatter.setFormat(fmt.format);
+
+		uint32_t start = CycleCounter::now();
+		for (uint16_t i = 0; i < ITERATIONS; i++) {
+			msg.timestamp_us += 130;
+			formatter.format(msg, out, sizeof(out));
+		}
+		formatter.flushBatch(out, sizeof(out));
+		uint32_t cycles = CycleCounter::elapsed(start);
+
+		usbPrint("%-7s %5lu cycles/frame  %6lu ns/frame\r\n",
+				 fmt.name,
+				 cycles / ITERATIONS,
+				 (cycles / CycleCounter::cyclesPerMicro()) * 1000 / ITERATIONS);
+	}
+
+	// Текстовый вывод read raw / read parsed, с цветами и без
+	static const struct {
+		TextFrameFormatter::Layout layout;
+		bool colors;
+		const char* name;
+	} layouts[] = {
+		{ TextFrameFormatter::Layout::Raw,    true,  "TextRaw"  },
+		{ TextFrameFormatter::Layout::Raw,    false, "TextRaw-" },
+		{ TextFrameFormatter::Layout::Parsed, true,  "TextPrs"  },
+		{ TextFrameFormatter::Layout::Parsed, false, "TextPrs-" },
+	};
+
+	TextFrameFormatter text;
+
+	for (const auto& lay : layouts) {
+		text.setLayout(lay.layout);
+		text.setColors(lay.colors);
+
+		uint16_t length = 0;
+		uint32_t start = CycleCounter::now();
+		for (uint16_t i = 0; i < ITERATIONS; i++) {
+			msg.timestamp_us += 130;
+			length = text.format(msg, out, sizeof(out));
+		}
+		uint32_t cycles = CycleCounter::elapsed(start);
+
+		usbPrint("%-8s %4lu cycles/frame  %6lu ns/frame  %3u bytes\r\n",
+				 lay.name,
+				 cycles / ITERATIONS,
+				 (cycles / CycleCounter::cyclesPerMicro()) * 1000 / ITERATIONS,
+				 length);
+	}
+
+	// Точная длина кадра со стаффингом (считается для каждого кадра при bus load on)
+	uint32_t bits_sum = 0;
+	uint32_t start = CycleCounter::now();
+	for (uint16_t i = 0; i < ITERATIONS; i++) {
+		msg.data[0] = (uint8_t)i;
+		bits_sum += CanFrameBits::frameBits(true, msg.header.ExtId, false, msg.header.DLC, msg.data);
+	}
+	uint32_t cycles = CycleCounter::elapsed(start);
+
+	usbPrint("FrameBits %4lu cycles/frame  avg %lu bits\r\n",
+			 cycles / ITERATIONS, bits_sum / ITERATIONS);
+
+	benchCapturePipeline(ITERATIONS);
+}
+
+static void benchCapturePipeline(uint16_t iterations){
+	// Путь кадра от mailbox до буфера передачи. Регистры CAN подменены
+	// копией в RAM, поэтому тест не трогает шину и реальные очереди.
+	static CAN_TypeDef fake_can;
+	memset(&fake_can, 0, sizeof(fake_can));
+	fake_can.RF0R = 1;  // FMP0: в FIFO есть кадр
+	fake_can.sFIFOMailBox[0].RIR  = (0x18DAF110UL << CAN_RI0R_EXID_Pos) | CAN_RI0R_IDE;
+	fake_can.sFIFOMailBox[0].RDTR = 8;
+	fake_can.sFIFOMailBox[0].RDLR = 0x44332211;
+	fake_can.sFIFOMailBox[0].RDHR = 0x88776655;
+
+	CAN_HandleTypeDef fake_hcan = {};
+	fake_hcan.Instance = &fake_can;
+	fake_hcan.State = HAL_CAN_STATE_LISTENING;
+
+	TextFrameFormatter text(TextFrameFormatter::Layout::Raw, false);
+	uint8_t tx_region[TextFrameFormatter::MAX_LINE_SIZE];
+	uint64_t timestamp_us = 0;
+
+	// Было: HAL -> стек -> слот cQueue -> dequed -> msg_copy -> буфер форматтера -> USB
+	static uint8_t staging[TextFrameFormatter::MAX_LINE_SIZE];
+	Queue_t legacy_queue;
+	q_init(&legacy_queue, sizeof(CanMessage_t), 4, FIFO, false);
+
+	uint32_t start = CycleCounter::now();
+	for (uint16_t i = 0; i < iterations; i++) {
+		CanMessage_t rx;
+		HAL_CAN_GetRxMessage(&fake_hcan, CAN_RX_FIFO0, &rx.header, rx.data);
+		rx.timestamp_us = timestamp_us += 130;
+		q_push(&legacy_queue, &rx);
+
+		CanMessage_t dequed;
+		q_pop(&legacy_queue, &dequed);
+		CanMessage_t msg_copy;
+		memcpy(&msg_copy, &dequed, sizeof(msg_copy));
+
+		uint16_t length = text.format(msg_copy, staging, sizeof(staging));
+		memcpy(tx_region, staging, length);
+	}
+	uint32_t legacy_cycles = CycleCounter::elapsed(start);
+	q_kill(&legacy_queue);
+
+	// Сейчас: mailbox -> слот кольца (единственная копия) -> формат на месте
+	SpscRing<CanMessage_t, 4> ring;
+
+	start = CycleCounter::now();
+	for (uint16_t i = 0; i < iterations; i++) {
+		CanMessage_t* slot = ring.acquire();
+		CanDriver::readMailbox(fake_can.sFIFOMailBox[0], *slot);
+		slot->timestamp_us = timestamp_us += 130;
+		ring.commit();
+
+		CanMessage_t* msg = ring.peek();
+		text.format(*msg, tx_region, sizeof(tx_region));
+		ring.release();
+	}
+	uint32_t zero_copy_cycles = CycleCounter::elapsed(start);
+
+	usbPrint("Pipeline copy chain %4lu cycles/frame\r\n"
+			 "Pipeline zero-copy  %4lu cycles/frame\r\n",
+			 legacy_cycles / iterations,
+			 zero_copy_cycles / iterations);
 }
 
 static void filterAddCallback(uint32_t id, uint32_t mask, FilterType type) {
@@ -329,37 +656,382 @@ static void filterListCallback(void){
 	sys->filter_manager->printFilterList();
 }
 
+static void filterLoadCallback(FilterLoadPhase phase){
+	switch (phase) {
+		case FILTER_LOAD_BEGIN:
+			sys->led->flashOnCommand();
+			sys->filter_manager->beginLoad();
+			usbPrint("Filter load: send \"filter add\" lines, then \"filter load end\"\r\n");
+			break;
+		case FILTER_LOAD_END:
+			if (sys->filter_manager->commitLoad()) {
+				sys->led->flashOnCommand();
+			} else {
+				sys->led->indicateError(true);
+				usbPrint("ERROR: Filter load rejected, previous set kept\r\n");
+			}
+			break;
+		case FILTER_LOAD_ABORT:
+			sys->led->flashOnCommand();
+			sys->filter_manager->abortLoad();
+			usbPrint("Filter load aborted\r\n");
+			break;
+	}
+}
+
+static void swFilterAddCallback(SwRuleKind kind, uint32_t first, uint32_t second, FilterType type){
+	static const SoftwareFilter::RuleKind KINDS[] = {
+		SoftwareFilter::RuleKind::Id, SoftwareFilter::RuleKind::Range, SoftwareFilter::RuleKind::Mask
+	};
+
+	SoftwareFilter::Rule rule = { first, second, KINDS[kind], (type == FILTER_TYPE_EXT) };
+
+	switch (sys->soft_filter->addRule(rule)) {
+		case SoftwareFilter::Status::OK:
+			sys->led->flashOnCommand();
+			usbPrint("OK: SW rule %u added\r\n", sys->soft_filter->getRuleCount() - 1);
+			return;
+		case SoftwareFilter::Status::InvalidRule:
+			usbPrint("ERROR: Invalid SW rule\r\n");
+			break;
+		case SoftwareFilter::Status::RulesFull:
+			usbPrint("ERROR: SW rule limit reached (%u)\r\n", SoftwareFilter::MAX_RULES);
+			break;
+		case SoftwareFilter::Status::ExtMasksFull:
+			usbPrint("ERROR: Too many distinct EXT masks (max %u)\r\n", SoftwareFilter::MAX_EXT_MASKS);
+			break;
+		default:
+			usbPrint("ERROR: SW filter table full\r\n");
+			break;
+	}
+	sys->led->indicateError(true);
+}
+
+static void swFilterDeleteCallback(uint16_t index, bool delete_all){
+	sys->led->flashOnCommand();
+
+	if (delete_all) {
+		sys->soft_filter->clear();
+		usbPrint("OK: All SW rules removed\r\n");
+	} else if (sys->soft_filter->removeRule(index) == SoftwareFilter::Status::OK) {
+		usbPrint("OK: SW rule %u removed\r\n", index);
+	} else {
+		usbPrint("ERROR: SW rule %u not found\r\n", index);
+	}
+}
+
+static void swFilterListCallback(void){
+	static const char* const KIND_NAMES[] = { "ID", "RANGE", "MASK" };
+
+	sys->led->flashOnCommand();
+
+	usbPrint("\r\n=== SW Filter ===\r\n"
+			 "Rules: %u/%u, EXT ranges %u, EXT masks %u, filtered %lu frames\r\n",
+			 sys->soft_filter->getRuleCount(), SoftwareFilter::MAX_RULES,
+			 sys->soft_filter->getExtRangeCount(), sys->soft_filter->getExtMaskCount(),
+			 sys->can_processor->getSoftFilteredCount());
+
+	for (uint16_t i = 0; i < sys->soft_filter->getRuleCount(); i++) {
+		const SoftwareFilter::Rule& rule = sys->soft_filter->getRule(i);
+		usbPrint("%-3u %-5s %s 0x%08lX 0x%08lX\r\n", i, KIND_NAMES[(uint8_t)rule.kind],
+				 rule.is_extended ? "EXT" : "STD", rule.first, rule.second);
+	}
+	usbPrint("=================\r\n");
+}
+
 static void writeCallback(uint32_t id, uint8_t* data, uint8_t dlc){
 	bool is_extended = (id > 0x7FF);
 	bool is_remote = false;
 
 	sys->led->flashOnTx();
 
-	sys->can_driver->sendMessage(id, is_extended, is_remote, data, dlc);
+	CanDriver::Status status = sys->can_driver->sendMessage(id, is_extended, is_remote, data, dlc);
+	if (status == CanDriver::Status::BUSY) {
+		usbPrint("ERROR: TX queue full (%u frames), frame dropped\r\n", CanTxQueue::CAPACITY);
+	}
 }
 
 static void writeSequenceCallback(uint32_t id, uint8_t* data, uint8_t dlc,
-        uint32_t count, uint32_t interval_ms){
+        uint32_t count, uint32_t interval_us){
 	sys->led->flashOnCommand();
-	bool success = sys->seq_manager->startSequence(id, data, dlc, count, interval_ms);
+	bool success = sys->seq_manager->startSequence(id, data, dlc, count, interval_us);
 
     if (success) {
         usbPrint("Sequence started successfully. Active: %zu\r\n",
                sys->seq_manager->getActiveCount());
     } else {
-    	usbPrint("ERROR: Failed to start sequence (max %zu)\r\n",
+    	usbPrint("ERROR: Failed to start sequence (max %u)\r\n",
                SequenceManager::MAX_SEQUENCES);
     }
 }
 
+// Список последовательностей тоже выводится порциями: на сотни строк
+// кольца передачи не хватит
+static struct {
+	bool active;
+	uint16_t position;
+	uint16_t rows;
+} seq_dump;
+
+static constexpr uint16_t SEQ_ROW_SIZE = 128;
+
+static void seqListCallback(void){
+	sys->led->flashOnCommand();
+
+	usbPrint("\r\n=== Sequences: %u/%u active ===\r\n"
+			 "      ID   Period us      Sent     Count  Late min/avg/max us  Missed  Failed  Data\r\n",
+			 (unsigned)sys->seq_manager->getActiveCount(), SequenceManager::MAX_SEQUENCES);
+
+	seq_dump.active = true;
+	seq_dump.position = 0;
+	seq_dump.rows = 0;
+}
+
+static void seqListStep(void){
+	if (!seq_dump.active) {
+		return;
+	}
+
+	while (seq_dump.position < SequenceManager::MAX_SEQUENCES
+		   && sys->usb_tx->getFreeSpace() >= SEQ_ROW_SIZE) {
+		SequenceManager::TimingStats seq;
+		if (!sys->seq_manager->getTimingStats(seq_dump.position++, seq)) {
+			continue;
+		}
+
+		char row[SEQ_ROW_SIZE];
+		int len = snprintf(row, sizeof(row),
+						   (seq.id > 0x7FF) ? "%08lX %11lu %9lu %9lu %6ld/%ld/%ld %7lu %7lu "
+											: "     %03lX %11lu %9lu %9lu %6ld/%ld/%ld %7lu %7lu ",
+						   seq.id, seq.interval_us, seq.sent_count, seq.total_count,
+						   seq.late_min_us, seq.late_avg_us, seq.late_max_us, seq.missed,
+						   seq.failed);
+
+		uint8_t* out = (uint8_t*)row + len;
+		for (uint8_t i = 0; i < seq.dlc; i++) {
+			*out++ = ' ';
+			out += DigitEmitter::hexByte(out, seq.data[i]);
+		}
+		*out++ = '\r';
+		*out++ = '\n';
+
+		usbWriteCallback((uint8_t*)row, (uint16_t)(out - (uint8_t*)row));
+		seq_dump.rows++;
+	}
+
+	if (seq_dump.position >= SequenceManager::MAX_SEQUENCES) {
+		seq_dump.active = false;
+		usbPrint("=== %u rows, count 0 - endless ===\r\n", seq_dump.rows);
+	}
+}
+
+static void seqStopCallback(uint32_t id, bool stop_all){
+	sys->led->flashOnCommand();
+
+	if (stop_all) {
+		sys->seq_manager->stopAllSequences();
+		usbPrint("All sequences stopped\r\n");
+	} else if (sys->seq_manager->stopSequence(id)) {
+		usbPrint("Sequence 0x%lX stopped. Active: %zu\r\n", id, sys->seq_manager->getActiveCount());
+	} else {
+		usbPrint("ERROR: No active sequence 0x%lX\r\n", id);
+	}
+}
+
+static void seqDataCallback(uint32_t id, uint8_t* data, uint8_t dlc){
+	sys->led->flashOnCommand();
+
+	if (sys->seq_manager->updateData(id, data, dlc)) {
+		usbPrint("Sequence 0x%lX data updated\r\n", id);
+	} else {
+		usbPrint("ERROR: No active sequence 0x%lX\r\n", id);
+	}
+}
+
+static void replayStatusCallback(void){
+	static const char* const STATE_NAMES[] = { "idle", "buffering", "playing", "draining" };
+	ReplayPlayer::Stats stats;
+
+	sys->led->flashOnCommand();
+	sys->replay_player->getStats(stats);
+
+	usbPrint("\r\n=== Replay ===\r\n"
+			 "State:         %s\r\n"
+			 "Buffer:        %lu/%lu frames, prebuffer %lu\r\n"
+			 "Frames:        %lu received, %lu sent, %lu dropped, %lu TX retries\r\n"
+			 "Underruns:     %lu, schedule shifted %lu us\r\n"
+			 "Late:          min %ld, avg %ld, max %ld us\r\n"
+			 "==============\r\n",
+			 STATE_NAMES[(uint8_t)stats.state],
+			 stats.buffered, ReplayPlayer::CAPACITY, stats.prebuffer,
+			 stats.received, stats.sent, stats.dropped, stats.tx_retries,
+			 stats.underruns, stats.underrun_us,
+			 stats.late_min_us, stats.late_avg_us, stats.late_max_us);
+}
+
+static void replayStopCallback(void){
+	sys->led->flashOnCommand();
+	sys->replay_player->stop();
+	usbPrint("Replay stopped\r\n");
+}
+
+static void traceAddCallback(uint32_t delta_us, uint32_t id, uint8_t* data, uint8_t dlc){
+	if (!sys->trace_player->add(delta_us, id, id > 0x7FF, false, data, dlc)) {
+		usbPrint("ERROR: Trace is playing or full (%lu records)\r\n", TracePlayer::MAX_RECORDS);
+	}
+}
+
+static void tracePrintStats(const char* title, const TracePlayer::RunStats& run){
+	usbPrint("\r\n=== %s ===\r\n"
+			 "Records:       %lu, loops %lu/%lu, speed %u%%\r\n"
+			 "Frames:        %lu sent, %lu dropped, %lu TX retries\r\n"
+			 "Late:          min %ld, avg %ld, max %ld us, %lu over %ld us\r\n"
+			 "Duration:      %lu us\r\n"
+			 "==============\r\n",
+			 title,
+			 run.records, run.loops_done, run.loops, run.speed_percent,
+			 run.sent, run.dropped, run.tx_retries,
+			 run.late_min_us, run.late_avg_us, run.late_max_us,
+			 run.late_over, TracePlayer::LATE_THRESHOLD_US,
+			 run.duration_us);
+}
+
+static void traceControlCallback(TraceAction action, uint32_t loops, uint16_t speed_percent){
+	static const char* const STATE_NAMES[] = { "idle", "playing", "paused" };
+	TracePlayer* player = sys->trace_player;
+
+	sys->led->flashOnCommand();
+
+	switch (action) {
+		case TRACE_CLEAR:
+			if (player->clear()) {
+				usbPrint("Trace cleared\r\n");
+			} else {
+				usbPrint("ERROR: Trace is playing\r\n");
+			}
+			break;
+		case TRACE_PLAY:
+			if (player->play(loops, speed_percent)) {
+				usbPrint("Trace playing: %lu records\r\n", player->getRecordCount());
+			} else {
+				usbPrint("ERROR: Trace is empty\r\n");
+			}
+			break;
+		case TRACE_PAUSE:
+			if (!player->pause()) {
+				usbPrint("ERROR: Trace is not playing\r\n");
+			}
+			break;
+		case TRACE_RESUME:
+			if (!player->resume()) {
+				usbPrint("ERROR: Trace is not paused\r\n");
+			}
+			break;
+		case TRACE_STOP:
+			// Отчет о прерванном прогоне выведет traceReportStep()
+			player->stop();
+			break;
+		case TRACE_STATUS: {
+			TracePlayer::RunStats run;
+			player->getStats(run);
+			usbPrint("\r\nTrace:         %s, %lu/%lu records loaded, position %lu\r\n",
+					 STATE_NAMES[(uint8_t)player->getState()],
+					 player->getRecordCount(), TracePlayer::MAX_RECORDS, player->getPosition());
+			tracePrintStats("Trace run", run);
+			break;
+		}
+	}
+}
+
+// Отчет о точности по окончании прогона: прогон кончается в прерывании
+static void traceReportStep(void){
+	TracePlayer::RunStats run;
+
+	if (sys->trace_player->takeReport(run)) {
+		tracePrintStats(run.completed ? "Trace run complete" : "Trace run stopped", run);
+	}
+}
+
 static void readRawCallback(void){
 	sys->led->flashOnCommand();
-	sys->state.parsing = false;
+	sys->text_formatter->setLayout(TextFrameFormatter::Layout::Raw);
+	sys->state.output_mode = System::OUTPUT_RAW;
+	sys->can_processor->setFrameOutput(true);
 }
 
 static void readParsedCallback(void){
 	sys->led->flashOnCommand();
-	sys->state.parsing = true;
+	sys->text_formatter->setLayout(TextFrameFormatter::Layout::Parsed);
+	sys->state.output_mode = System::OUTPUT_PARSED;
+	sys->can_processor->setFrameOutput(true);
+}
+
+static void readBinaryCallback(void){
+	sys->led->flashOnCommand();
+	sys->protocol_formatter->setFormat(ProtocolFormatter::Format::Binary);
+	sys->state.output_mode = System::OUTPUT_BINARY;
+	sys->can_processor->setFrameOutput(true);
+}
+
+// Режим "read changes": вместо потока кадров раз в interval_ms выводятся
+// только ID, чьи данные изменились, с подсветкой измененных байт
+static struct {
+	uint32_t interval_ms;
+	uint32_t last_refresh_ms;
+	uint16_t cursor;
+} changes_view = { System::DEFAULT_CHANGES_INTERVAL_MS, 0, 0 };
+
+static void readChangesCallback(uint32_t interval_ms){
+	sys->led->flashOnCommand();
+
+	changes_view.interval_ms = (interval_ms != 0) ? interval_ms : System::DEFAULT_CHANGES_INTERVAL_MS;
+	changes_view.last_refresh_ms = HAL_GetTick();
+	changes_view.cursor = 0;
+
+	// Первое обновление показывает все известные ID
+	sys->id_stats->markAllChanged();
+	sys->state.output_mode = System::OUTPUT_CHANGES;
+	sys->can_processor->setFrameOutput(false);
+
+	usbPrint("Changes view, refresh %lu ms\r\n", changes_view.interval_ms);
+}
+
+static void changesRefreshStep(uint32_t current_time_ms){
+	if (sys->state.output_mode != System::OUTPUT_CHANGES
+		|| current_time_ms - changes_view.last_refresh_ms < changes_view.interval_ms) {
+		return;
+	}
+	changes_view.last_refresh_ms = current_time_ms;
+
+	uint16_t count = sys->id_stats->getIdCount();
+	if (changes_view.cursor >= count) {
+		changes_view.cursor = 0;
+	}
+
+	// Если кольцо передачи заполнилось, остальные ID ждут следующего
+	// обновления - их маски не сбрасываются, а обход продолжится с курсора
+	for (uint16_t scanned = 0; scanned < count; scanned++) {
+		uint16_t index = changes_view.cursor;
+
+		if (sys->id_stats->hasChanges(index)) {
+			uint8_t* out = sys->usb_tx->reserve(TextFrameFormatter::MAX_LINE_SIZE);
+			if (out == nullptr) {
+				break;
+			}
+
+			uint8_t changed_bytes = sys->id_stats->takeChangedBytes(index);
+			sys->usb_tx->commit(sys->text_formatter->formatChange(sys->id_stats->entryAt(index), changed_bytes,
+																   out, TextFrameFormatter::MAX_LINE_SIZE));
+		}
+
+		changes_view.cursor = (index + 1 < count) ? index + 1 : 0;
+	}
+}
+
+static void readColorCallback(bool enable){
+	sys->led->flashOnCommand();
+	sys->text_formatter->setColors(enable);
+	usbPrint("Colors %s\r\n", enable ? "ON" : "OFF");
 }
 
 static void errorCallback(const char *error_msg){
@@ -387,60 +1059,141 @@ static void handleBusLoadStatus(void) {
     usbPrint("Current CAN bus load: %.1f%%\r\n", load);
 }
 
-static void canSendCallback(uint32_t id, bool is_extended, bool is_remote, uint8_t* data, uint8_t dlc){
-	sys->led->flashOnTx();
-	sys->can_driver->sendMessage(id, is_extended, is_remote, data, dlc);
+// Вывод таблицы по ID идет порциями из superloop: 1024 строки не помещаются
+// в кольцо передачи, а ждать USB внутри команды нельзя - встанет прием
+static struct {
+	bool active;
+	uint16_t position;
+	uint16_t total;
+} stats_dump;
+
+static constexpr uint16_t STATS_ROW_SIZE = 128;
+
+static void statsCallback(uint16_t limit){
+	sys->led->flashOnCommand();
+
+	uint16_t total = sys->id_stats->rankByCount();
+	if (limit != 0 && limit < total) {
+		total = limit;
+	}
+
+	usbPrint("\r\n=== ID statistics: %u/%u IDs, %lu untracked frames ===\r\n"
+			 "      ID      Count  Last us   Min us   Max us  Jitter  Changes  Data\r\n",
+			 sys->id_stats->getIdCount(), IdStatsTable::MAX_IDS,
+			 sys->id_stats->getUntrackedFrames());
+
+	stats_dump.active = true;
+	stats_dump.position = 0;
+	stats_dump.total = total;
 }
 
-static bool configureFilterCallback(uint8_t bank, uint8_t slot,
-                                   uint32_t id, uint32_t mask,
-                                   bool is_extended) {
-    CanDriver::Status status = sys->can_driver->setFilter(bank, slot, id, mask, is_extended);
+static void statsResetCallback(void){
+	sys->led->flashOnCommand();
+	stats_dump.active = false;
+	sys->id_stats->reset();
+	usbPrint("ID statistics cleared\r\n");
+}
 
-    if (status != CanDriver::Status::OK) {
-        debugPrint("ERROR: Failed to configure filter bank %d, slot %d\r\n", bank, slot);
-        debugPrint("ID: 0x%08lX, Mask: 0x%08lX, Type: %s\r\n",
-               id, mask, is_extended ? "EXT" : "STD");
-        return false;
-    }
+static void statsDumpStep(void){
+	if (!stats_dump.active) {
+		return;
+	}
 
-    debugPrint("Filter configured: Bank %d, Slot %d, ID 0x%08lX\r\n", bank, slot, id);
+	while (stats_dump.position < stats_dump.total
+		   && sys->usb_tx->getFreeSpace() >= STATS_ROW_SIZE) {
+		const IdStatsTable::Entry& entry = sys->id_stats->ranked(stats_dump.position++);
+		char row[STATS_ROW_SIZE];
+		int len = snprintf(row, sizeof(row),
+						   entry.isExtended() ? "%08lX %10lu %8lu %8lu %8lu %7lu %8u  [%u]"
+											  : "     %03lX %10lu %8lu %8lu %8lu %7lu %8u  [%u]",
+						   entry.id(), entry.count,
+						   entry.lastPeriodUs(),
+						   entry.minPeriodUs(),
+						   entry.maxPeriodUs(),
+						   entry.jitterUs(),
+						   (unsigned)entry.changes, (unsigned)entry.dlc);
+
+		uint8_t* out = (uint8_t*)row + len;
+		for (uint8_t i = 0; i < entry.dlc; i++) {
+			*out++ = ' ';
+			out += DigitEmitter::hexByte(out, entry.data[i]);
+		}
+		*out++ = '\r';
+		*out++ = '\n';
+
+		usbWriteCallback((uint8_t*)row, (uint16_t)(out - (uint8_t*)row));
+	}
 
-    return true;
+	if (stats_dump.position >= stats_dump.total) {
+		stats_dump.active = false;
+		usbPrint("=== %u rows ===\r\n", stats_dump.total);
+	}
 }
 
-static bool disableFilterCallback(uint8_t bank, uint8_t slot){
-    CanDriver::Status status = sys->can_driver->disableFilter(bank, slot);
+// Из прерывания TIM2 CC1: BUSY и NOT_STARTED - отправка не состоялась
+static bool canSendCallback(uint32_t id, bool is_extended, bool is_remote, uint8_t* data, uint8_t dlc){
+	if (sys->can_driver->sendMessage(id, is_extended, is_remote, data, dlc) != CanDriver::Status::OK) {
+		return false;
+	}
+	sys->led->flashOnTx();
+	return true;
+}
 
-    if (status != CanDriver::Status::OK) {
-    	debugPrint("WARNING: Failed to disable filter bank %d, slot %d\r\n", bank, slot);
-    	return false;
-    }
+// Из прерывания TIM2 CC2: полная очередь передачи - повтор, остальное - потеря кадра
+static ReplayPlayer::SendResult replaySendCallback(uint32_t id, bool is_extended, bool is_remote,
+		const uint8_t* data, uint8_t dlc){
+	CanDriver::Status status = sys->can_driver->sendMessage(id, is_extended, is_remote, (uint8_t*)data, dlc);
 
-    debugPrint("Filter disabled: Bank %d, Slot %d\r\n", bank, slot);
-    return true;
+	if (status == CanDriver::Status::BUSY) {
+		return ReplayPlayer::SendResult::RETRY;
+	}
+	if (status != CanDriver::Status::OK) {
+		return ReplayPlayer::SendResult::DROPPED;
+	}
+	sys->led->flashOnTx();
+	return ReplayPlayer::SendResult::SENT;
 }
 
-static void disableAllFiltersCallback(){
-    CanDriver::Status status = sys->can_driver->disableAllFilters();
+static TracePlayer::SendResult traceSendCallback(uint32_t id, bool is_extended, bool is_remote,
+		const uint8_t* data, uint8_t dlc){
+	CanDriver::Status status = sys->can_driver->sendMessage(id, is_extended, is_remote, (uint8_t*)data, dlc);
 
-    if (status == CanDriver::Status::OK) {
-    	debugPrint("All filters disabled successfully\r\n");
-    } else {
-    	debugPrint("WARNING: Some filters failed to disable\r\n");
+	if (status == CanDriver::Status::BUSY) {
+		return TracePlayer::SendResult::RETRY;
+	}
+	if (status != CanDriver::Status::OK) {
+		return TracePlayer::SendResult::DROPPED;
+	}
+	sys->led->flashOnTx();
+	return TracePlayer::SendResult::SENT;
+}
+
+static bool applyFilterPlanCallback(const FilterBankPlanner::Plan& plan){
+    CanDriver::Status status = sys->can_driver->applyFilterPlan(plan);
+
+    if (status != CanDriver::Status::OK) {
+        debugPrint("ERROR: Failed to program %u filter banks\r\n", plan.bank_count);
+        return false;
     }
+
+    debugPrint("Filters programmed: %u banks, %u entries\r\n", plan.bank_count, plan.entry_count);
+    return true;
 }
 
 static void usbPrint(const char* format, ...){
-    static char buffer[256];
+    static char buffer[512];
     va_list args;
 
     va_start(args, format);
     int len = vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
 
+    if (len >= (int)sizeof(buffer)) {
+        len = sizeof(buffer) - 1;
+    }
+
     if (len > 0) {
-        CDC_Transmit_FS((uint8_t*)buffer, (uint16_t)len);
+        usbWriteCallback((uint8_t*)buffer, (uint16_t)len);
     }
 }
 
@@ -478,3 +1231,160 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim){
 		sys->state.timer_100ms_ready = true;
 	}
 }
+
+// Будильники TIM2: CC1 - последовательности, CC2 - поток, CC3 - трасса
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim){
+	if (htim != &htim2 || sys == nullptr){
+		return;
+	}
+
+	if (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1 && sys->seq_manager != nullptr){
+		sys->seq_manager->onAlarm();
+	} else if (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2 && sys->replay_player != nullptr){
+		sys->replay_player->onAlarm();
+	} else if (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_3 && sys->trace_player != nullptr){
+		sys->trace_player->onAlarm();
+	}
+}
+
+// ===== Двоичный канал команд =====
+// Ответы только кодом статуса: текст в поток двоичных ответов не пишется
+
+static bool binaryFrameCallback(const uint8_t* frame, uint16_t length){
+	return sys->binary_protocol->handleFrame(frame, length);
+}
+
+static BinaryProtocol::Status binStatus(CanDriver::Status status){
+	switch (status) {
+		case CanDriver::Status::OK:            return BinaryProtocol::Status::OK;
+		case CanDriver::Status::BUSY:          return BinaryProtocol::Status::BUSY;
+		case CanDriver::Status::NOT_STARTED:   return BinaryProtocol::Status::NOT_STARTED;
+		case CanDriver::Status::INVALID_PARAM: return BinaryProtocol::Status::INVALID_PARAM;
+		default:                               return BinaryProtocol::Status::FAILED;
+	}
+}
+
+static BinaryProtocol::Status binSendCallback(uint32_t id, bool is_extended, bool is_remote,
+		const uint8_t* data, uint8_t dlc){
+	sys->led->flashOnTx();
+	return binStatus(sys->can_driver->sendMessage(id, is_extended, is_remote, (uint8_t*)data, dlc));
+}
+
+static BinaryProtocol::Status binCanControlCallback(bool start){
+	CanDriver::Status status = start ? sys->can_driver->activateNotification()
+									 : sys->can_driver->deactivateNotification();
+	if (status != CanDriver::Status::OK) {
+		sys->led->indicateError(true);
+		return binStatus(status);
+	}
+
+	sys->snifferAtivityStatus = start ? System::SNIFFER_ACTIVE : System::SNIFFER_STOPPED;
+	sys->led->indicateCanStarted(start);
+	return BinaryProtocol::Status::OK;
+}
+
+static BinaryProtocol::Status binSeqStartCallback(uint32_t id, const uint8_t* data, uint8_t dlc,
+		uint32_t count, uint32_t interval_us){
+	sys->led->flashOnCommand();
+
+	if (!sys->seq_manager->startSequence(id, data, dlc, count, interval_us)) {
+		return BinaryProtocol::Status::NO_RESOURCES;
+	}
+	return BinaryProtocol::Status::OK;
+}
+
+static BinaryProtocol::Status binSeqStopCallback(uint32_t id, bool stop_all){
+	sys->led->flashOnCommand();
+
+	if (stop_all) {
+		sys->seq_manager->stopAllSequences();
+		return BinaryProtocol::Status::OK;
+	}
+	return sys->seq_manager->stopSequence(id) ? BinaryProtocol::Status::OK
+											  : BinaryProtocol::Status::NOT_FOUND;
+}
+
+static BinaryProtocol::Status binSeqDataCallback(uint32_t id, const uint8_t* data, uint8_t dlc){
+	return sys->seq_manager->updateData(id, data, dlc) ? BinaryProtocol::Status::OK
+													   : BinaryProtocol::Status::NOT_FOUND;
+}
+
+static BinaryProtocol::Status binFilterAddCallback(uint32_t id, uint32_t mask, bool is_extended){
+	FilterManager::FilterType type = is_extended ? FilterManager::FilterType::EXT
+												 : FilterManager::FilterType::STD;
+	sys->led->flashOnCommand();
+
+	if (!FilterManager::isValidId(id, type) || (mask != 0 && !FilterManager::isValidMask(mask, type))) {
+		return BinaryProtocol::Status::INVALID_PARAM;
+	}
+	if (!sys->filter_manager->addFilter(id, mask, type)) {
+		return BinaryProtocol::Status::NO_RESOURCES;
+	}
+	return BinaryProtocol::Status::OK;
+}
+
+static BinaryProtocol::Status binFilterDelCallback(uint32_t id, bool delete_all){
+	sys->led->flashOnCommand();
+
+	if (delete_all) {
+		sys->filter_manager->removeAllFilters();
+		return BinaryProtocol::Status::OK;
+	}
+	return sys->filter_manager->removeFilter(id) ? BinaryProtocol::Status::OK
+												 : BinaryProtocol::Status::NOT_FOUND;
+}
+
+static BinaryProtocol::Status binStreamControlCallback(BinaryProtocol::StreamAction action, uint16_t prebuffer){
+	sys->led->flashOnCommand();
+
+	switch (action) {
+		case BinaryProtocol::StreamAction::BEGIN:
+			sys->replay_player->begin(prebuffer);
+			break;
+		case BinaryProtocol::StreamAction::END:
+			sys->replay_player->end();
+			break;
+		case BinaryProtocol::StreamAction::STOP:
+			sys->replay_player->stop();
+			break;
+	}
+	return BinaryProtocol::Status::OK;
+}
+
+// Поток не принимает - пакет откажут сразу, ждать места ему незачем
+static uint32_t binStreamSpaceCallback(void){
+	if (!sys->replay_player->isAccepting()) {
+		return ReplayPlayer::CAPACITY;
+	}
+	return sys->replay_player->getFreeSpace();
+}
+
+static BinaryProtocol::Status binStreamPushCallback(uint32_t delta_us, uint32_t id, bool is_extended,
+		bool is_remote, const uint8_t* data, uint8_t dlc){
+	if (!sys->replay_player->isAccepting()) {
+		return BinaryProtocol::Status::NOT_STARTED;
+	}
+	if (!sys->replay_player->push(delta_us, id, is_extended, is_remote, data, dlc)) {
+		return BinaryProtocol::Status::BUSY;
+	}
+	return BinaryProtocol::Status::OK;
+}
+
+static BinaryProtocol::Status binTraceAddCallback(uint32_t delta_us, uint32_t id, bool is_extended,
+		bool is_remote, const uint8_t* data, uint8_t dlc){
+	if (sys->trace_player->getState() != TracePlayer::State::IDLE) {
+		return BinaryProtocol::Status::BUSY;
+	}
+	if (!sys->trace_player->add(delta_us, id, is_extended, is_remote, data, dlc)) {
+		return BinaryProtocol::Status::NO_RESOURCES;
+	}
+	return BinaryProtocol::Status::OK;
+}
+
+static BinaryProtocol::Status binTraceClearCallback(void){
+	return sys->trace_player->clear() ? BinaryProtocol::Status::OK : BinaryProtocol::Status::BUSY;
+}
+
+static uint32_t binTraceSpaceCallback(void){
+	return TracePlayer::MAX_RECORDS - sys->trace_player->getRecordCount();
+}
@@ -14,9 +14,15 @@
 #include "CommandHandler/CommandHandler.h"
 #include "CommandProcessor/CommandProcessor.h"
 #include "SequenceManager/SequenceManager.h"
+#include "ReplayPlayer/ReplayPlayer.h"
+#include "TracePlayer/TracePlayer.h"
 #include "FilterManager/FilterManager.h"
 #include "CanBusMonitor/CanBusMonitor.h"
 #include "LED/LED.h"
+#include "UsbTxStream/UsbTxStream.h"
+#include "TextFrameFormatter/TextFrameFormatter.h"
+#include "IdStatsTable/IdStatsTable.h"
+#include "BinaryProtocol/BinaryProtocol.h"
 
 extern "C" {
 	#include "Queue/cQueue.h"
@@ -64,8 +70,17 @@ public:
 		SWV_DEBUG,
 	} DebugMethod;
 
+	typedef enum {
+		OUTPUT_RAW,
+		OUTPUT_PARSED,
+		OUTPUT_BINARY,
+		OUTPUT_CHANGES,
+	} OutputMode;
+
+	static constexpr uint32_t DEFAULT_CHANGES_INTERVAL_MS = 100;
+
 	typedef struct {
-		bool parsing;
+		OutputMode output_mode;
 		DebugMethod debug_method;
 		bool timer_100ms_ready;
 	} State;
@@ -77,27 +92,33 @@ public:
 	void substr(char *str, char *sub, int start, int len);
 	int  toInteger(uint8_t *stringToConvert, int len);
 
-	System::State state = {0};
+	System::State state = {};
 
 	CanDriver      *can_driver      = nullptr;
 	CommandHandler *command_handler = nullptr;
 	ProtocolFormatter *protocol_formatter = nullptr;
+	TextFrameFormatter *text_formatter    = nullptr;
 	SequenceManager *seq_manager 		  = nullptr;
+	ReplayPlayer    *replay_player = nullptr;
+	TracePlayer     *trace_player  = nullptr;
 	FilterManager   *filter_manager = nullptr;
 	CanBusMonitor   *bus_monitor = nullptr;
 	Led             *led         = nullptr;
+	UsbTxStream     *usb_tx      = nullptr;
+	CanProcessor    *can_processor = nullptr;
+	IdStatsTable    *id_stats      = nullptr;
+	SoftwareFilter  *soft_filter   = nullptr;
+	BinaryProtocol  *binary_protocol = nullptr;
+
+	CanMessageRing can_msg_queue;
 
 	SnifferAtivityStatus snifferAtivityStatus = SNIFFER_STOPPED;
 private:
 	void timersInit();
 
 	CommandProcessor *command_processor   = nullptr;
-	CanProcessor     *can_processor       = nullptr;
 
 	Queue_t command_queue;
-	Queue_t can_msg_queue;
-
-	CanMessage_t dequed_can_message;
 
 };
 
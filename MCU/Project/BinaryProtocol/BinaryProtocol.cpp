@@ -0,0 +1,397 @@
+/*
+ * BinaryProtocol.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "BinaryProtocol.h"
+#include "COBSLib/cobs.h"
+#include <cstring>
+
+// Заголовок записи кадра в WRITE: id u32 + dlc u8
+static constexpr uint8_t WRITE_RECORD_HEADER = 5;
+// Запись STREAM_DATA - та же запись с delta_us u32 впереди
+static constexpr uint8_t STREAM_DELTA_SIZE = 4;
+
+// Данные для RTR: драйвер копирует dlc байт, читать за концом тела нельзя
+static const uint8_t NO_DATA[8] = {};
+
+// Запись кадра: ID с флагами, dlc и данные (у RTR данных нет)
+static bool parseFrameRecord(const uint8_t* body, uint16_t length, uint16_t& pos,
+                             uint32_t& id_flags, uint8_t& dlc, const uint8_t*& data) {
+    if (length - pos < WRITE_RECORD_HEADER) {
+        return false;
+    }
+
+    id_flags = (uint32_t)body[pos] | ((uint32_t)body[pos + 1] << 8) |
+               ((uint32_t)body[pos + 2] << 16) | ((uint32_t)body[pos + 3] << 24);
+    dlc = body[pos + 4];
+    pos += WRITE_RECORD_HEADER;
+
+    uint8_t data_len = (id_flags & BinaryProtocol::ID_FLAG_RTR) ? 0 : dlc;
+    if (dlc > 8 || length - pos < data_len) {
+        return false;
+    }
+
+    data = data_len ? &body[pos] : NO_DATA;
+    pos += data_len;
+    return true;
+}
+
+static bool parseStreamRecord(const uint8_t* body, uint16_t length, uint16_t& pos, uint32_t& delta_us,
+                              uint32_t& id_flags, uint8_t& dlc, const uint8_t*& data) {
+    if (length - pos < STREAM_DELTA_SIZE) {
+        return false;
+    }
+
+    delta_us = (uint32_t)body[pos] | ((uint32_t)body[pos + 1] << 8) |
+               ((uint32_t)body[pos + 2] << 16) | ((uint32_t)body[pos + 3] << 24);
+    pos += STREAM_DELTA_SIZE;
+    return parseFrameRecord(body, length, pos, id_flags, dlc, data);
+}
+
+static bool validId(uint32_t id_flags) {
+    uint32_t id = id_flags & 0x1FFFFFFF;
+
+    if (id_flags & ~(0x1FFFFFFF | BinaryProtocol::ID_FLAG_RTR | BinaryProtocol::ID_FLAG_EXT)) {
+        return false;
+    }
+    return (id_flags & BinaryProtocol::ID_FLAG_EXT) || id <= 0x7FF;
+}
+
+BinaryProtocol::BinaryProtocol(SendCallback send_cb,
+                               CanControlCallback can_control_cb,
+                               SeqStartCallback seq_start_cb,
+                               SeqStopCallback seq_stop_cb,
+                               SeqDataCallback seq_data_cb,
+                               FilterAddCallback filter_add_cb,
+                               FilterDelCallback filter_del_cb,
+                               StreamControlCallback stream_control_cb,
+                               StreamSpaceCallback stream_space_cb,
+                               RecordCallback stream_push_cb,
+                               RecordCallback trace_add_cb,
+                               TraceClearCallback trace_clear_cb,
+                               TraceSpaceCallback trace_space_cb,
+                               ResponseCallback response_cb)
+    : send_callback_(send_cb),
+      can_control_callback_(can_control_cb),
+      seq_start_callback_(seq_start_cb),
+      seq_stop_callback_(seq_stop_cb),
+      seq_data_callback_(seq_data_cb),
+      filter_add_callback_(filter_add_cb),
+      filter_del_callback_(filter_del_cb),
+      stream_control_callback_(stream_control_cb),
+      stream_space_callback_(stream_space_cb),
+      stream_push_callback_(stream_push_cb),
+      trace_add_callback_(trace_add_cb),
+      trace_clear_callback_(trace_clear_cb),
+      trace_space_callback_(trace_space_cb),
+      response_callback_(response_cb),
+      request_count_(0),
+      nak_count_(0) {
+}
+
+bool BinaryProtocol::handleFrame(const uint8_t* encoded, uint16_t length) {
+    Response response = {};
+    cobs_decode_result decoded = cobs_decode(payload_, sizeof(payload_), encoded, length);
+
+    // Без заголовка не известны ни opcode, ни seq - NAK с нулями
+    if (decoded.status != COBS_DECODE_OK || decoded.out_len < HEADER_SIZE) {
+        request_count_++;
+        response.status = Status::BAD_FRAME;
+        respond(0, 0, response);
+        return true;
+    }
+
+    uint8_t opcode = payload_[0];
+    uint16_t seq = (uint16_t)(payload_[1] | (payload_[2] << 8));
+    const uint8_t* body = &payload_[HEADER_SIZE];
+    uint16_t body_length = decoded.out_len - HEADER_SIZE;
+
+    if ((Opcode)opcode == Opcode::STREAM_DATA && !streamHasRoom(body, body_length)) {
+        return false;
+    }
+
+    request_count_++;
+    execute((Opcode)opcode, body, body_length, response);
+    respond(opcode, seq, response);
+    return true;
+}
+
+void BinaryProtocol::execute(Opcode opcode, const uint8_t* body, uint16_t length, Response& response) {
+    switch (opcode) {
+        case Opcode::PING:
+            response.extra[0] = VERSION;
+            response.extra[1] = MAX_PAYLOAD & 0xFF;
+            response.extra[2] = MAX_PAYLOAD >> 8;
+            response.extra_len = 3;
+            response.status = Status::OK;
+            break;
+
+        case Opcode::CAN_START:
+        case Opcode::CAN_STOP:
+            response.status = (length != 0) ? Status::BAD_LENGTH
+                                            : can_control_callback_(opcode == Opcode::CAN_START);
+            break;
+
+        case Opcode::WRITE:
+            response.status = handleWrite(body, length, response);
+            break;
+
+        case Opcode::WRITE_SEQ:
+            response.status = handleWriteSeq(body, length);
+            break;
+
+        case Opcode::SEQ_STOP:
+            if (length != 4) {
+                response.status = Status::BAD_LENGTH;
+            } else {
+                uint32_t id = getLe32(body);
+                response.status = seq_stop_callback_(id, id == ALL_IDS);
+            }
+            break;
+
+        case Opcode::SEQ_DATA:
+            response.status = handleSeqData(body, length);
+            break;
+
+        case Opcode::FILTER_ADD:
+            if (length != 8) {
+                response.status = Status::BAD_LENGTH;
+            } else if (!validId(getLe32(body)) || (getLe32(body) & ID_FLAG_RTR)) {
+                response.status = Status::INVALID_PARAM;
+            } else {
+                uint32_t id_flags = getLe32(body);
+                response.status = filter_add_callback_(id_flags & 0x1FFFFFFF, getLe32(&body[4]),
+                                                       (id_flags & ID_FLAG_EXT) != 0);
+            }
+            break;
+
+        case Opcode::FILTER_DEL:
+            if (length != 4) {
+                response.status = Status::BAD_LENGTH;
+            } else {
+                uint32_t id = getLe32(body);
+                response.status = filter_del_callback_(id, id == ALL_IDS);
+            }
+            break;
+
+        case Opcode::STREAM_BEGIN:
+            if (length != 0 && length != 2) {
+                response.status = Status::BAD_LENGTH;
+            } else {
+                uint16_t prebuffer = (length == 2) ? (uint16_t)(body[0] | (body[1] << 8)) : 0;
+                response.status = stream_control_callback_(StreamAction::BEGIN, prebuffer);
+            }
+            break;
+
+        case Opcode::STREAM_DATA:
+            response.status = handleRecords(body, length, response,
+                                            stream_push_callback_, stream_space_callback_);
+            break;
+
+        case Opcode::STREAM_END:
+        case Opcode::STREAM_STOP:
+            response.status = (length != 0) ? Status::BAD_LENGTH
+                                            : stream_control_callback_(opcode == Opcode::STREAM_END ?
+                                                                       StreamAction::END : StreamAction::STOP, 0);
+            break;
+
+        case Opcode::TRACE_LOAD:
+            response.status = handleRecords(body, length, response,
+                                            trace_add_callback_, trace_space_callback_);
+            break;
+
+        case Opcode::TRACE_CLEAR:
+            response.status = (length != 0) ? Status::BAD_LENGTH : trace_clear_callback_();
+            break;
+
+        default:
+            response.status = Status::UNKNOWN_OPCODE;
+            break;
+    }
+}
+
+BinaryProtocol::Status BinaryProtocol::handleWrite(const uint8_t* body, uint16_t length, Response& response) {
+    uint32_t id_flags;
+    uint8_t dlc;
+    const uint8_t* data;
+    uint16_t pos = 0;
+    uint16_t count = 0;
+
+    // Пакет проверяется целиком до отправки: битый пакет не уходит на шину частично
+    while (pos < length) {
+        if (!parseFrameRecord(body, length, pos, id_flags, dlc, data)) {
+            return Status::BAD_LENGTH;
+        }
+        if (!validId(id_flags)) {
+            return Status::INVALID_PARAM;
+        }
+        count++;
+    }
+
+    if (count == 0 || count > UINT8_MAX) {
+        return Status::BAD_LENGTH;
+    }
+
+    // accepted - сколько кадров встало в очередь; при BUSY хост
+    // досылает пакет начиная с этого номера
+    uint8_t accepted = 0;
+    Status status = Status::OK;
+    pos = 0;
+
+    while (pos < length) {
+        parseFrameRecord(body, length, pos, id_flags, dlc, data);
+        status = send_callback_(id_flags & 0x1FFFFFFF, (id_flags & ID_FLAG_EXT) != 0,
+                                (id_flags & ID_FLAG_RTR) != 0, data, dlc);
+        if (status != Status::OK) {
+            break;
+        }
+        accepted++;
+    }
+
+    response.extra[0] = accepted;
+    response.extra_len = 1;
+    return status;
+}
+
+BinaryProtocol::Status BinaryProtocol::handleWriteSeq(const uint8_t* body, uint16_t length) {
+    if (length < WRITE_RECORD_HEADER) {
+        return Status::BAD_LENGTH;
+    }
+
+    uint32_t id = getLe32(body);
+    uint8_t dlc = body[4];
+    if (length != WRITE_RECORD_HEADER + dlc + 8) {
+        return Status::BAD_LENGTH;
+    }
+    if (dlc == 0 || dlc > 8 || id > 0x1FFFFFFF) {
+        return Status::INVALID_PARAM;
+    }
+
+    const uint8_t* data = &body[WRITE_RECORD_HEADER];
+    uint32_t count = getLe32(&data[dlc]);
+    uint32_t interval_us = getLe32(&data[dlc + 4]);
+
+    return seq_start_callback_(id, data, dlc, count, interval_us);
+}
+
+BinaryProtocol::Status BinaryProtocol::handleSeqData(const uint8_t* body, uint16_t length) {
+    if (length < WRITE_RECORD_HEADER) {
+        return Status::BAD_LENGTH;
+    }
+
+    uint8_t dlc = body[4];
+    if (length != WRITE_RECORD_HEADER + dlc) {
+        return Status::BAD_LENGTH;
+    }
+    if (dlc == 0 || dlc > 8) {
+        return Status::INVALID_PARAM;
+    }
+
+    return seq_data_callback_(getLe32(body), &body[WRITE_RECORD_HEADER], dlc);
+}
+
+// Ответ на STREAM_DATA уходит только когда весь пакет лег в буфер,
+// поэтому место проверяется заранее. Битый пакет "помещается" - его
+// отклонит handleStreamData()
+bool BinaryProtocol::streamHasRoom(const uint8_t* body, uint16_t length) {
+    uint32_t delta_us;
+    uint32_t id_flags;
+    uint8_t dlc;
+    const uint8_t* data;
+    uint16_t pos = 0;
+    uint32_t count = 0;
+
+    while (pos < length) {
+        if (!parseStreamRecord(body, length, pos, delta_us, id_flags, dlc, data)) {
+            return true;
+        }
+        count++;
+    }
+
+    return count <= stream_space_callback_();
+}
+
+// Пакет записей потока или трассы: проверяется целиком, затем передается
+// по одной записи. Ответ - принятые записи и оставшееся место
+BinaryProtocol::Status BinaryProtocol::handleRecords(const uint8_t* body, uint16_t length, Response& response,
+                                                     RecordCallback record_cb, uint32_t (*space_cb)()) {
+    uint32_t delta_us;
+    uint32_t id_flags;
+    uint8_t dlc;
+    const uint8_t* data;
+    uint16_t pos = 0;
+    uint16_t count = 0;
+
+    while (pos < length) {
+        if (!parseStreamRecord(body, length, pos, delta_us, id_flags, dlc, data)) {
+            return Status::BAD_LENGTH;
+        }
+        if (!validId(id_flags)) {
+            return Status::INVALID_PARAM;
+        }
+        count++;
+    }
+
+    if (count == 0 || count > UINT8_MAX) {
+        return Status::BAD_LENGTH;
+    }
+
+    uint8_t accepted = 0;
+    Status status = Status::OK;
+    pos = 0;
+
+    while (pos < length) {
+        parseStreamRecord(body, length, pos, delta_us, id_flags, dlc, data);
+        status = record_cb(delta_us, id_flags & 0x1FFFFFFF, (id_flags & ID_FLAG_EXT) != 0,
+                           (id_flags & ID_FLAG_RTR) != 0, data, dlc);
+        if (status != Status::OK) {
+            break;
+        }
+        accepted++;
+    }
+
+    // Свободное место после пакета - хост может держать окно без опроса
+    uint32_t free_space = space_cb();
+    if (free_space > UINT16_MAX) {
+        free_space = UINT16_MAX;
+    }
+
+    response.extra[0] = accepted;
+    response.extra[1] = free_space & 0xFF;
+    response.extra[2] = free_space >> 8;
+    response.extra_len = 3;
+    return status;
+}
+
+void BinaryProtocol::respond(uint8_t opcode, uint16_t seq, const Response& response) {
+    uint8_t raw[RESPONSE_MAX_SIZE];
+    uint8_t raw_len = 0;
+
+    if (response.status != Status::OK) {
+        nak_count_++;
+    }
+
+    raw[raw_len++] = (response.status == Status::OK) ? TYPE_ACK : TYPE_NAK;
+    raw[raw_len++] = opcode;
+    raw[raw_len++] = seq & 0xFF;
+    raw[raw_len++] = seq >> 8;
+    raw[raw_len++] = (uint8_t)response.status;
+    memcpy(&raw[raw_len], response.extra, response.extra_len);
+    raw_len += response.extra_len;
+
+    // Ведущий ноль отделяет ответ от текста, выведенного перед ним
+    uint8_t frame[COBS_ENCODE_DST_BUF_LEN_MAX(RESPONSE_MAX_SIZE) + 2];
+    frame[0] = 0x00;
+    cobs_encode_result result = cobs_encode(&frame[1], sizeof(frame) - 2, raw, raw_len);
+    if (result.status != COBS_ENCODE_OK) {
+        return;
+    }
+    frame[result.out_len + 1] = 0x00;
+
+    if (response_callback_) {
+        response_callback_(frame, result.out_len + 2);
+    }
+}
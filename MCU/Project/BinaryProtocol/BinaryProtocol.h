@@ -0,0 +1,160 @@
+/*
+ * BinaryProtocol.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef BINARYPROTOCOL_BINARYPROTOCOL_H_
+#define BINARYPROTOCOL_BINARYPROTOCOL_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Двоичный канал команд рядом с текстовым CLI на том же CDC.
+// Запрос: 0x00, COBS(opcode u8, seq u16, тело), 0x00 - в тексте нулевых
+// байт не бывает, поэтому CommandHandler отличает кадр по первому нулю.
+// Ответ: 0x00, COBS(ACK|NAK, opcode, seq u16, status u8, доп. байты), 0x00.
+// Ответ не длиннее RESPONSE_MAX_SIZE байт, а пакеты "read binary" - не
+// короче 18, так что в общем потоке они не путаются.
+// Все многобайтовые поля little-endian. Формат ID: биты 0..28 - ID,
+// ID_FLAG_RTR и ID_FLAG_EXT - флаги, как в записях "read binary".
+// STREAM_DATA без места в буфере воспроизведения не отклоняется, а
+// откладывается: handleFrame() возвращает false, и кадр остается во
+// входном кольце до освобождения места.
+class BinaryProtocol {
+public:
+    enum class Opcode : uint8_t {
+        PING       = 0x01,  // -> version u8, max_payload u16
+        CAN_START  = 0x02,
+        CAN_STOP   = 0x03,
+        WRITE      = 0x10,  // N x (id u32, dlc u8, data[dlc]) -> accepted u8
+        WRITE_SEQ  = 0x11,  // id u32, dlc u8, data[dlc], count u32, interval_us u32
+        SEQ_STOP   = 0x12,  // id u32 (ALL_IDS - все)
+        SEQ_DATA   = 0x13,  // id u32, dlc u8, data[dlc]
+        FILTER_ADD = 0x20,  // id u32, mask u32
+        FILTER_DEL = 0x21,  // id u32 (ALL_IDS - все)
+        STREAM_BEGIN = 0x30,  // [prebuffer u16] - кадров до старта, 0 - половина буфера
+        STREAM_DATA  = 0x31,  // N x (delta_us u32, id u32, dlc u8, data[dlc]) -> accepted u8, free u16
+        STREAM_END   = 0x32,  // Доиграть буфер и остановиться
+        STREAM_STOP  = 0x33,  // Остановить сразу
+        TRACE_LOAD   = 0x40,  // Записи как в STREAM_DATA -> accepted u8, free u16
+        TRACE_CLEAR  = 0x41,
+    };
+
+    enum class StreamAction : uint8_t {
+        BEGIN,
+        END,
+        STOP,
+    };
+
+    enum class Status : uint8_t {
+        OK             = 0,
+        BAD_FRAME      = 1,  // COBS не разобрался или кадр короче заголовка
+        UNKNOWN_OPCODE = 2,
+        BAD_LENGTH     = 3,  // Тело не совпадает с форматом опкода
+        INVALID_PARAM  = 4,
+        BUSY           = 5,  // Очередь передачи полна
+        NOT_STARTED    = 6,
+        NO_RESOURCES   = 7,  // Нет свободного фильтра или последовательности
+        NOT_FOUND      = 8,
+        FAILED         = 9,
+    };
+
+    static constexpr uint8_t VERSION = 1;
+    static constexpr uint8_t TYPE_ACK = 0x06;
+    static constexpr uint8_t TYPE_NAK = 0x15;
+    static constexpr uint16_t MAX_PAYLOAD = 512;
+    static constexpr uint8_t HEADER_SIZE = 3;          // opcode + seq
+    static constexpr uint8_t RESPONSE_MAX_SIZE = 9;    // До COBS
+    static constexpr uint32_t ID_FLAG_RTR = 1UL << 29;
+    static constexpr uint32_t ID_FLAG_EXT = 1UL << 30;
+    static constexpr uint32_t ALL_IDS = 0xFFFFFFFF;
+
+    typedef Status (*SendCallback)(uint32_t id, bool is_extended, bool is_remote,
+                                   const uint8_t* data, uint8_t dlc);
+    typedef Status (*CanControlCallback)(bool start);
+    // Последовательность: EXT, если ID > 0x7FF, как в текстовом "write seq"
+    typedef Status (*SeqStartCallback)(uint32_t id, const uint8_t* data, uint8_t dlc,
+                                       uint32_t count, uint32_t interval_us);
+    typedef Status (*SeqStopCallback)(uint32_t id, bool stop_all);
+    typedef Status (*SeqDataCallback)(uint32_t id, const uint8_t* data, uint8_t dlc);
+    typedef Status (*FilterAddCallback)(uint32_t id, uint32_t mask, bool is_extended);
+    typedef Status (*FilterDelCallback)(uint32_t id, bool delete_all);
+    typedef Status (*StreamControlCallback)(StreamAction action, uint16_t prebuffer);
+    // Сколько кадров поток примет прямо сейчас
+    typedef uint32_t (*StreamSpaceCallback)();
+    // Запись с меткой времени: кадр потока или трассы
+    typedef Status (*RecordCallback)(uint32_t delta_us, uint32_t id, bool is_extended,
+                                     bool is_remote, const uint8_t* data, uint8_t dlc);
+    typedef Status (*TraceClearCallback)();
+    // Сколько записей еще помещается в трассу
+    typedef uint32_t (*TraceSpaceCallback)();
+    // Готовый кадр ответа с обоими разделителями
+    typedef void (*ResponseCallback)(const uint8_t* frame, uint16_t length);
+
+    BinaryProtocol(SendCallback send_cb,
+                   CanControlCallback can_control_cb,
+                   SeqStartCallback seq_start_cb,
+                   SeqStopCallback seq_stop_cb,
+                   SeqDataCallback seq_data_cb,
+                   FilterAddCallback filter_add_cb,
+                   FilterDelCallback filter_del_cb,
+                   StreamControlCallback stream_control_cb,
+                   StreamSpaceCallback stream_space_cb,
+                   RecordCallback stream_push_cb,
+                   RecordCallback trace_add_cb,
+                   TraceClearCallback trace_clear_cb,
+                   TraceSpaceCallback trace_space_cb,
+                   ResponseCallback response_cb);
+
+    // Тело кадра между нулевыми разделителями, еще в COBS.
+    // false - кадр отложен (нет места под поток), повторить позже
+    bool handleFrame(const uint8_t* encoded, uint16_t length);
+
+    uint32_t getRequestCount() const { return request_count_; }
+    uint32_t getNakCount() const { return nak_count_; }
+
+private:
+    // Ответ без COBS: тип, opcode, seq, статус и до 4 доп. байт
+    struct Response {
+        Status status;
+        uint8_t extra[RESPONSE_MAX_SIZE - 5];
+        uint8_t extra_len;
+    };
+
+    uint8_t payload_[MAX_PAYLOAD];
+
+    SendCallback send_callback_;
+    CanControlCallback can_control_callback_;
+    SeqStartCallback seq_start_callback_;
+    SeqStopCallback seq_stop_callback_;
+    SeqDataCallback seq_data_callback_;
+    FilterAddCallback filter_add_callback_;
+    FilterDelCallback filter_del_callback_;
+    StreamControlCallback stream_control_callback_;
+    StreamSpaceCallback stream_space_callback_;
+    RecordCallback stream_push_callback_;
+    RecordCallback trace_add_callback_;
+    TraceClearCallback trace_clear_callback_;
+    TraceSpaceCallback trace_space_callback_;
+    ResponseCallback response_callback_;
+
+    uint32_t request_count_;
+    uint32_t nak_count_;
+
+    void execute(Opcode opcode, const uint8_t* body, uint16_t length, Response& response);
+    Status handleWrite(const uint8_t* body, uint16_t length, Response& response);
+    Status handleWriteSeq(const uint8_t* body, uint16_t length);
+    Status handleSeqData(const uint8_t* body, uint16_t length);
+    Status handleRecords(const uint8_t* body, uint16_t length, Response& response,
+                         RecordCallback record_cb, uint32_t (*space_cb)());
+    bool streamHasRoom(const uint8_t* body, uint16_t length);
+    void respond(uint8_t opcode, uint16_t seq, const Response& response);
+
+    static inline uint32_t getLe32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+};
+
+#endif /* BINARYPROTOCOL_BINARYPROTOCOL_H_ */
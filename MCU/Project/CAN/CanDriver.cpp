@@ -7,9 +7,15 @@
 #include "App.hpp"
 #include "CanDriver.h"
 #include "CanProcessor/CanProcessor.h"
+#include "Timing/Timebase.h"
 #include <cstring>
 
-CanDriver::CanDriver(CAN_HandleTypeDef* can_ptr, Queue_t* queue_ptr) {
+// Оба FIFO: новый кадр, заполнение и аппаратная потеря кадра
+static constexpr uint32_t RX_NOTIFICATIONS =
+		CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO0_FULL | CAN_IT_RX_FIFO0_OVERRUN |
+		CAN_IT_RX_FIFO1_MSG_PENDING | CAN_IT_RX_FIFO1_FULL | CAN_IT_RX_FIFO1_OVERRUN;
+
+CanDriver::CanDriver(CAN_HandleTypeDef* can_ptr, CanMessageRing* queue_ptr) {
 	baudrate_ = 1000;
 	mode_ = CAN_MODE_NORMAL;
 	state_ = State::STOPPED;
@@ -35,6 +41,14 @@ CanDriver::Status CanDriver::start(){
 	}
 	#endif
 
+	// Освободившийся mailbox сразу подхватывает следующий кадр из очереди
+	if (HAL_CAN_ActivateNotification(hcan_, CAN_IT_TX_MAILBOX_EMPTY) != HAL_OK){
+        HAL_CAN_Stop(hcan_);
+        error_count_++;
+        state_ = State::ERROR;
+        return Status::ERROR;
+	}
+
 	state_ = State::ACTIVE;
 	return Status::OK;
 }
@@ -44,6 +58,11 @@ CanDriver::Status CanDriver::stop() {
         return Status::ERROR;
     }
 
+    // Кадры, не ушедшие до остановки, отбрасываются: после смены скорости
+    // или режима они уже не к месту
+    HAL_CAN_AbortTxRequest(hcan_, CAN_TX_MAILBOX0 | CAN_TX_MAILBOX1 | CAN_TX_MAILBOX2);
+    resetTxQueue();
+
     if (HAL_CAN_Stop(hcan_) != HAL_OK) {
         state_ = State::ERROR;
         error_count_++;
@@ -176,32 +195,93 @@ CanDriver::Status CanDriver::sendMessage(uint32_t id, bool is_extended,
         return Status::INVALID_PARAM;
     }
 
-    uint32_t TxMailbox;
-    CAN_TxHeaderTypeDef pHeader;
-    pHeader.DLC = dlc;
-
+    // TIR собирается один раз при постановке: он же ключ приоритета очереди
+    CanTxQueue::Frame frame;
     if (is_extended) {
-        pHeader.IDE = CAN_ID_EXT;
-        pHeader.ExtId = id;
+        frame.tir = ((id & 0x1FFFFFFF) << CAN_TI0R_EXID_Pos) | CAN_ID_EXT;
     } else {
-        pHeader.IDE = CAN_ID_STD;
-        pHeader.StdId = id;
+        frame.tir = (id & 0x7FF) << CAN_TI0R_STID_Pos;
+    }
+    if (is_remote) {
+        frame.tir |= CAN_RTR_REMOTE;
+    }
+    frame.enqueue_us = Timebase::micros32();
+    frame.dlc = dlc;
+    memset(frame.data, 0, sizeof(frame.data));
+    memcpy(frame.data, data, dlc);
+
+    // Отправляют и основной цикл, и прерывание планировщика последовательностей,
+    // а прерывание TX выбирает из той же очереди
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (!tx_queue_.push(frame)) {
+        tx_stats_.dropped++;
+        __set_PRIMASK(primask);
+        return Status::BUSY;
     }
 
-    pHeader.RTR = is_remote ? CAN_RTR_REMOTE : CAN_RTR_DATA;
-    pHeader.TransmitGlobalTime = DISABLE;
-
-    if (HAL_CAN_AddTxMessage(this->hcan_, &pHeader, data, &TxMailbox) != HAL_OK) {
-        state_ = State::ERROR;
-        error_count_++;
-        return Status::ERROR;
+    tx_stats_.enqueued++;
+    if (tx_queue_.size() > tx_stats_.peak) {
+        tx_stats_.peak = tx_queue_.size();
     }
+    fillTxMailboxes();
 
+    __set_PRIMASK(primask);
     return Status::OK;
 }
 
 CanDriver::Status CanDriver::setFilterAcceptAll(uint8_t filter_bank) {
-	return disableFilter(filter_bank, 0);
+	// Один банк на все ID загоняет поток в один FIFO глубиной 3 кадра.
+	// Пара банков делит его по STID[0] (для EXT это бит 18 ID) на оба FIFO.
+	if (filter_bank + 1 >= CAN1_FILTER_BANKS) {
+		return Status::INVALID_PARAM;
+	}
+
+	uint8_t even_bank = filter_bank & ~1;
+	Status status = configureAcceptAllHalf(even_bank, 0);
+	if (status != Status::OK) {
+		return status;
+	}
+
+	status = configureAcceptAllHalf(even_bank + 1, 1);
+	if (status != Status::OK) {
+		return status;
+	}
+
+	accept_all_active_ = true;
+	accept_all_bank_ = even_bank;
+	return Status::OK;
+}
+
+CanDriver::Status CanDriver::configureAcceptAllHalf(uint8_t filter_bank, uint16_t id_lsb) {
+    CAN_FilterTypeDef sFilterConfig;
+
+    sFilterConfig.FilterBank = filter_bank;
+    sFilterConfig.FilterMode = CAN_FILTERMODE_IDMASK;
+    sFilterConfig.FilterScale = CAN_FILTERSCALE_32BIT;
+    sFilterConfig.FilterIdHigh = id_lsb << 5;   // STID[0] - бит 21 регистра
+    sFilterConfig.FilterIdLow = 0x0000;
+    sFilterConfig.FilterMaskIdHigh = 1 << 5;    // Сравниваем только его
+    sFilterConfig.FilterMaskIdLow = 0x0000;
+    sFilterConfig.FilterFIFOAssignment = fifoForBank(filter_bank);
+    sFilterConfig.FilterActivation = ENABLE;
+    sFilterConfig.SlaveStartFilterBank = CAN1_FILTER_BANKS;  // For dual CAN support
+
+    HAL_StatusTypeDef hal_status = HAL_CAN_ConfigFilter(hcan_, &sFilterConfig);
+    return checkHALStatus(hal_status);
+}
+
+void CanDriver::releaseAcceptAll() {
+	// Первый пользовательский фильтр закрывает режим "принимать все",
+	// иначе вторая половина пары продолжала бы пропускать весь трафик
+	if (!accept_all_active_) {
+		return;
+	}
+
+	accept_all_active_ = false;
+	disableFilterBank(accept_all_bank_);
+	disableFilterBank(accept_all_bank_ + 1);
 }
 
 CanDriver::Status CanDriver::setFilterStandardID(uint8_t filter_bank, uint16_t id) {
@@ -214,7 +294,7 @@ CanDriver::Status CanDriver::setFilterStandardID(uint8_t filter_bank, uint16_t i
     sFilterConfig.FilterIdLow = 0x0000;
     sFilterConfig.FilterMaskIdHigh = 0x7FF << 5;  // Mask for 11-bit ID
     sFilterConfig.FilterMaskIdLow = 0x0000;
-    sFilterConfig.FilterFIFOAssignment = CAN_FILTER_FIFO0;
+    sFilterConfig.FilterFIFOAssignment = fifoForBank(filter_bank);
     sFilterConfig.FilterActivation = ENABLE;
     sFilterConfig.SlaveStartFilterBank = 14;  // For dual CAN support
 
@@ -233,7 +313,7 @@ CanDriver::Status CanDriver::setFilterStandardIDWithMask(uint8_t filter_bank, ui
     sFilterConfig.FilterMaskIdHigh = (mask & 0x7FF) << 5;
     sFilterConfig.FilterMaskIdLow = 0x0000;
 
-    sFilterConfig.FilterFIFOAssignment = CAN_FILTER_FIFO0;
+    sFilterConfig.FilterFIFOAssignment = fifoForBank(filter_bank);
     sFilterConfig.FilterActivation = ENABLE;
     sFilterConfig.SlaveStartFilterBank = 14;
 
@@ -254,7 +334,7 @@ CanDriver::Status CanDriver::setFilterExtendedID(uint8_t filter_bank, uint32_t i
     sFilterConfig.FilterIdLow = low16bits << 3;  // Extended ID in bits 3-31
     sFilterConfig.FilterMaskIdHigh = 0xFFFF;
     sFilterConfig.FilterMaskIdLow = 0xFFF8;  // Mask for 29-bit ID (bits 3-31)
-    sFilterConfig.FilterFIFOAssignment = CAN_FILTER_FIFO0;
+    sFilterConfig.FilterFIFOAssignment = fifoForBank(filter_bank);
     sFilterConfig.FilterActivation = ENABLE;
     sFilterConfig.SlaveStartFilterBank = 14;  // For dual CAN support
 
@@ -272,7 +352,7 @@ CanDriver::Status CanDriver::setFilterExtendedIDWithMask(uint8_t filter_bank, ui
     sFilterConfig.FilterIdLow = ((id & 0x1FFF) << 3) | 0x04;
     sFilterConfig.FilterMaskIdHigh = (mask >> 13) & 0xFFFF;
     sFilterConfig.FilterMaskIdLow = ((mask & 0x1FFF) << 3) | 0x04;
-    sFilterConfig.FilterFIFOAssignment = CAN_FILTER_FIFO0;
+    sFilterConfig.FilterFIFOAssignment = fifoForBank(filter_bank);
     sFilterConfig.FilterActivation = ENABLE;
     sFilterConfig.SlaveStartFilterBank = 14;
 
@@ -282,6 +362,8 @@ CanDriver::Status CanDriver::setFilterExtendedIDWithMask(uint8_t filter_bank, ui
 
 CanDriver::Status CanDriver::setFilter(uint8_t filter_bank, uint8_t filter_slot,
                                        uint32_t id, uint32_t mask, bool is_extended) {
+    releaseAcceptAll();
+
     if (is_extended) {
         return setFilterExtendedIDWithMask(filter_bank, id, mask);
     } else {
@@ -289,6 +371,58 @@ CanDriver::Status CanDriver::setFilter(uint8_t filter_bank, uint8_t filter_slot,
     }
 }
 
+CanDriver::Status CanDriver::applyFilterPlan(const FilterBankPlanner::Plan& plan) {
+    if (!hcan_ || plan.bank_count > CAN1_FILTER_BANKS) {
+        return Status::INVALID_PARAM;
+    }
+
+    // HAL_CAN_ConfigFilter открывает и закрывает FINIT на каждый банк,
+    // поэтому регистры пишутся напрямую
+    CAN_TypeDef* can = hcan_->Instance;
+    const uint32_t can1_banks = (1U << CAN1_FILTER_BANKS) - 1;
+    uint32_t list_mode = 0;
+    uint32_t scale_32bit = 0;
+    uint32_t fifo1 = 0;
+    uint32_t active = 0;
+
+    for (uint8_t bank = 0; bank < plan.bank_count; bank++) {
+        const FilterBankPlanner::Bank& config = plan.banks[bank];
+        uint32_t bit = 1U << bank;
+
+        if (config.layout == FilterBankPlanner::Layout::List16 ||
+            config.layout == FilterBankPlanner::Layout::List32) {
+            list_mode |= bit;
+        }
+        if (config.layout == FilterBankPlanner::Layout::List32 ||
+            config.layout == FilterBankPlanner::Layout::Mask32) {
+            scale_32bit |= bit;
+        }
+        if (fifoForBank(bank) == CAN_FILTER_FIFO1) {
+            fifo1 |= bit;
+        }
+        active |= bit;
+    }
+
+    SET_BIT(can->FMR, CAN_FMR_FINIT);
+    MODIFY_REG(can->FMR, CAN_FMR_CAN2SB, CAN1_FILTER_BANKS << CAN_FMR_CAN2SB_Pos);
+    CLEAR_BIT(can->FA1R, can1_banks);
+
+    for (uint8_t bank = 0; bank < plan.bank_count; bank++) {
+        can->sFilterRegister[bank].FR1 = plan.banks[bank].fr1;
+        can->sFilterRegister[bank].FR2 = plan.banks[bank].fr2;
+    }
+
+    MODIFY_REG(can->FM1R, can1_banks, list_mode);
+    MODIFY_REG(can->FS1R, can1_banks, scale_32bit);
+    MODIFY_REG(can->FFA1R, can1_banks, fifo1);
+    SET_BIT(can->FA1R, active);
+    CLEAR_BIT(can->FMR, CAN_FMR_FINIT);
+
+    accept_all_active_ = plan.accept_all;
+    accept_all_bank_ = 0;
+    return Status::OK;
+}
+
 CanDriver::Status CanDriver::disableFilter(uint8_t filter_bank, uint8_t filter_slot) {
     (void)filter_slot;  // В 32-битном режиме не используем слот
 
@@ -304,8 +438,9 @@ CanDriver::Status CanDriver::disableFilter(uint8_t filter_bank, uint8_t filter_s
     sFilterConfig.FilterMaskIdHigh = 0x0000;
     sFilterConfig.FilterMaskIdLow = 0x0000;
 
-    sFilterConfig.FilterFIFOAssignment = CAN_FILTER_FIFO0;
+    sFilterConfig.FilterFIFOAssignment = fifoForBank(filter_bank);
     sFilterConfig.FilterActivation = ENABLE;  // Активируем, но пропускаем все
+    sFilterConfig.SlaveStartFilterBank = CAN1_FILTER_BANKS;
 
     HAL_StatusTypeDef hal_status = HAL_CAN_ConfigFilter(hcan_, &sFilterConfig);
     return checkHALStatus(hal_status);
@@ -321,8 +456,9 @@ CanDriver::Status CanDriver::disableFilterBank(uint8_t filter_bank) {
     sFilterConfig.FilterIdLow = 0x0000;
     sFilterConfig.FilterMaskIdHigh = 0x0000;
     sFilterConfig.FilterMaskIdLow = 0x0000;
-    sFilterConfig.FilterFIFOAssignment = CAN_FILTER_FIFO0;
+    sFilterConfig.FilterFIFOAssignment = fifoForBank(filter_bank);
     sFilterConfig.FilterActivation = DISABLE;  // Деактивируем полностью
+    sFilterConfig.SlaveStartFilterBank = CAN1_FILTER_BANKS;
 
     HAL_StatusTypeDef hal_status = HAL_CAN_ConfigFilter(hcan_, &sFilterConfig);
     return checkHALStatus(hal_status);
@@ -331,9 +467,9 @@ CanDriver::Status CanDriver::disableFilterBank(uint8_t filter_bank) {
 CanDriver::Status CanDriver::disableAllFilters() {
     Status overall_status = Status::OK;
 
-    const uint8_t MAX_FILTER_BANKS = 14;  // Настроить под вашу модель
+    accept_all_active_ = false;
 
-    for (uint8_t bank = 0; bank < MAX_FILTER_BANKS; bank++) {
+    for (uint8_t bank = 0; bank < CAN1_FILTER_BANKS; bank++) {
         Status status = disableFilterBank(bank);
         if (status != Status::OK) {
             overall_status = Status::ERROR;
@@ -347,7 +483,7 @@ CanDriver::Status CanDriver::activateNotification() {
         return Status::ERROR;
     }
 
-    if (HAL_CAN_ActivateNotification(hcan_, CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
+    if (HAL_CAN_ActivateNotification(hcan_, RX_NOTIFICATIONS) != HAL_OK) {
         return Status::ERROR;
     }
 
@@ -359,27 +495,185 @@ CanDriver::Status CanDriver::deactivateNotification() {
         return Status::ERROR;
     }
 
-    if (HAL_CAN_DeactivateNotification(hcan_, CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
+    if (HAL_CAN_DeactivateNotification(hcan_, RX_NOTIFICATIONS) != HAL_OK) {
         return Status::ERROR;
     }
 
     return Status::OK;
 }
 
-void CanDriver::handleRxInterrupt(CAN_HandleTypeDef* hcan) {
-	CAN_RxHeaderTypeDef header;
-	uint8_t data[8];
+void CanDriver::handleRxInterrupt(CAN_HandleTypeDef* hcan, uint32_t rx_fifo) {
+	// Оба FIFO пишут в одно SPSC-кольцо. Это безопасно, пока CAN1_RX0 и
+	// CAN1_RX1 имеют одинаковый приоритет NVIC и не вытесняют друг друга.
+	// Метка времени снимается первой, до любой другой работы
+	uint64_t entry_us = Timebase::micros();
+	uint32_t entry_low = (uint32_t)entry_us;
+	uint32_t start_cycles = CycleCounter::now();
+	uint32_t drained = 0;
+
+	// Биты FMP и RFOM у RF0R и RF1R совпадают по положению
+	volatile uint32_t* rfr = (rx_fifo == CAN_RX_FIFO0) ? &hcan->Instance->RF0R : &hcan->Instance->RF1R;
+	const CAN_FIFOMailBox_TypeDef& mailbox = hcan->Instance->sFIFOMailBox[rx_fifo];
+
+	// Вычитываем все, что накопилось в FIFO, за один вход в прерывание:
+	// пока обрабатывается первый кадр, в mailbox могут прийти еще два
+	while (*rfr & CAN_RF0R_FMP0) {
+		// Кадр читается сразу в слот кольца. Если кольцо полно, FIFO всё равно
+		// нужно освободить, иначе прерывание будет приходить повторно.
+		CanMessage_t* slot = queue_->acquire();
+
+		if (slot != nullptr) {
+			// Своя метка у каждого кадра: пока FIFO вычитывается, приходят новые.
+			// К метке входа прибавляется прошедшее время по младшим 32 битам
+			slot->timestamp_us = entry_us + (uint32_t)(Timebase::micros32() - entry_low);
+			readMailbox(mailbox, *slot);
+			queue_->commit();
+			drained++;
+		}
+
+		// Только RFOM: запись единиц в FULL/FOVR сбросила бы еще не посчитанные флаги
+		*rfr = CAN_RF0R_RFOM0;
+	}
+
+	rx_stats_.frames[rx_fifo] += drained;
+	if (drained > rx_stats_.max_drain) {
+		rx_stats_.max_drain = drained;
+	}
+
+	rx_isr_profile_.record(start_cycles);
+}
+
+void CanDriver::handleFifoFull(uint32_t rx_fifo) {
+	// Все три mailbox заняты: следующий кадр до вычитки будет потерян
+	rx_stats_.full[rx_fifo]++;
+}
+
+void CanDriver::handleErrorInterrupt(CAN_HandleTypeDef* hcan) {
+	if (hcan->ErrorCode & HAL_CAN_ERROR_RX_FOV0) {
+		rx_stats_.overruns[CAN_RX_FIFO0]++;
+	}
+
+	if (hcan->ErrorCode & HAL_CAN_ERROR_RX_FOV1) {
+		rx_stats_.overruns[CAN_RX_FIFO1]++;
+	}
+
+	// Без автоповтора (NART) проигранный арбитраж или ошибка шины
+	// завершают передачу: mailbox свободен, кадр не ушел
+	static const uint32_t TX_ERRORS[TX_MAILBOX_COUNT] = {
+			HAL_CAN_ERROR_TX_ALST0 | HAL_CAN_ERROR_TX_TERR0,
+			HAL_CAN_ERROR_TX_ALST1 | HAL_CAN_ERROR_TX_TERR1,
+			HAL_CAN_ERROR_TX_ALST2 | HAL_CAN_ERROR_TX_TERR2 };
+	uint32_t tx_errors = 0;
+
+	for (uint32_t mailbox = 0; mailbox < TX_MAILBOX_COUNT; mailbox++) {
+		if (hcan->ErrorCode & TX_ERRORS[mailbox]) {
+			releaseTxMailbox(mailbox, false);
+			tx_errors |= TX_ERRORS[mailbox];
+		}
+	}
+	if (tx_errors) {
+		fillTxMailboxes();
+	}
+
+	// Переполнение и ошибки передачи уже посчитаны, остальные коды не трогаем
+	hcan->ErrorCode &= ~(HAL_CAN_ERROR_RX_FOV0 | HAL_CAN_ERROR_RX_FOV1 | tx_errors);
+}
+
+void CanDriver::handleTxInterrupt(uint32_t mailbox, bool ok) {
+	// Прерывания CAN и TIM2 одного приоритета и не вытесняют друг друга,
+	// основной цикл трогает очередь только под запретом прерываний
+	releaseTxMailbox(mailbox, ok);
+	fillTxMailboxes();
+}
+
+void CanDriver::getTxStats(TxStats& stats) const {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	stats = tx_stats_;
+	stats.depth = tx_queue_.size();
+	stats.latency_avg_us = stats.sent ? (uint32_t)(tx_latency_sum_us_ / stats.sent) : 0;
+
+	__set_PRIMASK(primask);
+}
+
+// Грузит голову очереди во все свободные mailbox. Вызывается под запретом
+// прерываний или из прерывания CAN.
+void CanDriver::fillTxMailboxes() {
+	static const uint32_t TME_BITS[TX_MAILBOX_COUNT] = { CAN_TSR_TME0, CAN_TSR_TME1, CAN_TSR_TME2 };
+
+	CAN_TypeDef* can = hcan_->Instance;
+	uint32_t tsr = can->TSR;
+
+	for (uint32_t mailbox = 0; mailbox < TX_MAILBOX_COUNT && !tx_queue_.isEmpty(); mailbox++) {
+		// TME уже стоит, а слот еще занят - завершение ждет своего прерывания.
+		// Запрос передачи сбросил бы RQCP, и прерывание потерялось бы
+		if (tx_slots_[mailbox].busy || !(tsr & TME_BITS[mailbox])) {
+			continue;
+		}
+
+		const CanTxQueue::Frame& frame = tx_queue_.top();
+		for (uint32_t i = 0; i < TX_MAILBOX_COUNT; i++) {
+			if (tx_slots_[i].busy && tx_slots_[i].tir == frame.tir) {
+				return;
+			}
+		}
+
+		CAN_TxMailBox_TypeDef& box = can->sTxMailBox[mailbox];
+		uint32_t tdlr;
+		uint32_t tdhr;
+		memcpy(&tdlr, &frame.data[0], 4);
+		memcpy(&tdhr, &frame.data[4], 4);
+
+		box.TIR = frame.tir;
+		box.TDTR = frame.dlc;
+		box.TDLR = tdlr;
+		box.TDHR = tdhr;
+
+		tx_slots_[mailbox].busy = true;
+		tx_slots_[mailbox].tir = frame.tir;
+		tx_slots_[mailbox].enqueue_us = frame.enqueue_us;
+
+		box.TIR = frame.tir | CAN_TI0R_TXRQ;
+		tx_queue_.pop();
+	}
+}
+
+void CanDriver::releaseTxMailbox(uint32_t mailbox, bool ok) {
+	TxSlot& slot = tx_slots_[mailbox];
+
+	// Отмена при остановке приходит, когда слот уже сброшен
+	if (!slot.busy) {
+		return;
+	}
+	slot.busy = false;
 
-	if (HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO0, &header, data) == HAL_OK) {
-		CanMessage_t msg;
-		msg.timestamp_ms = HAL_GetTick();
-		msg.header = header;
-		memcpy(msg.data, data, header.DLC);
+	if (!ok) {
+		tx_stats_.failed++;
+		return;
+	}
 
-		q_push(this->queue_, &msg);
+	uint32_t latency = Timebase::micros32() - slot.enqueue_us;
+	tx_stats_.sent++;
+	tx_latency_sum_us_ += latency;
+	if (latency > tx_stats_.latency_max_us) {
+		tx_stats_.latency_max_us = latency;
 	}
 }
 
+void CanDriver::resetTxQueue() {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	tx_stats_.dropped += tx_queue_.size();
+	tx_queue_.clear();
+	for (uint8_t i = 0; i < TX_MAILBOX_COUNT; i++) {
+		tx_slots_[i].busy = false;
+	}
+
+	__set_PRIMASK(primask);
+}
+
 CanDriver::Status CanDriver::checkHALStatus(HAL_StatusTypeDef hal_status) {
     switch (hal_status) {
         case HAL_OK:
@@ -400,5 +694,53 @@ CanDriver::Status CanDriver::checkHALStatus(HAL_StatusTypeDef hal_status) {
 }
 
 extern "C" void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef* hcan){
-	sys->can_driver->handleRxInterrupt(hcan);
+	sys->can_driver->handleRxInterrupt(hcan, CAN_RX_FIFO0);
+}
+
+extern "C" void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef* hcan){
+	sys->can_driver->handleRxInterrupt(hcan, CAN_RX_FIFO1);
+}
+
+extern "C" void HAL_CAN_RxFifo0FullCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleFifoFull(CAN_RX_FIFO0);
+}
+
+extern "C" void HAL_CAN_RxFifo1FullCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleFifoFull(CAN_RX_FIFO1);
+}
+
+extern "C" void HAL_CAN_ErrorCallback(CAN_HandleTypeDef* hcan){
+	sys->can_driver->handleErrorInterrupt(hcan);
+}
+
+extern "C" void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleTxInterrupt(0, true);
+}
+
+extern "C" void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleTxInterrupt(1, true);
+}
+
+extern "C" void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleTxInterrupt(2, true);
+}
+
+extern "C" void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleTxInterrupt(0, false);
+}
+
+extern "C" void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleTxInterrupt(1, false);
+}
+
+extern "C" void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef* hcan){
+	(void)hcan;
+	sys->can_driver->handleTxInterrupt(2, false);
 }
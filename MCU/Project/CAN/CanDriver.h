@@ -9,10 +9,14 @@
 #define CAN_CANDRIVER_H_
 
 #include "App.hpp"
-#include "Queue/cQueue.h"
+#include "CanProcessor/CanProcessor.h"
+#include "Timing/IsrProfiler.h"
+#include "FilterManager/FilterBankPlanner.h"
+#include "CanTxQueue.h"
 #include "can.h"
 #include <cstdint>
 #include <cstdbool>
+#include <cstring>
 
 
 class CanDriver {
@@ -32,16 +36,44 @@ public:
 		TIMEOUT = 5,
     };
 
-    CanDriver(CAN_HandleTypeDef* can_ptr, Queue_t* queue_ptr);
+    // Счетчики приема по аппаратным FIFO (индекс = CAN_RX_FIFO0 / CAN_RX_FIFO1)
+    struct RxStats {
+        uint32_t frames[2];     // Вычитано кадров
+        uint32_t full[2];       // FIFO заполнялся целиком (3 из 3 mailbox)
+        uint32_t overruns[2];   // Кадр потерян аппаратно, FIFO не успели вычитать
+        uint32_t max_drain;     // Максимум кадров, вычитанных за одно прерывание
+    };
+
+    // Счетчики программной очереди передачи
+    struct TxStats {
+        uint16_t depth;           // Кадров в очереди сейчас
+        uint16_t peak;            // Максимальная глубина
+        uint32_t enqueued;
+        uint32_t sent;            // Подтверждены контроллером (TXOK)
+        uint32_t dropped;         // Очередь была полна, кадр отброшен
+        uint32_t failed;          // Проигран арбитраж или ошибка шины (без повтора, NART)
+        uint32_t latency_max_us;  // От постановки в очередь до TXOK
+        uint32_t latency_avg_us;
+    };
+
+    static constexpr uint8_t RX_FIFO_COUNT = 2;
+    static constexpr uint8_t TX_MAILBOX_COUNT = 3;
+    static constexpr uint8_t CAN1_FILTER_BANKS = 14;  // Банки 14..27 отданы CAN2
+
+    CanDriver(CAN_HandleTypeDef* can_ptr, CanMessageRing* queue_ptr);
 
     Status start();
     Status stop();
     Status setBaudrate(uint32_t baudrate);
     Status setMode(uint32_t mode);
+
+    // Кадр встает в программную очередь и уходит в mailbox, как только тот
+    // освободится. BUSY - очередь полна, кадр отброшен (состояние не меняется)
     Status sendMessage(uint32_t id, bool is_extended, bool is_remote,
                        uint8_t* data, uint8_t dlc);
 
-    // Фильтры
+    // Фильтры. Четные банки пишут в FIFO0, нечетные - в FIFO1,
+    // "принимать все" занимает пару банков и делит поток по младшему биту ID
     Status setFilterAcceptAll(uint8_t filter_bank);
     Status setFilterStandardID(uint8_t filter_bank, uint16_t id);
     Status setFilterStandardIDWithMask(uint8_t filter_bank, uint16_t id, uint16_t mask);
@@ -50,6 +82,10 @@ public:
     Status setFilter(uint8_t filter_bank, uint8_t filter_slot,
                                            uint32_t id, uint32_t mask, bool is_extended);
 
+    // Перепрограммирует все банки CAN1 по плану за одно окно FINIT:
+    // промежуточных сочетаний старых и новых банков шина не видит
+    Status applyFilterPlan(const FilterBankPlanner::Plan& plan);
+
     Status disableFilter(uint8_t filter_bank, uint8_t filter_slot);
     Status disableFilterBank(uint8_t filter_bank);
     Status disableAllFilters();
@@ -57,7 +93,41 @@ public:
     Status activateNotification();
     Status deactivateNotification();
 
-    void handleRxInterrupt(CAN_HandleTypeDef* hcan);
+    void handleRxInterrupt(CAN_HandleTypeDef* hcan, uint32_t rx_fifo);
+
+    // Разбирает выходной mailbox FIFO прямо в слот кольца: каждый регистр
+    // читается один раз (HAL_CAN_GetRxMessage читает RIR четырежды и данные
+    // побайтно). FIFO не освобождает.
+    static inline void readMailbox(const CAN_FIFOMailBox_TypeDef& mailbox, CanMessage_t& slot) {
+        uint32_t rir  = mailbox.RIR;
+        uint32_t rdtr = mailbox.RDTR;
+        uint32_t rdlr = mailbox.RDLR;
+        uint32_t rdhr = mailbox.RDHR;
+
+        slot.header.IDE = rir & CAN_RI0R_IDE;
+        if (slot.header.IDE == CAN_ID_STD) {
+            slot.header.StdId = (rir & CAN_RI0R_STID) >> CAN_TI0R_STID_Pos;
+        } else {
+            slot.header.ExtId = (rir & (CAN_RI0R_EXID | CAN_RI0R_STID)) >> CAN_RI0R_EXID_Pos;
+        }
+        slot.header.RTR = rir & CAN_RI0R_RTR;
+        slot.header.DLC = (rdtr & CAN_RDT0R_DLC) >> CAN_RDT0R_DLC_Pos;
+        slot.header.FilterMatchIndex = (rdtr & CAN_RDT0R_FMI) >> CAN_RDT0R_FMI_Pos;
+        slot.header.Timestamp = (rdtr & CAN_RDT0R_TIME) >> CAN_RDT0R_TIME_Pos;
+
+        // Байты данных лежат в регистрах little-endian, как и в памяти
+        memcpy(&slot.data[0], &rdlr, 4);
+        memcpy(&slot.data[4], &rdhr, 4);
+    }
+    void handleFifoFull(uint32_t rx_fifo);
+    void handleErrorInterrupt(CAN_HandleTypeDef* hcan);
+
+    // Mailbox освободился: передан (ok) или отменен
+    void handleTxInterrupt(uint32_t mailbox, bool ok);
+
+    const volatile RxStats& getRxStats() const { return rx_stats_; }
+    const IsrProfiler& getRxIsrProfile() const { return rx_isr_profile_; }
+    void getTxStats(TxStats& stats) const;
 
 private:
     Status reconfigureBus();
@@ -67,9 +137,37 @@ private:
     State state_ = State::STOPPED;
     uint32_t error_count_ = 0;
     CAN_HandleTypeDef* hcan_ = nullptr;
-    Queue_t* queue_ = nullptr;
+    CanMessageRing* queue_ = nullptr;
+
+    volatile RxStats rx_stats_ = {};
+    IsrProfiler rx_isr_profile_;
+    bool accept_all_active_ = false;
+    uint8_t accept_all_bank_ = 0;
+
+    // Что лежит в каждом mailbox: кадр с тем же TIR не грузится, пока
+    // предыдущий не ушел - при равных ID bxCAN отдает шину меньшему номеру
+    // mailbox, и порядок отправки перепутался бы
+    struct TxSlot {
+        bool busy;
+        uint32_t tir;
+        uint32_t enqueue_us;
+    };
+
+    CanTxQueue tx_queue_;
+    TxSlot tx_slots_[TX_MAILBOX_COUNT] = {};
+    TxStats tx_stats_ = {};
+    uint64_t tx_latency_sum_us_ = 0;
 
     Status checkHALStatus(HAL_StatusTypeDef hal_status);
+    Status configureAcceptAllHalf(uint8_t filter_bank, uint16_t id_lsb);
+    void releaseAcceptAll();
+    void fillTxMailboxes();
+    void releaseTxMailbox(uint32_t mailbox, bool ok);
+    void resetTxQueue();
+
+    static inline uint32_t fifoForBank(uint8_t filter_bank) {
+        return (filter_bank & 1) ? CAN_FILTER_FIFO1 : CAN_FILTER_FIFO0;
+    }
 };
 
 #endif /* CAN_CANDRIVER_H_ */
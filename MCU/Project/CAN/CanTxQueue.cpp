@@ -0,0 +1,55 @@
+/*
+ * CanTxQueue.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "CanTxQueue.h"
+
+bool CanTxQueue::push(const Frame& frame) {
+    if (size_ >= CAPACITY) {
+        return false;
+    }
+
+    // Просеивание вверх через "дырку": кадр пишется один раз на свое место
+    uint16_t pos = size_++;
+    Frame item = frame;
+    item.order = next_order_++;
+
+    while (pos > 0) {
+        uint16_t parent = (pos - 1) / 2;
+        if (!less(item, heap_[parent])) {
+            break;
+        }
+        heap_[pos] = heap_[parent];
+        pos = parent;
+    }
+    heap_[pos] = item;
+    return true;
+}
+
+void CanTxQueue::pop() {
+    if (size_ == 0) {
+        return;
+    }
+
+    const Frame& last = heap_[--size_];
+    uint16_t pos = 0;
+
+    for (;;) {
+        uint16_t child = 2 * pos + 1;
+        if (child >= size_) {
+            break;
+        }
+        if (child + 1 < size_ && less(heap_[child + 1], heap_[child])) {
+            child++;
+        }
+        if (!less(heap_[child], last)) {
+            break;
+        }
+        heap_[pos] = heap_[child];
+        pos = child;
+    }
+    heap_[pos] = last;
+}
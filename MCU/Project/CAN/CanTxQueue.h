@@ -0,0 +1,58 @@
+/*
+ * CanTxQueue.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef CAN_CANTXQUEUE_H_
+#define CAN_CANTXQUEUE_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Программная очередь передачи перед тремя mailbox bxCAN.
+// Min-куча по значению регистра TIR: поля STID | EXID | IDE | RTR лежат в
+// нем в порядке арбитража на шине, поэтому меньший TIR выигрывает и там
+// (STD data < STD remote < EXT с тем же базовым ID). Кадры с одинаковым
+// TIR уходят в порядке постановки (порядковый номер order).
+// Сама очередь не потокобезопасна - CanDriver вызывает ее под запретом
+// прерываний.
+class CanTxQueue {
+public:
+    static constexpr uint16_t CAPACITY = 128;
+
+    struct Frame {
+        uint32_t tir;          // Готовое значение CAN_TIxR без TXRQ
+        uint32_t order;
+        uint32_t enqueue_us;   // Timebase::micros32() при постановке
+        uint8_t dlc;
+        uint8_t data[8];
+    };
+
+    CanTxQueue() : size_(0), next_order_(0) {}
+
+    // false - очередь полна
+    bool push(const Frame& frame);
+    const Frame& top() const { return heap_[0]; }
+    void pop();
+
+    uint16_t size() const { return size_; }
+    bool isEmpty() const { return size_ == 0; }
+    void clear() { size_ = 0; }
+
+private:
+    Frame heap_[CAPACITY];
+    uint16_t size_;
+    uint32_t next_order_;
+
+    // Номера сравниваются по модулю 2^32, как и дедлайны таймера
+    static inline bool less(const Frame& a, const Frame& b) {
+        if (a.tir != b.tir) {
+            return a.tir < b.tir;
+        }
+        return (int32_t)(a.order - b.order) < 0;
+    }
+};
+
+#endif /* CAN_CANTXQUEUE_H_ */
@@ -19,6 +19,7 @@ public:
     // Конфигурация
     static constexpr uint32_t DEFAULT_BAUDRATE = 500000;  // 500 kbps
     static constexpr uint32_t CALCULATION_WINDOW_MS = 1000;  // Окно расчета 1 секунда
+    static constexpr uint32_t BUCKET_MS = 10;                // Шаг скользящего окна
 
     // Результаты расчета нагрузки
     struct BusLoadResult {
@@ -37,9 +38,10 @@ public:
     void setBaudrate(uint32_t baudrate);
 
     // Добавление сообщений для расчета
-    void addStandardFrame(uint32_t id, uint8_t dlc, bool is_remote = false);
-    void addExtendedFrame(uint32_t id, uint8_t dlc, bool is_remote = false);
-    void addMessage(bool is_extended, uint8_t dlc, bool is_remote = false);
+    // Длина кадра зависит от ID и данных (стаффинг), поэтому нужны они сами
+    void addStandardFrame(uint32_t id, uint8_t dlc, const uint8_t* data, bool is_remote = false);
+    void addExtendedFrame(uint32_t id, uint8_t dlc, const uint8_t* data, bool is_remote = false);
+    void addMessage(bool is_extended, uint32_t id, uint8_t dlc, const uint8_t* data, bool is_remote = false);
 
     // Расчет нагрузки
     BusLoadResult calculateLoad(uint32_t current_time_ms);
@@ -48,27 +50,32 @@ public:
     // Статистика
     uint32_t getTotalMessages() const { return total_messages_; }
     uint32_t getTotalBits() const { return total_bits_; }
+    uint32_t getTotalStuffBits() const { return total_stuff_bits_; }
     uint32_t getErrorCount() const { return error_count_; }
 
     // Утилиты
-    static uint32_t calculateBitsInFrame(bool is_extended, uint8_t dlc, bool is_remote);
+    static uint32_t calculateBitsInFrame(bool is_extended, uint32_t id, uint8_t dlc,
+                                         const uint8_t* data, bool is_remote);
     static float calculateLoadPercentage(uint32_t total_bits, uint32_t time_window_ms, uint32_t baudrate);
 
 private:
-    // Структура для хранения сообщений в окне
-    struct MessageRecord {
-        uint32_t timestamp_ms;
+    // Окно - кольцо корзин по BUCKET_MS с текущими суммами. Добавление кадра
+    // и запрос нагрузки - O(1), память не зависит от частоты кадров.
+    // Последняя корзина заполняется прямо сейчас и в расчет не входит,
+    // поэтому окно всегда ровно CALCULATION_WINDOW_MS завершенных корзин.
+    struct Bucket {
         uint32_t bits;
-
-        MessageRecord() : timestamp_ms(0), bits(0) {}
-        MessageRecord(uint32_t time, uint32_t b) : timestamp_ms(time), bits(b) {}
+        uint32_t frames;
     };
 
-    static constexpr size_t MAX_RECORDS = 1000;  // Максимум записей в истории
+    static constexpr size_t BUCKET_COUNT = CALCULATION_WINDOW_MS / BUCKET_MS + 1;
 
-    MessageRecord message_history_[MAX_RECORDS];
-    size_t history_index_;
-    uint32_t history_count_;
+    Bucket buckets_[BUCKET_COUNT];
+    size_t current_bucket_;      // Индекс заполняемой корзины
+    uint32_t current_slot_;      // Номер интервала BUCKET_MS этой корзины
+    bool window_started_;
+    uint32_t window_bits_;       // Суммы по всем корзинам, включая текущую
+    uint32_t window_frames_;
 
     uint32_t baudrate_;
     uint32_t calculation_window_ms_;
@@ -76,14 +83,13 @@ private:
     // Статистика
     uint32_t total_messages_;
     uint32_t total_bits_;
+    uint32_t total_stuff_bits_;
     uint32_t error_count_;
 
     BusLoadResult last_result_;
 
     // Вспомогательные методы
-    void addToHistory(uint32_t timestamp_ms, uint32_t bits);
-    void cleanupOldRecords(uint32_t current_time_ms);
-    uint32_t calculateBitsInWindow(uint32_t current_time_ms) const;
+    void advanceWindow(uint32_t current_time_ms);
 };
 
 #endif /* CANBUSLOADCALCULATOR_CANBUSLOADCALCULATOR_H_ */
@@ -0,0 +1,193 @@
+/*
+ * CanFrameBits.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "CanFrameBits.h"
+
+// Таблица CRC-15 на байт (без отражения, старший бит первым)
+struct Crc15Table {
+    uint16_t entry[256];
+
+    constexpr Crc15Table() : entry() {
+        for (uint16_t i = 0; i < 256; i++) {
+            uint16_t crc = i << 7;
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x4000) ? (uint16_t)(((crc << 1) ^ CanFrameBits::CRC15_POLY) & 0x7FFF)
+                                     : (uint16_t)((crc << 1) & 0x7FFF);
+            }
+            entry[i] = crc;
+        }
+    }
+};
+
+// Автомат стаффинга. Состояние - последний бит и длина серии (0..4):
+// серия 5 сразу закрывается stuff-битом противоположного уровня,
+// который начинает новую серию длиной 1.
+// STUFF_TABLE[state][byte] = (вставлено бит << 4) | новое состояние.
+static constexpr uint8_t STUFF_STATES = 10;
+
+static constexpr uint8_t stuffState(uint8_t last_bit, uint8_t run) { return last_bit * 5 + run; }
+
+// До SOF шина рецессивна: "последний бит 1, серия 0"
+static constexpr uint8_t STUFF_INITIAL = stuffState(1, 0);
+
+static constexpr uint8_t stuffStep(uint8_t state, uint8_t bit, uint8_t& inserted) {
+    uint8_t last_bit = state / 5;
+    uint8_t run = state % 5;
+
+    if (bit == last_bit) {
+        run++;
+    } else {
+        last_bit = bit;
+        run = 1;
+    }
+
+    if (run == 5) {
+        inserted++;
+        last_bit ^= 1;
+        run = 1;
+    }
+
+    return stuffState(last_bit, run);
+}
+
+struct StuffTable {
+    uint8_t entry[STUFF_STATES][256];
+
+    constexpr StuffTable() : entry() {
+        for (uint8_t state = 0; state < STUFF_STATES; state++) {
+            for (uint16_t byte = 0; byte < 256; byte++) {
+                uint8_t s = state;
+                uint8_t inserted = 0;
+                for (int8_t bit = 7; bit >= 0; bit--) {
+                    s = stuffStep(s, (byte >> bit) & 1, inserted);
+                }
+                entry[state][byte] = (uint8_t)((inserted << 4) | s);
+            }
+        }
+    }
+};
+
+static constexpr Crc15Table CRC15_TABLE;
+static constexpr StuffTable STUFF_TABLE;
+
+// Накопитель бит: старшие биты уходят в поток первыми
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out) : out_(out), acc_(0), acc_bits_(0), bytes_(0) {}
+
+    // bits <= 24
+    inline void put(uint32_t value, uint8_t bits) {
+        acc_ = (acc_ << bits) | (value & ((1UL << bits) - 1));
+        acc_bits_ += bits;
+        while (acc_bits_ >= 8) {
+            acc_bits_ -= 8;
+            out_[bytes_++] = (uint8_t)(acc_ >> acc_bits_);
+        }
+    }
+
+    // Дописывает неполный байт (выравнивание влево), возвращает число бит
+    inline uint16_t finish() {
+        if (acc_bits_ > 0) {
+            out_[bytes_] = (uint8_t)(acc_ << (8 - acc_bits_));
+        }
+        return bytes_ * 8 + acc_bits_;
+    }
+
+private:
+    uint8_t* out_;
+    uint32_t acc_;
+    uint8_t acc_bits_;
+    uint8_t bytes_;
+};
+
+uint16_t CanFrameBits::crc15(const uint8_t* stream, uint16_t bit_count) {
+    uint16_t crc = 0;
+    uint16_t full_bytes = bit_count / 8;
+
+    for (uint16_t i = 0; i < full_bytes; i++) {
+        crc = ((crc << 8) ^ CRC15_TABLE.entry[((crc >> 7) ^ stream[i]) & 0xFF]) & 0x7FFF;
+    }
+
+    // Хвост неполного байта - побитно
+    uint8_t tail = (bit_count & 7) ? stream[full_bytes] : 0;
+    for (uint8_t i = 0; i < (bit_count & 7); i++) {
+        uint8_t bit = (tail >> (7 - i)) & 1;
+        bool xor_poly = bit ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if (xor_poly) {
+            crc ^= CRC15_POLY;
+        }
+    }
+
+    return crc;
+}
+
+uint32_t CanFrameBits::countStuffBits(const uint8_t* stream, uint16_t bit_count) {
+    uint8_t state = STUFF_INITIAL;
+    uint32_t inserted = 0;
+    uint16_t full_bytes = bit_count / 8;
+
+    for (uint16_t i = 0; i < full_bytes; i++) {
+        uint8_t next = STUFF_TABLE.entry[state][stream[i]];
+        inserted += next >> 4;
+        state = next & 0x0F;
+    }
+
+    uint8_t tail = (bit_count & 7) ? stream[full_bytes] : 0;
+    for (uint8_t i = 0; i < (bit_count & 7); i++) {
+        uint8_t tail_inserted = 0;
+        state = stuffStep(state, (tail >> (7 - i)) & 1, tail_inserted);
+        inserted += tail_inserted;
+    }
+
+    return inserted;
+}
+
+uint16_t CanFrameBits::buildStream(bool is_extended, uint32_t id, bool is_remote,
+                                   uint8_t dlc, const uint8_t* data, uint8_t* stream) {
+    BitWriter writer(stream);
+    uint8_t data_bytes = (is_remote || data == nullptr) ? 0 : ((dlc > 8) ? 8 : dlc);
+
+    writer.put(0, 1);  // SOF
+    if (is_extended) {
+        writer.put(id >> 18, 11);           // Base ID
+        writer.put(0b11, 2);                // SRR, IDE (рецессивные)
+        writer.put(id & 0x3FFFF, 18);       // Extended ID
+        writer.put(is_remote ? 1 : 0, 1);   // RTR
+        writer.put(0, 2);                   // r1, r0
+    } else {
+        writer.put(id & 0x7FF, 11);
+        writer.put(is_remote ? 1 : 0, 1);   // RTR
+        writer.put(0, 2);                   // IDE, r0
+    }
+    writer.put(dlc & 0x0F, 4);
+
+    for (uint8_t i = 0; i < data_bytes; i++) {
+        writer.put(data[i], 8);
+    }
+
+    // CRC считается по уже собранной части, затем дописывается в поток
+    BitWriter probe = writer;
+    uint16_t crc_bits = probe.finish();
+    writer.put(crc15(stream, crc_bits), CRC_BITS);
+
+    return writer.finish();
+}
+
+uint32_t CanFrameBits::stuffBits(bool is_extended, uint32_t id, bool is_remote,
+                                 uint8_t dlc, const uint8_t* data) {
+    uint8_t stream[MAX_STREAM_BYTES + 1];
+    uint16_t bits = buildStream(is_extended, id, is_remote, dlc, data, stream);
+    return countStuffBits(stream, bits);
+}
+
+uint32_t CanFrameBits::frameBits(bool is_extended, uint32_t id, bool is_remote,
+                                 uint8_t dlc, const uint8_t* data) {
+    uint8_t stream[MAX_STREAM_BYTES + 1];
+    uint16_t bits = buildStream(is_extended, id, is_remote, dlc, data, stream);
+    return bits + countStuffBits(stream, bits) + TRAILER_BITS;
+}
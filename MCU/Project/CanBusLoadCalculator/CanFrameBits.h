@@ -0,0 +1,55 @@
+/*
+ * CanFrameBits.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef CANBUSLOADCALCULATOR_CANFRAMEBITS_H_
+#define CANBUSLOADCALCULATOR_CANFRAMEBITS_H_
+
+#include <cstdint>
+
+// Точная длина классического CAN-кадра на шине с учетом бит-стаффинга.
+// Кадр собирается в битовый поток, CRC-15 и число вставленных бит считаются
+// по таблицам побайтно - дешево настолько, чтобы считать каждый кадр на 1 Мбит/с.
+class CanFrameBits {
+public:
+    static constexpr uint16_t CRC15_POLY = 0x4599;
+
+    // Поля от SOF до данных, без stuff-бит
+    static constexpr uint8_t STD_HEADER_BITS = 1 + 11 + 1 + 1 + 1 + 4;       // SOF ID RTR IDE r0 DLC
+    static constexpr uint8_t EXT_HEADER_BITS = 1 + 11 + 1 + 1 + 18 + 1 + 2 + 4; // SOF ID SRR IDE ID RTR r1 r0 DLC
+    static constexpr uint8_t CRC_BITS        = 15;
+    // Не стаффятся: CRC delimiter, ACK slot, ACK delimiter, EOF, IFS
+    static constexpr uint8_t TRAILER_BITS    = 1 + 1 + 1 + 7 + 3;
+    static constexpr uint8_t MAX_STREAM_BYTES = (EXT_HEADER_BITS + 64 + CRC_BITS + 7) / 8;
+
+    // Полная длина кадра в битах, включая межкадровый интервал
+    static uint32_t frameBits(bool is_extended, uint32_t id, bool is_remote,
+                              uint8_t dlc, const uint8_t* data);
+
+    // Только вставленные stuff-биты (для статистики)
+    static uint32_t stuffBits(bool is_extended, uint32_t id, bool is_remote,
+                              uint8_t dlc, const uint8_t* data);
+
+    // Длина без stuff-бит (минимально возможная для такого кадра)
+    static constexpr uint32_t nominalBits(bool is_extended, bool is_remote, uint8_t dlc) {
+        return (is_extended ? EXT_HEADER_BITS : STD_HEADER_BITS)
+             + (is_remote ? 0 : ((dlc > 8) ? 8 : dlc) * 8)
+             + CRC_BITS + TRAILER_BITS;
+    }
+
+    // CRC-15 CAN по первым bit_count битам потока (старший бит байта - первый)
+    static uint16_t crc15(const uint8_t* stream, uint16_t bit_count);
+
+    // Число stuff-бит для потока из bit_count бит
+    static uint32_t countStuffBits(const uint8_t* stream, uint16_t bit_count);
+
+private:
+    // Собирает SOF..CRC, возвращает число бит
+    static uint16_t buildStream(bool is_extended, uint32_t id, bool is_remote,
+                                uint8_t dlc, const uint8_t* data, uint8_t* stream);
+};
+
+#endif /* CANBUSLOADCALCULATOR_CANFRAMEBITS_H_ */
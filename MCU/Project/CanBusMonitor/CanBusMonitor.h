@@ -8,25 +8,31 @@
 #define CANBUSMONITOR_CANBUSMONITOR_H_
 
 #include "CanBusLoadCalculator/CanBusLoadCalculator.h"
-#include "usbd_cdc_if.h"
+#include "main.h"
 #include <cstdio>
+#include <cstring>
 
 class CanBusMonitor {
+public:
+    typedef void (*OutputCallback)(const uint8_t* data, uint16_t length);
+
 private:
+    OutputCallback output_callback_;
     CanBusLoadCalculator load_calculator_;
     uint32_t last_print_time_;
     bool monitoring_enabled_;
 
 public:
-    CanBusMonitor(uint32_t baudrate = 1000000)
-        : load_calculator_(baudrate),
+    CanBusMonitor(OutputCallback output_cb, uint32_t baudrate = 1000000)
+        : output_callback_(output_cb),
+          load_calculator_(baudrate),
           last_print_time_(0),
           monitoring_enabled_(false) {}
 
-    void onMessageReceived(bool is_extended, uint32_t dlc, uint32_t is_rtr) {
+    void onMessageReceived(bool is_extended, uint32_t id, uint8_t dlc, const uint8_t* data, bool is_rtr) {
         if (!monitoring_enabled_) return;
 
-        load_calculator_.addMessage(is_extended, dlc, is_rtr);
+        load_calculator_.addMessage(is_extended, id, dlc, data, is_rtr);
     }
 
     void update(uint32_t current_time_ms) {
@@ -61,7 +67,11 @@ public:
 
 private:
     void printBusLoad(const CanBusLoadCalculator::BusLoadResult& result) {
-        char buffer[256];
+        char buffer[320];
+
+        uint32_t total_bits = load_calculator_.getTotalBits();
+        float stuff_share = (total_bits != 0)
+                ? (load_calculator_.getTotalStuffBits() * 100.0f) / total_bits : 0.0f;
 
         snprintf(buffer, sizeof(buffer),
                 "\r\n=== CAN Bus Load ===\r\n"
@@ -69,6 +79,7 @@ private:
                 "Actual rate: %u bps\r\n"
                 "Messages:    %u in last second\r\n"
                 "Bits:        %u / %u max\r\n"
+                "Stuff bits:  %.1f%% of all bits\r\n"
                 "Time:        %u ms\r\n"
                 "=====================\r\n",
                 result.load_percentage,
@@ -76,9 +87,12 @@ private:
                 result.message_count,
                 result.total_bits,
                 result.max_possible_bits,
+                stuff_share,
                 result.timestamp_ms);
 
-        CDC_Transmit_FS((uint8_t*)buffer, strlen(buffer));
+        if (output_callback_) {
+            output_callback_((uint8_t*)buffer, strlen(buffer));
+        }
     }
 };
 
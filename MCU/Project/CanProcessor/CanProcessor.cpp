@@ -5,50 +5,155 @@
  *      Author: Dmitry
  */
 #include "CanProcessor.h"
+#include "Timing/CycleCounter.h"
 
-CanProcessor::CanProcessor(usbOutputCallback usb_cb, Queue_t *queue, CanBusMonitor *monitor, Led *led_ptr)
+CanProcessor::CanProcessor(FrameFormatCallback format_cb, BatchFlushCallback flush_cb,
+						   OutputReserveCallback reserve_cb, OutputCommitCallback commit_cb,
+						   CanMessageRing *queue, CanBusMonitor *monitor, IdStatsTable *id_stats,
+						   SoftwareFilter *soft_filter, Led *led_ptr)
 			: state_(State::Idle),
 			  processed_count_(0),
 			  error_count_(0),
 			  queue_ (queue),
-			  usb_callback_ (usb_cb),
+			  format_callback_ (format_cb),
+			  flush_callback_ (flush_cb),
+			  reserve_callback_ (reserve_cb),
+			  commit_callback_ (commit_cb),
 			  bus_monitor_(monitor),
-			  led_(led_ptr){
-	q_init(queue_, sizeof(CanMessage_t), CAN_MSSG_QUEUE_SIZE, FIFO, false);
+			  id_stats_(id_stats),
+			  soft_filter_(soft_filter),
+			  led_(led_ptr),
+			  batch_config_{DEFAULT_BATCH_FRAMES, DEFAULT_BATCH_BUDGET_US},
+			  frame_output_(true),
+			  output_dropped_count_(0),
+			  soft_filtered_count_(0),
+			  rate_window_start_ms_(0),
+			  rate_window_frames_(0),
+			  frames_per_second_(0),
+			  max_batch_frames_(0){
 	state_ = State::Running;
 }
 
-CanProcessor::Status CanProcessor::processMessage() {
-	CanMessage_t dequed_can_message;
-	if (q_pop(queue_, &dequed_can_message)){
-		if (state_ != State::Running) {
-	        return CanProcessor::Status::Error;
-	    }
+CanProcessor::Status CanProcessor::processBatch() {
+	if (state_ != State::Running) {
+		return CanProcessor::Status::Error;
+	}
+
+	uint32_t start_cycles = CycleCounter::now();
+	uint32_t budget_cycles = CycleCounter::microsToCycles(batch_config_.budget_us);
+	uint16_t frames = 0;
+	CanProcessor::Status status = CanProcessor::Status::Ok;
+
+	while (frames < batch_config_.max_frames) {
+		if (budget_cycles != 0 && CycleCounter::elapsed(start_cycles) >= budget_cycles) {
+			status = CanProcessor::Status::Timeout;
+			break;
+		}
+
+		// Кадр обрабатывается прямо в слоте кольца, без промежуточных копий
+		CanMessage_t* msg = queue_->peek();
+		if (msg == nullptr) {
+			break;
+		}
 
-	    auto validation_status = validateMessage(dequed_can_message);
-	    if (validation_status != CanProcessor::Status::Ok) {
-	    	error_count_++;
-	    	return validation_status;
-	    }
+		if (validateMessage(*msg) != CanProcessor::Status::Ok) {
+			error_count_++;
+			queue_->release();
+			continue;
+		}
 
-	    led_->flashOnRx();
+		bool is_extended = (msg->header.IDE == CAN_ID_EXT);
+		bool is_remote = (msg->header.RTR == CAN_RTR_REMOTE);
+		uint32_t id = is_extended ? msg->header.ExtId : msg->header.StdId;
 
-	    CanMessage_t msg_copy = dequed_can_message;
+		// Программный фильтр решает только про вывод: нагрузка шины и
+		// статистика по ID считаются по всем кадрам, прошедшим банки
+		if (!soft_filter_->accepts(is_extended, id)) {
+			soft_filtered_count_++;
+		}
+		else if (frame_output_ && format_callback_ && !emitFrame(*msg)) {
+			// Хост не успевает забирать данные: кадр теряется только для вывода,
+			// статистика шины по нему все равно считается
+			output_dropped_count_++;
+			status = CanProcessor::Status::BufferFull;
+		}
 
-	    if (usb_callback_) {
-	    	uint32_t data_size = dequed_can_message.header.DLC;
+		bus_monitor_->onMessageReceived(is_extended, id, msg->header.DLC, msg->data, is_remote);
+
+		// Периоды считаются по младшим 32 битам метки (переполнение раз в ~71 мин)
+		id_stats_->update(is_extended, id, msg->header.DLC, msg->data, is_remote,
+						  (uint32_t)msg->timestamp_us);
+
+		queue_->release();
+		frames++;
+	}
 
-	    	usb_callback_(msg_copy, data_size);
-	    }
+	if (frames > 0) {
+		led_->flashOnRx();
+		processed_count_ += frames;
 
-		bool is_extended = (msg_copy.header.IDE == CAN_ID_EXT);
-		bus_monitor_->onMessageReceived(is_extended, msg_copy.header.DLC,  (msg_copy.header.RTR == CAN_RTR_REMOTE));
+		if (frames > max_batch_frames_) {
+			max_batch_frames_ = frames;
+		}
+	}
+
+	// Резерв - только под придержанный пакет: в текстовых режимах и при
+	// пустом пакете кольцо передачи не трогаем. Не влез - ждет следующего прохода
+	if (flush_callback_ && reserve_callback_) {
+		uint16_t pending = flush_callback_(nullptr, 0);
+		if (pending != 0) {
+			uint8_t* out = reserve_callback_(pending);
+			if (out != nullptr) {
+				commit_callback_(flush_callback_(out, pending));
+			}
+		}
+	}
+
+	updateRate(frames, HAL_GetTick());
+
+	return status;
+}
 
-	    processed_count_++;
-	    return CanProcessor::Status::Ok;
+bool CanProcessor::emitFrame(const CanMessage_t& msg) {
+	if (reserve_callback_ == nullptr) {
+		return false;
 	}
 
-	return CanProcessor::Status::Ok;
+	// Сначала без буфера: бинарный поток резервирует место только под кадр,
+	// который заполняет пакет, остальные просто ложатся в пакет
+	uint16_t needed = format_callback_(msg, nullptr, 0);
+	if (needed == 0) {
+		return true;
+	}
+
+	uint8_t* out = reserve_callback_(needed);
+	if (out == nullptr) {
+		return false;
+	}
+
+	commit_callback_(format_callback_(msg, out, needed));
+	return true;
+}
+
+bool CanProcessor::setBatchConfig(uint16_t max_frames, uint32_t budget_us) {
+	if (max_frames == 0 || max_frames > MAX_BATCH_FRAMES) {
+		return false;
+	}
+
+	batch_config_.max_frames = max_frames;
+	batch_config_.budget_us = budget_us;
+	return true;
+}
+
+void CanProcessor::updateRate(uint32_t frames, uint32_t current_time_ms) {
+	rate_window_frames_ += frames;
+
+	uint32_t window_ms = current_time_ms - rate_window_start_ms_;
+	if (window_ms >= 1000) {
+		frames_per_second_ = (rate_window_frames_ * 1000) / window_ms;
+		rate_window_frames_ = 0;
+		rate_window_start_ms_ = current_time_ms;
+	}
 }
 
 CanProcessor::Status CanProcessor::validateMessage(const CanMessage_t& msg) {
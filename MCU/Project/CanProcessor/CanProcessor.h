@@ -10,19 +10,33 @@
 
 #include "can.h"
 #include "CanProcessor/CanProcessor.h"
-#include "Queue/cQueue.h"
+#include "Queue/SpscRing.hpp"
 #include "CanBusMonitor/CanBusMonitor.h"
+#include "IdStatsTable/IdStatsTable.h"
+#include "SoftwareFilter/SoftwareFilter.h"
 #include "LED/LED.h"
 
-#define CAN_MSSG_QUEUE_SIZE 100
+#define CAN_MSSG_QUEUE_SIZE 128 // Должен быть степенью двойки
 
 typedef struct {
-    uint32_t timestamp_ms;
+    uint64_t timestamp_us;   // Timebase::micros() на входе в прерывание приема
     CAN_RxHeaderTypeDef header;
     uint8_t data[8];
 } CanMessage_t;
 
-typedef void (*usbOutputCallback)(CanMessage_t& msg, uint32_t size);
+typedef SpscRing<CanMessage_t, CAN_MSSG_QUEUE_SIZE> CanMessageRing;
+
+// Форматирует один кадр в buffer, возвращает число записанных байт (0 - не влез).
+// С buffer == nullptr: 0 - кадр принят без вывода (форматтер придержал его),
+// иначе кадр не тронут и возвращается место, которое надо зарезервировать
+typedef uint16_t (*FrameFormatCallback)(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size);
+// Дописывает то, что форматтер придержал (незаполненный пакет), в конец прохода.
+// С buffer == nullptr только сообщает, сколько места нужно (0 - дописывать нечего)
+typedef uint16_t (*BatchFlushCallback)(uint8_t* buffer, uint16_t buffer_size);
+// Резервирует место под кадр прямо в буфере передачи (nullptr - места нет)
+typedef uint8_t* (*OutputReserveCallback)(uint16_t length);
+// Публикует length байт из последнего резерва
+typedef void (*OutputCommitCallback)(uint16_t length);
 
 class CanProcessor {
 public:
@@ -43,25 +57,69 @@ public:
         Paused
     };
 
-    CanProcessor(usbOutputCallback usb_cb, Queue_t *queue, CanBusMonitor *monitor, Led *led_ptr);
+    // Конфигурация пакетной выборки
+    struct BatchConfig {
+        uint16_t max_frames;   // Максимум кадров за один проход superloop
+        uint32_t budget_us;    // Бюджет времени на проход (0 - без ограничения)
+    };
+
+    static constexpr uint16_t DEFAULT_BATCH_FRAMES    = 32;
+    static constexpr uint32_t DEFAULT_BATCH_BUDGET_US = 500;
+    static constexpr uint16_t MAX_BATCH_FRAMES        = CAN_MSSG_QUEUE_SIZE;
+
+    CanProcessor(FrameFormatCallback format_cb, BatchFlushCallback flush_cb,
+                 OutputReserveCallback reserve_cb, OutputCommitCallback commit_cb,
+                 CanMessageRing *queue, CanBusMonitor *monitor, IdStatsTable *id_stats,
+                 SoftwareFilter *soft_filter, Led *led_ptr);
     ~CanProcessor();
 
+    // Выбирает до max_frames кадров (или пока не кончится бюджет времени)
+    // и форматирует каждый сразу в буфер передачи, без промежуточной копии
+    CanProcessor::Status processBatch();
 
-    CanProcessor::Status processMessage();
+    // Выключает покадровый вывод (режим "read changes" выводит сводку сам),
+    // статистика и нагрузка при этом продолжают считаться
+    void setFrameOutput(bool enable) { frame_output_ = enable; }
+
+    bool setBatchConfig(uint16_t max_frames, uint32_t budget_us);
+    const BatchConfig& getBatchConfig() const { return batch_config_; }
 
     State getState() const { return (CanProcessor::State)state_; }
     uint32_t getErrorCount() const { return error_count_; }
+    uint32_t getProcessedCount() const { return processed_count_; }
+    uint32_t getFramesPerSecond() const { return frames_per_second_; }
+    uint32_t getMaxBatchFrames() const { return max_batch_frames_; }
+    uint32_t getOutputDroppedCount() const { return output_dropped_count_; }
+    uint32_t getSoftFilteredCount() const { return soft_filtered_count_; }
 
 private:
     State state_;
     uint32_t processed_count_;
     uint32_t error_count_;
-    Queue_t *queue_;
-    usbOutputCallback usb_callback_;
+    CanMessageRing *queue_;
+    FrameFormatCallback format_callback_;
+    BatchFlushCallback flush_callback_;
+    OutputReserveCallback reserve_callback_;
+    OutputCommitCallback commit_callback_;
     CanBusMonitor *bus_monitor_;
+    IdStatsTable *id_stats_;
+    SoftwareFilter *soft_filter_;
     Led *led_;
 
+    BatchConfig batch_config_;
+    bool frame_output_;
+    uint32_t output_dropped_count_;   // Кадры, для которых не нашлось места в буфере передачи
+    uint32_t soft_filtered_count_;    // Кадры, отсеянные программным фильтром
+
+    // Статистика пропускной способности
+    uint32_t rate_window_start_ms_;
+    uint32_t rate_window_frames_;
+    uint32_t frames_per_second_;
+    uint32_t max_batch_frames_;
+
     CanProcessor::Status validateMessage(const CanMessage_t& msg);
+    bool emitFrame(const CanMessage_t& msg);
+    void updateRate(uint32_t frames, uint32_t current_time_ms);
 };
 
 #endif /* CANPROCESSOR_CANPROCESSOR_H_ */
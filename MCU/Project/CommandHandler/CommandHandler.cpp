@@ -10,12 +10,14 @@
 #include <cctype>
 #include <cstdlib>
 
-CommandHandler::CommandHandler(Queue_t *queue_ptr)
+CommandHandler::CommandHandler(Queue_t *queue_ptr, BinaryFrameCallback binary_cb)
     : cursor_(0),
       processed_count_(0),
       error_count_(0),
       initialized_(false),
-	  command_queue_(queue_ptr){
+	  command_queue_(queue_ptr),
+	  binary_frame_(false),
+	  binary_callback_(binary_cb){
 
 	q_init(command_queue_, sizeof(Command), QUEUE_SIZE, FIFO, true);
 
@@ -27,6 +29,20 @@ CommandHandler::CommandHandler(Queue_t *queue_ptr)
 CommandHandler::Result CommandHandler::processByte(uint8_t byte){
 	if (!initialized_) return Result::InvalidCommand;
 
+	if (binary_frame_) {
+		return processBinaryByte(byte);
+	}
+
+	// В тексте нулевых байт не бывает - это начало двоичного кадра
+	if (byte == 0x00) {
+		if (cursor_ > 0) {
+			cursor_ = 0;
+			error_count_++;
+		}
+		binary_frame_ = true;
+		return Result::OK;
+	}
+
 	if (byte == '\n' || byte == '\r'){
 		if (cursor_ > 0) {
 			if (cursor_ < BUFFER_SIZE){
@@ -45,6 +61,35 @@ CommandHandler::Result CommandHandler::processByte(uint8_t byte){
 	return Result::OK;
 }
 
+CommandHandler::Result CommandHandler::processBinaryByte(uint8_t byte) {
+	if (byte != 0x00) {
+		addByteToBuffer(byte);
+		return Result::OK;
+	}
+
+	// Пустой кадр - лишний разделитель, ждем тело дальше
+	if (cursor_ == 0) {
+		return Result::OK;
+	}
+
+	if (binary_callback_ == nullptr) {
+		cursor_ = 0;
+		binary_frame_ = false;
+		error_count_++;
+		return Result::InvalidCommand;
+	}
+
+	// Кадр остается в буфере до повтора с тем же завершающим нулем
+	if (!binary_callback_(rx_buffer_, cursor_)) {
+		return Result::Busy;
+	}
+
+	cursor_ = 0;
+	binary_frame_ = false;
+	processed_count_++;
+	return Result::OK;
+}
+
 CommandHandler::Result CommandHandler::processBuffer(const uint8_t* buffer, uint16_t length) {
 	if (!initialized_ || buffer == nullptr || length == 0) {
         return Result::InvalidCommand;
@@ -54,6 +99,12 @@ CommandHandler::Result CommandHandler::processBuffer(const uint8_t* buffer, uint
 
     for (uint16_t i = 0; i < length; i++) {
         Result byte_result = processByte(buffer[i]);
+        if (byte_result == Result::Busy) {
+            // В прерывании ждать некогда - кадр теряется
+            cursor_ = 0;
+            binary_frame_ = false;
+            error_count_++;
+        }
         if (byte_result != Result::OK) {
             result = byte_result;
         }
@@ -62,6 +113,43 @@ CommandHandler::Result CommandHandler::processBuffer(const uint8_t* buffer, uint
     return result;
 }
 
+void CommandHandler::receive(const uint8_t* buffer, uint32_t length) {
+	uint32_t start_cycles = CycleCounter::now();
+
+#ifdef COMMAND_PARSE_IN_ISR
+	processBuffer(buffer, length);
+#else
+	rx_ring_.write(buffer, length);
+#endif
+
+	rx_isr_profile_.record(start_cycles);
+}
+
+void CommandHandler::poll() {
+	uint8_t commands = 0;
+
+	for (uint16_t i = 0; i < POLL_BYTE_BUDGET; i++) {
+		uint8_t* byte = rx_ring_.peek();
+		if (byte == nullptr) {
+			break;
+		}
+
+		uint8_t c = *byte;
+		bool command_end = cursor_ > 0 &&
+				(binary_frame_ ? c == 0x00 : (c == '\n' || c == '\r'));
+
+		if (processByte(c) == Result::Busy) {
+			break;
+		}
+		rx_ring_.release();
+
+		// Остаток кольца подождет следующей итерации, чтобы не задерживать прием CAN
+		if (command_end && ++commands >= POLL_COMMAND_BUDGET) {
+			break;
+		}
+	}
+}
+
 void CommandHandler::addByteToBuffer(uint8_t byte) {
     if (cursor_ >= BUFFER_SIZE) {
         cursor_ = 0;
@@ -82,7 +170,7 @@ CommandHandler::Result CommandHandler::completeCommand() {
     	rx_buffer_[BUFFER_SIZE - 1] = '\0';
 
     Command cmd;
-    CommandHandler::Result parse_result = parseCommand((const char*)rx_buffer_, &cmd);
+    CommandHandler::Result parse_result = parseCommand((char*)rx_buffer_, &cmd);
 
     if (parse_result != Result::OK) {
         cursor_ = 0;
@@ -115,137 +203,152 @@ void CommandHandler::clearBuffer() {
     memset(rx_buffer_, 0, BUFFER_SIZE);
 }
 
-CommandHandler::Result CommandHandler::parseCommand(const char* command_str, Command* cmd) {
+// Таблица команд. Новая команда - новая строка: путь из 1..3 слов,
+// минимум токенов в строке и разбор аргументов (nullptr - аргументов нет).
+// Из подходящих путей выигрывает самый длинный: "write seq" раньше "write".
+constexpr CommandHandler::CommandSpec CommandHandler::COMMANDS[] = {
+    // path              type                 min  parse
+    { "can start",       CMD_CAN_START,        2,  nullptr },
+    { "can stop",        CMD_CAN_STOP,         2,  nullptr },
+    { "can info",        CMD_CAN_INFO,         2,  nullptr },
+    { "can stats",       CMD_CAN_STATS,        2,  nullptr },
+    { "can bench",       CMD_CAN_BENCH,        2,  nullptr },
+    { "can batch",       CMD_CAN_BATCH,        4,  &CommandHandler::parseCanBatch },
+
+    { "filter add",      CMD_FILTER_ADD,       3,  &CommandHandler::parseFilterAdd },
+    { "filter del",      CMD_FILTER_DEL,       3,  &CommandHandler::parseFilterDel },
+    { "filter list",     CMD_FILTER_LIST,      2,  nullptr },
+    { "filter load",     CMD_FILTER_LOAD,      2,  &CommandHandler::parseFilterLoad },
+    { "filter sw add",   CMD_SW_FILTER_ADD,    4,  &CommandHandler::parseSwFilterAdd },
+    { "filter sw del",   CMD_SW_FILTER_DEL,    4,  &CommandHandler::parseSwFilterDel },
+    { "filter sw list",  CMD_SW_FILTER_LIST,   3,  nullptr },
+
+    { "write",           CMD_WRITE,            3,  &CommandHandler::parseWrite },
+    { "write seq",       CMD_WRITE_SEQ,        6,  &CommandHandler::parseWriteSeq },
+
+    { "seq list",        CMD_SEQ_LIST,         2,  nullptr },
+    { "seq stop",        CMD_SEQ_STOP,         3,  &CommandHandler::parseSeqStop },
+    { "seq data",        CMD_SEQ_DATA,         4,  &CommandHandler::parseSeqData },
+
+    { "replay status",   CMD_REPLAY_STATUS,    2,  nullptr },
+    { "replay stop",     CMD_REPLAY_STOP,      2,  nullptr },
+
+    { "trace add",       CMD_TRACE_ADD,        5,  &CommandHandler::parseTraceAdd },
+    { "trace clear",     CMD_TRACE_CLEAR,      2,  nullptr },
+    { "trace play",      CMD_TRACE_PLAY,       2,  &CommandHandler::parseTracePlay },
+    { "trace pause",     CMD_TRACE_PAUSE,      2,  nullptr },
+    { "trace resume",    CMD_TRACE_RESUME,     2,  nullptr },
+    { "trace stop",      CMD_TRACE_STOP,       2,  nullptr },
+    { "trace status",    CMD_TRACE_STATUS,     2,  nullptr },
+
+    { "read raw",        CMD_READ_RAW,         2,  nullptr },
+    { "read parsed",     CMD_READ_PARSED,      2,  nullptr },
+    { "read binary",     CMD_READ_BINARY,      2,  nullptr },
+    { "read changes",    CMD_READ_CHANGES,     2,  &CommandHandler::parseReadChanges },
+    { "read color on",   CMD_READ_COLOR_ON,    3,  nullptr },
+    { "read color off",  CMD_READ_COLOR_OFF,   3,  nullptr },
+
+    { "stats",           CMD_STATS,            1,  &CommandHandler::parseStats },
+    { "stats reset",     CMD_STATS_RESET,      2,  nullptr },
+
+    { "bus load on",     CMD_BUS_LOAD_ON,      3,  nullptr },
+    { "bus load off",    CMD_BUS_LOAD_OFF,     3,  nullptr },
+    { "bus load status", CMD_BUS_LOAD_STATUS,  3,  nullptr },
+};
+
+constexpr CommandTable::PerfectHash<CommandHandler::COMMAND_HASH_BITS> CommandHandler::COMMAND_HASH =
+        CommandTable::build<CommandHandler::COMMAND_HASH_BITS>(CommandHandler::COMMANDS);
+
+CommandHandler::Result CommandHandler::parseCommand(char* line, Command* cmd) {
     if (!cmd) return Result::ParseError;
 
     memset(cmd, 0, sizeof(Command));
 
-    char tokens[MAX_TOKENS][TOKEN_SIZE] = {0};
-    int token_count = tokenize(command_str, tokens);
+    Token tokens[MAX_TOKENS];
+    int token_count = tokenize(line, tokens);
 
     if (token_count == 0) {
         return Result::InvalidCommand;
     }
 
-    // Определяем тип команды
-    if (strcmp(tokens[0], "can") == 0) {
-        if (token_count < 2) {
-            return Result::InvalidCommand;
-        }
+    const CommandSpec* spec = findCommand(tokens, token_count);
+    if (spec == nullptr || token_count < spec->min_tokens) {
+        return Result::InvalidCommand;
+    }
 
-        if (strcmp(tokens[1], "start") == 0) {
-            cmd->type = CMD_CAN_START;
-            return Result::OK;
-        }
-        else if (strcmp(tokens[1], "stop") == 0) {
-            cmd->type = CMD_CAN_STOP;
-            return Result::OK;
-        }
-        else if (strcmp(tokens[1], "info") == 0) {
-            cmd->type = CMD_CAN_INFO;
-            return Result::OK;
-        }
+    cmd->type = spec->type;
+    if (spec->parse == nullptr) {
+        return Result::OK;
     }
-    else if (strcmp(tokens[0], "filter") == 0) {
-        if (token_count < 2) {
-            return Result::InvalidCommand;
-        }
+    return (this->*spec->parse)(tokens, token_count, cmd);
+}
 
-        if (strcmp(tokens[1], "add") == 0) {
-            return parseFilterAdd(tokens, token_count, cmd);
-        }
-        else if (strcmp(tokens[1], "del") == 0) {
-            cmd->type = CMD_FILTER_DEL;
+const CommandHandler::CommandSpec* CommandHandler::findCommand(const Token* tokens, int token_count) {
+    static_assert(COMMAND_HASH.valid, "No perfect hash seed for the command table");
 
-            if (token_count < 3) {
-                return Result::InvalidCommand;
-            }
+    // Хеши префиксов из 1, 2 и 3 токенов считаются за один проход
+    uint32_t prefix_hash[MAX_PATH_TOKENS];
+    int depth = (token_count < MAX_PATH_TOKENS) ? token_count : MAX_PATH_TOKENS;
+    uint32_t hash = CommandTable::hashStart(COMMAND_HASH.seed);
 
-            if (strcmp(tokens[2], "all") == 0) {
-                cmd->params.filter.delete_all = true;
-            } else {
-                cmd->params.filter.delete_all = false;
-                cmd->params.filter.id = parseHex(tokens[2]);
-            }
-            return Result::OK;
+    for (int i = 0; i < depth; i++) {
+        if (i > 0) {
+            hash = CommandTable::hashByte(hash, ' ');
         }
-        else if (strcmp(tokens[1], "list") == 0) {
-            cmd->type = CMD_FILTER_LIST;
-            return Result::OK;
+        for (uint16_t j = 0; j < tokens[i].len; j++) {
+            hash = CommandTable::hashByte(hash, (uint8_t)tokens[i].str[j]);
         }
+        prefix_hash[i] = hash;
     }
-    else if (strcmp(tokens[0], "write") == 0) {
-        if (token_count < 2) {
-            return Result::InvalidCommand;
-        }
 
-        if (strcmp(tokens[1], "seq") == 0) {
-            return parseWriteSeq(tokens, token_count, cmd);
-        }
-        else {
-            return parseWrite(tokens, token_count, cmd);
+    for (int i = depth - 1; i >= 0; i--) {
+        uint8_t entry = COMMAND_HASH.slots[CommandTable::slotOf<COMMAND_HASH_BITS>(prefix_hash[i])];
+        if (entry != 0 && pathMatches(COMMANDS[entry - 1].path, tokens, i + 1)) {
+            return &COMMANDS[entry - 1];
         }
     }
-    else if (strcmp(tokens[0], "read") == 0) {
-        if (token_count < 2) {
-            return Result::InvalidCommand;
-        }
 
-        if (strcmp(tokens[1], "raw") == 0) {
-            cmd->type = CMD_READ_RAW;
-            return Result::OK;
-        }
-        else if (strcmp(tokens[1], "parsed") == 0) {
-            cmd->type = CMD_READ_PARSED;
-            return Result::OK;
-        }
-    }
-    else if (strcmp(tokens[0], "bus") == 0) {
-        if (token_count < 2) {
-            return Result::InvalidCommand;
-        }
+    return nullptr;
+}
 
-        if (strcmp(tokens[1], "load") == 0) {
-            if (token_count < 3) {
-                return Result::InvalidCommand;
-            }
+// В слот может попасть чужой префикс - путь сверяется целиком
+bool CommandHandler::pathMatches(const char* path, const Token* tokens, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strncmp(path, tokens[i].str, tokens[i].len) != 0) {
+            return false;
+        }
+        path += tokens[i].len;
 
-            if (strcmp(tokens[2], "on") == 0) {
-                cmd->type = CMD_BUS_LOAD_ON;
-                return Result::OK;
-            }
-            else if (strcmp(tokens[2], "off") == 0) {
-                cmd->type = CMD_BUS_LOAD_OFF;
-                return Result::OK;
-            }
-            else if (strcmp(tokens[2], "status") == 0) {
-                cmd->type = CMD_BUS_LOAD_STATUS;
-                return Result::OK;
-            }
+        char expected = (i + 1 < count) ? ' ' : '\0';
+        if (*path != expected) {
+            return false;
         }
+        path++;
     }
-
-    return Result::InvalidCommand;
+    return true;
 }
 
-int CommandHandler::tokenize(const char* input, char tokens[][TOKEN_SIZE]) {
+// Токены режутся прямо в строке: разделитель после токена заменяется на '\0',
+// поэтому каждый токен - и участок строки, и C-строка для strtoul/atoi
+int CommandHandler::tokenize(char* line, Token* tokens) {
     int count = 0;
-    int pos = 0;
-    int len = strlen(input);
+    char* pos = line;
 
-    while (pos < len && count < MAX_TOKENS) {
+    while (*pos && count < MAX_TOKENS) {
         // Пропускаем пробелы
-        while (pos < len && isspace(input[pos])) pos++;
-        if (pos >= len) break;
+        while (*pos && isspace((unsigned char)*pos)) pos++;
+        if (!*pos) break;
 
-        int token_pos = 0;
+        char* start = pos;
+        while (*pos && !isspace((unsigned char)*pos)) pos++;
 
-        // Читаем токен до следующего пробела или конца строки
-        while (pos < len && !isspace(input[pos]) && token_pos < TOKEN_SIZE - 1) {
-            tokens[count][token_pos++] = input[pos++];
-        }
-        tokens[count][token_pos] = '\0';
+        tokens[count].str = start;
+        tokens[count].len = pos - start;
         count++;
+
+        if (*pos) {
+            *pos++ = '\0';
+        }
     }
 
     return count;
@@ -277,18 +380,19 @@ uint32_t CommandHandler::parseHex(const char* str) {
     return value;
 }
 
-// Парсинг байтов данных
-bool CommandHandler::parseDataBytes(const char* str, uint8_t* data, uint8_t* dlc) {
+// Парсинг байтов данных из участка строки [str, end). Данные могут
+// занимать несколько токенов - '\0' между ними тоже разделитель
+bool CommandHandler::parseDataBytes(const char* str, const char* end, uint8_t* data, uint8_t* dlc) {
     int byte_count = 0;
     char hex[3] = {0};
     int hex_pos = 0;
     bool last_was_delimiter = false;
 
-    while (*str && byte_count < 8) {
+    while (str < end && byte_count < 8) {
         char c = *str++;
 
         // Если это разделитель
-        if (c == ' ' || c == '-' || c == ':') {
+        if (c == ' ' || c == '-' || c == ':' || c == '\0' || c == '\t') {
             if (hex_pos == 2) {
                 data[byte_count++] = (uint8_t)parseHex(hex);
                 hex_pos = 0;
@@ -327,16 +431,18 @@ bool CommandHandler::parseDataBytes(const char* str, uint8_t* data, uint8_t* dlc
     return true;
 }
 
-// Парсинг команды filter add
-CommandHandler::Result CommandHandler::parseFilterAdd(char tokens[][TOKEN_SIZE], int token_count, Command* cmd) {
-    cmd->type = CMD_FILTER_ADD;
-
-    if (token_count < 3) {
-        return Result::InvalidCommand;
-    }
+// can batch <frames> <budget_us>
+CommandHandler::Result CommandHandler::parseCanBatch(Token* tokens, int token_count, Command* cmd) {
+    (void)token_count;
+    cmd->params.batch.max_frames = atoi(tokens[2].str);
+    cmd->params.batch.budget_us = atoi(tokens[3].str);
+    return Result::OK;
+}
 
+// Парсинг команды filter add
+CommandHandler::Result CommandHandler::parseFilterAdd(Token* tokens, int token_count, Command* cmd) {
     // Парсим ID
-    cmd->params.filter.id = parseHex(tokens[2]);
+    cmd->params.filter.id = parseHex(tokens[2].str);
 
     // Устанавливаем значения по умолчанию
     cmd->params.filter.mask = 0x7FF;  // По умолчанию для STD
@@ -344,12 +450,12 @@ CommandHandler::Result CommandHandler::parseFilterAdd(char tokens[][TOKEN_SIZE],
     cmd->params.filter.delete_all = false;
 
     if (token_count >= 4) {
-        cmd->params.filter.mask = parseHex(tokens[3]);
+        cmd->params.filter.mask = parseHex(tokens[3].str);
     }
 
     // Обрабатываем тип если есть
     if (token_count >= 5) {
-        if (strcmp(tokens[4], "ext") == 0 || strcmp(tokens[4], "EXT") == 0) {
+        if (strcmp(tokens[4].str, "ext") == 0 || strcmp(tokens[4].str, "EXT") == 0) {
             cmd->params.filter.filter_type = FILTER_TYPE_EXT;
 
             // Если маска еще дефолтная - обновляем для EXT
@@ -357,7 +463,7 @@ CommandHandler::Result CommandHandler::parseFilterAdd(char tokens[][TOKEN_SIZE],
                 cmd->params.filter.mask = 0x1FFFFFFF;
             }
         }
-        else if (strcmp(tokens[4], "std") == 0 || strcmp(tokens[4], "STD") == 0) {
+        else if (strcmp(tokens[4].str, "std") == 0 || strcmp(tokens[4].str, "STD") == 0) {
             // Явно указан std - оставляем как есть
             cmd->params.filter.filter_type = FILTER_TYPE_STD;
 
@@ -371,53 +477,103 @@ CommandHandler::Result CommandHandler::parseFilterAdd(char tokens[][TOKEN_SIZE],
     return Result::OK;
 }
 
-// Парсинг команды write
-CommandHandler::Result CommandHandler::parseWrite(char tokens[][TOKEN_SIZE], int token_count, Command* cmd) {
-    cmd->type = CMD_WRITE;
+// filter del <id|all>
+CommandHandler::Result CommandHandler::parseFilterDel(Token* tokens, int token_count, Command* cmd) {
+    (void)token_count;
 
-    if (token_count < 3) {
-        return Result::InvalidCommand;
+    if (strcmp(tokens[2].str, "all") == 0) {
+        cmd->params.filter.delete_all = true;
+    } else {
+        cmd->params.filter.delete_all = false;
+        cmd->params.filter.id = parseHex(tokens[2].str);
+    }
+    return Result::OK;
+}
+
+// filter load [begin|end|abort]
+CommandHandler::Result CommandHandler::parseFilterLoad(Token* tokens, int token_count, Command* cmd) {
+    cmd->params.filter.load_phase = FILTER_LOAD_BEGIN;
+
+    if (token_count >= 3) {
+        if (strcmp(tokens[2].str, "end") == 0) {
+            cmd->params.filter.load_phase = FILTER_LOAD_END;
+        } else if (strcmp(tokens[2].str, "abort") == 0) {
+            cmd->params.filter.load_phase = FILTER_LOAD_ABORT;
+        } else if (strcmp(tokens[2].str, "begin") != 0) {
+            return Result::InvalidCommand;
+        }
     }
+    return Result::OK;
+}
 
-    // Парсим ID (первый токен после "write")
-    cmd->params.write.id = parseHex(tokens[1]);
+// filter sw add <id|first-last|code/mask> [std|ext]
+CommandHandler::Result CommandHandler::parseSwFilterAdd(Token* tokens, int token_count, Command* cmd) {
+    cmd->params.sw_filter.kind = SW_RULE_ID;
+    cmd->params.sw_filter.filter_type = FILTER_TYPE_STD;
+
+    char* rule = tokens[3].str;
+    char* separator = strpbrk(rule, "-/");
+    if (separator != nullptr) {
+        cmd->params.sw_filter.kind = (*separator == '-') ? SW_RULE_RANGE : SW_RULE_MASK;
+        *separator = '\0';
+        cmd->params.sw_filter.second = parseHex(separator + 1);
+    }
+    cmd->params.sw_filter.first = parseHex(rule);
 
-    // Объединяем оставшиеся токены для данных
-    char data_str[64] = {0};
-    for (int i = 2; i < token_count; i++) {
-        if (i > 2) strcat(data_str, " ");
-        strcat(data_str, tokens[i]);
+    if (token_count >= 5 && (strcmp(tokens[4].str, "ext") == 0 || strcmp(tokens[4].str, "EXT") == 0)) {
+        cmd->params.sw_filter.filter_type = FILTER_TYPE_EXT;
     }
 
-    if (!parseDataBytes(data_str, cmd->params.write.data, &cmd->params.write.dlc)) {
+    return Result::OK;
+}
+
+// filter sw del <n|all>
+CommandHandler::Result CommandHandler::parseSwFilterDel(Token* tokens, int token_count, Command* cmd) {
+    (void)token_count;
+
+    if (strcmp(tokens[3].str, "all") == 0) {
+        cmd->params.sw_filter.delete_all = true;
+    } else {
+        cmd->params.sw_filter.index = atoi(tokens[3].str);
+    }
+    return Result::OK;
+}
+
+// Парсинг команды write
+CommandHandler::Result CommandHandler::parseWrite(Token* tokens, int token_count, Command* cmd) {
+    // Парсим ID (первый токен после "write")
+    cmd->params.write.id = parseHex(tokens[1].str);
+
+    // Данные - все оставшиеся токены, они лежат в строке подряд
+    const Token& last = tokens[token_count - 1];
+    if (!parseDataBytes(tokens[2].str, last.str + last.len, cmd->params.write.data, &cmd->params.write.dlc)) {
         return Result::ParseError;
     }
 
     cmd->params.write.count = 1;
-    cmd->params.write.interval_ms = 0;
+    cmd->params.write.interval_us = 0;
 
     return Result::OK;
 }
 
 // Парсинг команды write seq
-CommandHandler::Result CommandHandler::parseWriteSeq(char tokens[][TOKEN_SIZE], int token_count, Command* cmd) {
-    cmd->type = CMD_WRITE_SEQ;
-
-    if (token_count < 6) {
-        return Result::InvalidCommand;
-    }
+CommandHandler::Result CommandHandler::parseWriteSeq(Token* tokens, int token_count, Command* cmd) {
+    (void)token_count;
 
-    // write seq <id> <data> <count> <interval_ms>
-    cmd->params.write.id = parseHex(tokens[2]);
+    // write seq <id> <data> <count> <interval>
+    cmd->params.write.id = parseHex(tokens[2].str);
 
     // Данные
-    if (!parseDataBytes(tokens[3], cmd->params.write.data, &cmd->params.write.dlc)) {
+    if (!parseDataBytes(tokens[3].str, tokens[3].str + tokens[3].len,
+                        cmd->params.write.data, &cmd->params.write.dlc)) {
         return Result::ParseError;
     }
 
     // Count и interval
-    cmd->params.write.count = atoi(tokens[4]);
-    cmd->params.write.interval_ms = atoi(tokens[5]);
+    cmd->params.write.count = atoi(tokens[4].str);
+    if (!parseInterval(tokens[5].str, &cmd->params.write.interval_us)) {
+        return Result::ParseError;
+    }
 
     if (cmd->params.write.count > 10000) {
         return Result::ParseError;
@@ -426,6 +582,83 @@ CommandHandler::Result CommandHandler::parseWriteSeq(char tokens[][TOKEN_SIZE],
     return Result::OK;
 }
 
+// seq stop <id|all>
+CommandHandler::Result CommandHandler::parseSeqStop(Token* tokens, int token_count, Command* cmd) {
+    (void)token_count;
+
+    cmd->params.seq.stop_all = (strcmp(tokens[2].str, "all") == 0);
+    cmd->params.seq.id = cmd->params.seq.stop_all ? 0 : parseHex(tokens[2].str);
+    return Result::OK;
+}
+
+// seq data <id> <data>
+CommandHandler::Result CommandHandler::parseSeqData(Token* tokens, int token_count, Command* cmd) {
+    cmd->params.write.id = parseHex(tokens[2].str);
+
+    // Данные, как и в write, можно писать с пробелами
+    const Token& last = tokens[token_count - 1];
+    if (!parseDataBytes(tokens[3].str, last.str + last.len, cmd->params.write.data, &cmd->params.write.dlc)) {
+        return Result::ParseError;
+    }
+    return Result::OK;
+}
+
+// trace add <delta> <id> <data> - delta в формате интервала write seq
+CommandHandler::Result CommandHandler::parseTraceAdd(Token* tokens, int token_count, Command* cmd) {
+    if (!parseInterval(tokens[2].str, &cmd->params.write.interval_us)) {
+        return Result::ParseError;
+    }
+    cmd->params.write.id = parseHex(tokens[3].str);
+
+    const Token& last = tokens[token_count - 1];
+    if (!parseDataBytes(tokens[4].str, last.str + last.len, cmd->params.write.data, &cmd->params.write.dlc)) {
+        return Result::ParseError;
+    }
+    return Result::OK;
+}
+
+// trace play [loops] [speed%]
+CommandHandler::Result CommandHandler::parseTracePlay(Token* tokens, int token_count, Command* cmd) {
+    cmd->params.trace.loops = (token_count >= 3) ? strtoul(tokens[2].str, nullptr, 10) : 1;
+    cmd->params.trace.speed_percent = (token_count >= 4) ? atoi(tokens[3].str) : 100;
+    return Result::OK;
+}
+
+// read changes [interval_ms]
+CommandHandler::Result CommandHandler::parseReadChanges(Token* tokens, int token_count, Command* cmd) {
+    cmd->params.changes.interval_ms = (token_count >= 3) ? atoi(tokens[2].str) : 0;
+    return Result::OK;
+}
+
+// stats [top_n]
+CommandHandler::Result CommandHandler::parseStats(Token* tokens, int token_count, Command* cmd) {
+    cmd->params.stats.limit = (token_count >= 2) ? atoi(tokens[1].str) : 0;
+    return Result::OK;
+}
+
+// Интервал: "100" или "100ms" - миллисекунды, "500us" - микросекунды
+bool CommandHandler::parseInterval(const char* str, uint32_t* interval_us) {
+    char* end;
+    unsigned long value = strtoul(str, &end, 10);
+
+    if (end == str) {
+        return false;
+    }
+
+    if (*end == '\0' || strcmp(end, "ms") == 0) {
+        if (value > UINT32_MAX / 1000) {
+            return false;
+        }
+        *interval_us = value * 1000;
+    } else if (strcmp(end, "us") == 0) {
+        *interval_us = value;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
 // Утилиты
 bool CommandHandler::isDelimiter(char c) {
     return c == ' ' || c == '\t' || c == '\r' || c == '\n';
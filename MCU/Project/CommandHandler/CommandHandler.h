@@ -9,6 +9,9 @@
 #define COMMANDHANDLER_COMMANDHANDLER_H_
 
 #include "main.h"
+#include "Queue/SpscRing.hpp"
+#include "Timing/IsrProfiler.h"
+#include "CommandTable.h"
 
 extern "C" {
 	#include "Queue/cQueue.h"
@@ -23,23 +26,56 @@ typedef enum {
     CMD_CAN_START,
     CMD_CAN_STOP,
     CMD_CAN_INFO,
+    CMD_CAN_STATS,
+    CMD_CAN_BATCH,
+    CMD_CAN_BENCH,
 
     // Фильтры
     CMD_FILTER_ADD,
     CMD_FILTER_DEL,
     CMD_FILTER_LIST,
+    CMD_FILTER_LOAD,
+    CMD_SW_FILTER_ADD,
+    CMD_SW_FILTER_DEL,
+    CMD_SW_FILTER_LIST,
 
     // Запись
     CMD_WRITE,
     CMD_WRITE_SEQ,
 
+    // Периодические последовательности
+    CMD_SEQ_LIST,
+    CMD_SEQ_STOP,
+    CMD_SEQ_DATA,
+
+    // Воспроизведение потока с хоста
+    CMD_REPLAY_STATUS,
+    CMD_REPLAY_STOP,
+
+    // Трасса в памяти устройства
+    CMD_TRACE_ADD,
+    CMD_TRACE_CLEAR,
+    CMD_TRACE_PLAY,
+    CMD_TRACE_PAUSE,
+    CMD_TRACE_RESUME,
+    CMD_TRACE_STOP,
+    CMD_TRACE_STATUS,
+
     // Чтение
     CMD_READ_RAW,
     CMD_READ_PARSED,
+    CMD_READ_BINARY,
+    CMD_READ_COLOR_ON,
+    CMD_READ_COLOR_OFF,
+    CMD_READ_CHANGES,
 
     CMD_BUS_LOAD_ON,
     CMD_BUS_LOAD_OFF,
-    CMD_BUS_LOAD_STATUS
+    CMD_BUS_LOAD_STATUS,
+
+    // Статистика по ID
+    CMD_STATS,
+    CMD_STATS_RESET
 } CommandType;
 
 typedef enum {
@@ -47,6 +83,30 @@ typedef enum {
     FILTER_TYPE_EXT
 } FilterType;
 
+// Этап пакетной загрузки фильтров
+typedef enum {
+    FILTER_LOAD_BEGIN = 0,
+    FILTER_LOAD_END,
+    FILTER_LOAD_ABORT
+} FilterLoadPhase;
+
+// Управление трассой (все команды "trace", кроме add)
+typedef enum {
+    TRACE_CLEAR = 0,
+    TRACE_PLAY,
+    TRACE_PAUSE,
+    TRACE_RESUME,
+    TRACE_STOP,
+    TRACE_STATUS
+} TraceAction;
+
+// Вид правила программного фильтра
+typedef enum {
+    SW_RULE_ID = 0,     // first
+    SW_RULE_RANGE,      // first-second
+    SW_RULE_MASK        // first/second (код/маска)
+} SwRuleKind;
+
 // Структура команды
 typedef struct {
     CommandType type;
@@ -58,29 +118,74 @@ typedef struct {
             uint32_t mask;
             FilterType filter_type;
             bool delete_all;
+            FilterLoadPhase load_phase;
         } filter;
 
+        // Для программного фильтра
+        struct {
+            uint32_t first;
+            uint32_t second;
+            SwRuleKind kind;
+            FilterType filter_type;
+            uint16_t index;
+            bool delete_all;
+        } sw_filter;
+
         // Для записи
         struct {
             uint32_t id;
             uint8_t data[8];
             uint8_t dlc;
             uint32_t count;
-            uint32_t interval_ms;
+            uint32_t interval_us;
         } write;
+
+        // Для "trace play" ("trace add" использует write, delta - в interval_us)
+        struct {
+            uint32_t loops;          // 0 - бесконечно
+            uint16_t speed_percent;  // 0 - исходный темп
+        } trace;
+
+        // Для управления последовательностями (seq data использует write)
+        struct {
+            uint32_t id;
+            bool stop_all;
+        } seq;
+
+        // Для настройки пакетной выборки
+        struct {
+            uint16_t max_frames;
+            uint32_t budget_us;
+        } batch;
+
+        // Для режима "read changes"
+        struct {
+            uint32_t interval_ms;
+        } changes;
+
+        // Для вывода статистики по ID
+        struct {
+            uint16_t limit;    // 0 - все ID
+        } stats;
     } params;
 } Command;
 
 class CommandHandler {
 public:
 
-    static constexpr uint16_t BUFFER_SIZE = 256;
+    // Строка текста или двоичный кадр COBS целиком
+    static constexpr uint16_t BUFFER_SIZE = 512;
     static constexpr uint16_t COMMAND_SIZE = 30;
     static constexpr uint16_t QUEUE_SIZE = 100;
 
-    static constexpr uint8_t TOKEN_SIZE = 32;
     static constexpr uint8_t MAX_TOKENS = 10;
 
+    // Сырые байты из прерывания USB до разбора в superloop
+    static constexpr uint16_t RX_RING_SIZE = 1024;
+    // Работа одного вызова poll(): байт и разобранных строк
+    static constexpr uint16_t POLL_BYTE_BUDGET = 64;
+    static constexpr uint8_t POLL_COMMAND_BUDGET = 2;
+
 /*    struct Command {
         uint8_t data[COMMAND_SIZE];
         uint8_t size;
@@ -93,14 +198,33 @@ public:
         InvalidCommand,
 		Incomplete,
 		ParseError,
+		Busy,           // Получатель двоичного кадра занят, кадр повторится
     };
 
-    CommandHandler(Queue_t *queue_ptr);
+    // Двоичный кадр между нулевыми разделителями, еще в COBS.
+    // false - получателю некуда его деть: poll() оставит завершающий ноль
+    // в кольце и повторит позже, а кольцо, заполнившись, остановит прием USB
+    typedef bool (*BinaryFrameCallback)(const uint8_t* frame, uint16_t length);
+
+    CommandHandler(Queue_t *queue_ptr, BinaryFrameCallback binary_cb);
     ~CommandHandler() = default;
 
     Result processByte(uint8_t byte);
     Result processBuffer(const uint8_t* buffer, uint16_t length);
 
+    // Вызывается из прерывания USB: только копирует байты в кольцо.
+    // С -DCOMMAND_PARSE_IN_ISR разбирает строки прямо здесь, как раньше -
+    // для сравнения времени обработчика
+    void receive(const uint8_t* buffer, uint32_t length);
+
+    // Вызывается из superloop: собирает строки из кольца и разбирает их,
+    // не больше POLL_BYTE_BUDGET байт и POLL_COMMAND_BUDGET команд за вызов
+    void poll();
+
+    uint32_t getRxFreeSpace() const { return rx_ring_.freeSpace(); }
+    uint32_t getRxDroppedBytes() const { return rx_ring_.getOverflowCount(); }
+    const IsrProfiler& getRxIsrProfile() const { return rx_isr_profile_; }
+
     uint16_t getQueueCount() const;
     uint16_t getProcessedCount() const { return processed_count_; }
     uint16_t getErrorCount() const { return error_count_; }
@@ -109,14 +233,53 @@ private:
 
     void addByteToBuffer(uint8_t byte);
     Result completeCommand();
+    Result processBinaryByte(uint8_t byte);
+
+    // Токен - участок строки rx_buffer_, без копирования
+    struct Token {
+        char* str;      // Завершен '\0' прямо в строке
+        uint16_t len;
+    };
+
+    typedef Result (CommandHandler::*ArgParser)(Token* tokens, int token_count, Command* cmd);
+
+    struct CommandSpec {
+        const char* path;       // Слова команды через один пробел
+        CommandType type;
+        uint8_t min_tokens;     // Вместе со словами пути
+        ArgParser parse;        // nullptr - аргументов нет
+    };
+
+    static constexpr uint8_t MAX_PATH_TOKENS = 3;
+    static constexpr uint8_t COMMAND_HASH_BITS = 7;
+
+    static const CommandSpec COMMANDS[];
+    static const CommandTable::PerfectHash<COMMAND_HASH_BITS> COMMAND_HASH;
+
+    Result parseCommand(char* line, Command* cmd);
+    int tokenize(char* line, Token* tokens);
+    const CommandSpec* findCommand(const Token* tokens, int token_count);
+    static bool pathMatches(const char* path, const Token* tokens, int count);
 
-    Result parseCommand(const char* command_str, Command* cmd);
-    int tokenize(const char* input, char tokens[][TOKEN_SIZE]);
     uint32_t parseHex(const char* str);
-    bool parseDataBytes(const char* str, uint8_t* data, uint8_t* dlc);
-    Result parseFilterAdd(char tokens[][TOKEN_SIZE], int token_count, Command* cmd);
-    Result parseWrite(char tokens[][TOKEN_SIZE], int token_count, Command* cmd);
-    Result parseWriteSeq(char tokens[][TOKEN_SIZE], int token_count, Command* cmd);
+    bool parseDataBytes(const char* str, const char* end, uint8_t* data, uint8_t* dlc);
+    bool parseInterval(const char* str, uint32_t* interval_us);
+
+    // Разбор аргументов: тип команды и число токенов уже проверены по таблице
+    Result parseCanBatch(Token* tokens, int token_count, Command* cmd);
+    Result parseFilterAdd(Token* tokens, int token_count, Command* cmd);
+    Result parseFilterDel(Token* tokens, int token_count, Command* cmd);
+    Result parseFilterLoad(Token* tokens, int token_count, Command* cmd);
+    Result parseSwFilterAdd(Token* tokens, int token_count, Command* cmd);
+    Result parseSwFilterDel(Token* tokens, int token_count, Command* cmd);
+    Result parseWrite(Token* tokens, int token_count, Command* cmd);
+    Result parseWriteSeq(Token* tokens, int token_count, Command* cmd);
+    Result parseSeqStop(Token* tokens, int token_count, Command* cmd);
+    Result parseSeqData(Token* tokens, int token_count, Command* cmd);
+    Result parseTraceAdd(Token* tokens, int token_count, Command* cmd);
+    Result parseTracePlay(Token* tokens, int token_count, Command* cmd);
+    Result parseReadChanges(Token* tokens, int token_count, Command* cmd);
+    Result parseStats(Token* tokens, int token_count, Command* cmd);
     bool isDelimiter(char c);
     void trimWhitespace(char* str);
 
@@ -125,12 +288,19 @@ private:
     uint8_t rx_buffer_[BUFFER_SIZE];
     volatile uint16_t cursor_;
 
+    SpscRing<uint8_t, RX_RING_SIZE> rx_ring_;
+    IsrProfiler rx_isr_profile_;
+
     Queue_t *command_queue_;
 
     uint16_t processed_count_;
     uint16_t error_count_;
 
     bool initialized_;
+
+    // Принят 0x00 вне строки: копим кадр COBS до следующего нуля
+    bool binary_frame_;
+    BinaryFrameCallback binary_callback_;
 };
 
 
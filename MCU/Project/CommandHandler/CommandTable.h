@@ -0,0 +1,83 @@
+/*
+ * CommandTable.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef COMMANDHANDLER_COMMANDTABLE_H_
+#define COMMANDHANDLER_COMMANDTABLE_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Совершенный хеш над путями команд ("can start", "bus load on").
+// Таблица слотов и seed подбираются при компиляции: ключи таблицы команд
+// гарантированно попадают в разные слоты, и поиск - одно вычисление хеша
+// и одно сравнение строки, сколько бы команд ни было.
+// Хеш - FNV-1a со смещенным базисом, слот - старшие биты после умножения.
+// Токены хешируются с разделителем ' ', как в записи пути.
+namespace CommandTable {
+
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+constexpr uint32_t MAX_SEED = 100000;
+
+constexpr uint32_t hashStart(uint32_t seed) { return FNV_OFFSET ^ seed; }
+
+constexpr uint32_t hashByte(uint32_t hash, uint8_t c) { return (hash ^ c) * FNV_PRIME; }
+
+constexpr uint32_t hashString(uint32_t seed, const char* str) {
+    uint32_t hash = hashStart(seed);
+    while (*str) {
+        hash = hashByte(hash, (uint8_t)*str++);
+    }
+    return hash;
+}
+
+template <uint8_t Bits>
+constexpr uint16_t slotOf(uint32_t hash) {
+    return (uint16_t)((hash * 0x9E3779B1u) >> (32 - Bits));
+}
+
+template <uint8_t Bits>
+struct PerfectHash {
+    static constexpr uint16_t SIZE = 1 << Bits;
+
+    bool valid;             // false - seed не найден (например, повтор ключа)
+    uint32_t seed;
+    uint8_t slots[SIZE];    // Номер записи + 1, 0 - слот пуст
+};
+
+// Spec - любая запись с полем path. Перебирает seed, пока все пути
+// не лягут в разные слоты.
+template <uint8_t Bits, typename Spec, size_t N>
+constexpr PerfectHash<Bits> build(const Spec (&table)[N]) {
+    static_assert(N < 255 && N < PerfectHash<Bits>::SIZE, "Command table too large for hash");
+
+    for (uint32_t seed = 0; seed < MAX_SEED; seed++) {
+        PerfectHash<Bits> hash = {};
+        hash.seed = seed;
+        bool collision = false;
+
+        for (size_t i = 0; i < N && !collision; i++) {
+            uint16_t slot = slotOf<Bits>(hashString(seed, table[i].path));
+            if (hash.slots[slot] != 0) {
+                collision = true;
+            } else {
+                hash.slots[slot] = (uint8_t)(i + 1);
+            }
+        }
+
+        if (!collision) {
+            hash.valid = true;
+            return hash;
+        }
+    }
+
+    return PerfectHash<Bits>{};
+}
+
+} // namespace CommandTable
+
+#endif /* COMMANDHANDLER_COMMANDTABLE_H_ */
@@ -11,30 +11,68 @@ CommandProcessor::CommandProcessor(Queue_t *queue_ptr,
 		CanStartCallback can_start_cb,
 		CanStopCallback can_stop_cb,
 		CanInfoCallback can_info_cb,
+		CanStatsCallback can_stats_cb,
+		CanBatchCallback can_batch_cb,
+		CanBenchCallback can_bench_cb,
 		FilterAddCallback filter_add_cb,
 		FilterDelCallback filter_del_cb,
 		FilterListCallback filter_list_cb,
+		FilterLoadCallback filter_load_cb,
+		SwFilterAddCallback sw_filter_add_cb,
+		SwFilterDelCallback sw_filter_del_cb,
+		SwFilterListCallback sw_filter_list_cb,
 		WriteCallback write_cb,
 		WriteSeqCallback write_seq_cb,
+		SeqListCallback seq_list_cb,
+		SeqStopCallback seq_stop_cb,
+		SeqDataCallback seq_data_cb,
+		ReplayStatusCallback replay_status_cb,
+		ReplayStopCallback replay_stop_cb,
+		TraceAddCallback trace_add_cb,
+		TraceControlCallback trace_control_cb,
 		ReadRawCallback read_raw_cb,
 		ReadParsedCallback read_parsed_cb,
+		ReadBinaryCallback read_binary_cb,
+		ReadColorCallback read_color_cb,
+		ReadChangesCallback read_changes_cb,
 		ErrorCallback error_cb,
 		HandleBusLoadMonitorCallback handle_bus_load_monitor_cb,
-		HandleBusLoadStatusCallback  handle_bus_load_status_cb)
+		HandleBusLoadStatusCallback  handle_bus_load_status_cb,
+		StatsCallback stats_cb,
+		StatsResetCallback stats_reset_cb)
 	: command_queue_(queue_ptr),
 	  can_start_callback_(can_start_cb),
 	  can_stop_callback_(can_stop_cb),
 	  can_info_callback_(can_info_cb),
+	  can_stats_callback_(can_stats_cb),
+	  can_batch_callback_(can_batch_cb),
+	  can_bench_callback_(can_bench_cb),
 	  filter_add_callback_(filter_add_cb),
 	  filter_del_callback_(filter_del_cb),
 	  filter_list_callback_(filter_list_cb),
+	  filter_load_callback_(filter_load_cb),
+	  sw_filter_add_callback_(sw_filter_add_cb),
+	  sw_filter_del_callback_(sw_filter_del_cb),
+	  sw_filter_list_callback_(sw_filter_list_cb),
 	  write_callback_(write_cb),
 	  write_seq_callback_(write_seq_cb),
+	  seq_list_callback_(seq_list_cb),
+	  seq_stop_callback_(seq_stop_cb),
+	  seq_data_callback_(seq_data_cb),
+	  replay_status_callback_(replay_status_cb),
+	  replay_stop_callback_(replay_stop_cb),
+	  trace_add_callback_(trace_add_cb),
+	  trace_control_callback_(trace_control_cb),
 	  read_raw_callback_(read_raw_cb),
 	  read_parsed_callback_(read_parsed_cb),
+	  read_binary_callback_(read_binary_cb),
+	  read_color_callback_(read_color_cb),
+	  read_changes_callback_(read_changes_cb),
 	  error_callback_(error_cb),
 	  handle_bus_load_monitor_callback_(handle_bus_load_monitor_cb),
-	  handle_bus_load_status_callback_(handle_bus_load_status_cb){}
+	  handle_bus_load_status_callback_(handle_bus_load_status_cb),
+	  stats_callback_(stats_cb),
+	  stats_reset_callback_(stats_reset_cb){}
 
 void CommandProcessor::processCommand() {
 	Command cmd;
@@ -60,6 +98,18 @@ void CommandProcessor::processSingleCommand(const Command& cmd){
         	can_info_callback_();
 			break;
         }
+        case CMD_CAN_STATS:{
+        	can_stats_callback_();
+			break;
+        }
+        case CMD_CAN_BENCH:{
+        	can_bench_callback_();
+			break;
+        }
+        case CMD_CAN_BATCH:{
+        	can_batch_callback_(cmd.params.batch.max_frames, cmd.params.batch.budget_us);
+			break;
+        }
         case CMD_FILTER_ADD:{
         	filter_add_callback_(cmd.params.filter.id, cmd.params.filter.mask, cmd.params.filter.filter_type);
             break;
@@ -72,13 +122,79 @@ void CommandProcessor::processSingleCommand(const Command& cmd){
         	filter_list_callback_();
             break;
         }
+        case CMD_FILTER_LOAD:{
+        	filter_load_callback_(cmd.params.filter.load_phase);
+            break;
+        }
+        case CMD_SW_FILTER_ADD:{
+        	sw_filter_add_callback_(cmd.params.sw_filter.kind, cmd.params.sw_filter.first,
+        							cmd.params.sw_filter.second, cmd.params.sw_filter.filter_type);
+            break;
+        }
+        case CMD_SW_FILTER_DEL:{
+        	sw_filter_del_callback_(cmd.params.sw_filter.index, cmd.params.sw_filter.delete_all);
+            break;
+        }
+        case CMD_SW_FILTER_LIST:{
+        	sw_filter_list_callback_();
+            break;
+        }
         case CMD_WRITE:{
         	write_callback_(cmd.params.write.id, (uint8_t*)cmd.params.write.data, cmd.params.write.dlc);
             break;
         }
         case CMD_WRITE_SEQ:{
         	write_seq_callback_(cmd.params.write.id, (uint8_t*)cmd.params.write.data, cmd.params.write.dlc,
-        						cmd.params.write.count, cmd.params.write.interval_ms);
+        						cmd.params.write.count, cmd.params.write.interval_us);
+            break;
+        }
+        case CMD_SEQ_LIST:{
+        	seq_list_callback_();
+            break;
+        }
+        case CMD_SEQ_STOP:{
+        	seq_stop_callback_(cmd.params.seq.id, cmd.params.seq.stop_all);
+            break;
+        }
+        case CMD_SEQ_DATA:{
+        	seq_data_callback_(cmd.params.write.id, (uint8_t*)cmd.params.write.data, cmd.params.write.dlc);
+            break;
+        }
+        case CMD_REPLAY_STATUS:{
+        	replay_status_callback_();
+            break;
+        }
+        case CMD_REPLAY_STOP:{
+        	replay_stop_callback_();
+            break;
+        }
+        case CMD_TRACE_ADD:{
+        	trace_add_callback_(cmd.params.write.interval_us, cmd.params.write.id,
+        						(uint8_t*)cmd.params.write.data, cmd.params.write.dlc);
+            break;
+        }
+        case CMD_TRACE_CLEAR:{
+        	trace_control_callback_(TRACE_CLEAR, 0, 0);
+            break;
+        }
+        case CMD_TRACE_PLAY:{
+        	trace_control_callback_(TRACE_PLAY, cmd.params.trace.loops, cmd.params.trace.speed_percent);
+            break;
+        }
+        case CMD_TRACE_PAUSE:{
+        	trace_control_callback_(TRACE_PAUSE, 0, 0);
+            break;
+        }
+        case CMD_TRACE_RESUME:{
+        	trace_control_callback_(TRACE_RESUME, 0, 0);
+            break;
+        }
+        case CMD_TRACE_STOP:{
+        	trace_control_callback_(TRACE_STOP, 0, 0);
+            break;
+        }
+        case CMD_TRACE_STATUS:{
+        	trace_control_callback_(TRACE_STATUS, 0, 0);
             break;
         }
         case CMD_READ_RAW:{
@@ -89,6 +205,22 @@ void CommandProcessor::processSingleCommand(const Command& cmd){
         	read_parsed_callback_();
 			break;
         }
+        case CMD_READ_BINARY:{
+        	read_binary_callback_();
+			break;
+        }
+        case CMD_READ_COLOR_ON:{
+        	read_color_callback_(true);
+			break;
+        }
+        case CMD_READ_COLOR_OFF:{
+        	read_color_callback_(false);
+			break;
+        }
+        case CMD_READ_CHANGES:{
+        	read_changes_callback_(cmd.params.changes.interval_ms);
+			break;
+        }
         case CMD_BUS_LOAD_ON:{
         	handle_bus_load_monitor_callback_(true);
         	break;
@@ -101,6 +233,14 @@ void CommandProcessor::processSingleCommand(const Command& cmd){
 			handle_bus_load_status_callback_();
 			break;
 		}
+        case CMD_STATS:{
+			stats_callback_(cmd.params.stats.limit);
+			break;
+		}
+        case CMD_STATS_RESET:{
+			stats_reset_callback_();
+			break;
+		}
         default:
             //printf("Unknown command\r\n");
             break;
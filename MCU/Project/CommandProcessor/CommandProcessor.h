@@ -21,17 +21,36 @@ public:
 	typedef void (*CanStartCallback)(void);
 	typedef void (*CanStopCallback)(void);
 	typedef void (*CanInfoCallback)(void);
+	typedef void (*CanStatsCallback)(void);
+	typedef void (*CanBatchCallback)(uint16_t max_frames, uint32_t budget_us);
+	typedef void (*CanBenchCallback)(void);
 	typedef void (*FilterAddCallback)(uint32_t id, uint32_t mask, FilterType type);
 	typedef void (*FilterDelCallback)(uint32_t id, bool delete_all);
 	typedef void (*FilterListCallback)(void);
+	typedef void (*FilterLoadCallback)(FilterLoadPhase phase);
+	typedef void (*SwFilterAddCallback)(SwRuleKind kind, uint32_t first, uint32_t second, FilterType type);
+	typedef void (*SwFilterDelCallback)(uint16_t index, bool delete_all);
+	typedef void (*SwFilterListCallback)(void);
 	typedef void (*WriteCallback)(uint32_t id, uint8_t* data, uint8_t dlc);
 	typedef void (*WriteSeqCallback)(uint32_t id,uint8_t* data, uint8_t dlc,
-	                                 uint32_t count, uint32_t interval_ms);
+	                                 uint32_t count, uint32_t interval_us);
+	typedef void (*SeqListCallback)(void);
+	typedef void (*SeqStopCallback)(uint32_t id, bool stop_all);
+	typedef void (*SeqDataCallback)(uint32_t id, uint8_t* data, uint8_t dlc);
+	typedef void (*ReplayStatusCallback)(void);
+	typedef void (*ReplayStopCallback)(void);
+	typedef void (*TraceAddCallback)(uint32_t delta_us, uint32_t id, uint8_t* data, uint8_t dlc);
+	typedef void (*TraceControlCallback)(TraceAction action, uint32_t loops, uint16_t speed_percent);
 	typedef void (*ReadRawCallback)(void);
 	typedef void (*ReadParsedCallback)(void);
+	typedef void (*ReadBinaryCallback)(void);
+	typedef void (*ReadColorCallback)(bool enable);
+	typedef void (*ReadChangesCallback)(uint32_t interval_ms);
 	typedef void (*ErrorCallback)(const char* error_msg);
 	typedef void (*HandleBusLoadMonitorCallback)(bool enable);
 	typedef void (*HandleBusLoadStatusCallback)(void);
+	typedef void (*StatsCallback)(uint16_t limit);
+	typedef void (*StatsResetCallback)(void);
 
     static constexpr uint16_t COMMAND_SIZE = 30;
 
@@ -39,16 +58,35 @@ public:
 			CanStartCallback can_start_cb,
 			CanStopCallback can_stop_cb,
 			CanInfoCallback can_info_cb,
+			CanStatsCallback can_stats_cb,
+			CanBatchCallback can_batch_cb,
+			CanBenchCallback can_bench_cb,
 			FilterAddCallback filter_add_cb,
 			FilterDelCallback filter_del_cb,
 			FilterListCallback filter_list_cb,
+			FilterLoadCallback filter_load_cb,
+			SwFilterAddCallback sw_filter_add_cb,
+			SwFilterDelCallback sw_filter_del_cb,
+			SwFilterListCallback sw_filter_list_cb,
 			WriteCallback write_cb,
 			WriteSeqCallback write_seq_cb,
+			SeqListCallback seq_list_cb,
+			SeqStopCallback seq_stop_cb,
+			SeqDataCallback seq_data_cb,
+			ReplayStatusCallback replay_status_cb,
+			ReplayStopCallback replay_stop_cb,
+			TraceAddCallback trace_add_cb,
+			TraceControlCallback trace_control_cb,
 			ReadRawCallback read_raw_cb,
 			ReadParsedCallback read_parsed_cb,
+			ReadBinaryCallback read_binary_cb,
+			ReadColorCallback read_color_cb,
+			ReadChangesCallback read_changes_cb,
 			ErrorCallback error_cb,
 			HandleBusLoadMonitorCallback handle_bus_load_monitor_cb,
-			HandleBusLoadStatusCallback  handle_bus_load_status_cb
+			HandleBusLoadStatusCallback  handle_bus_load_status_cb,
+			StatsCallback stats_cb,
+			StatsResetCallback stats_reset_cb
 			);
 
     ~CommandProcessor() = default;
@@ -64,16 +102,35 @@ private:
 	CanStartCallback can_start_callback_;
 	CanStopCallback can_stop_callback_;
 	CanInfoCallback can_info_callback_;
+	CanStatsCallback can_stats_callback_;
+	CanBatchCallback can_batch_callback_;
+	CanBenchCallback can_bench_callback_;
 	FilterAddCallback filter_add_callback_;
 	FilterDelCallback filter_del_callback_;
 	FilterListCallback filter_list_callback_;
+	FilterLoadCallback filter_load_callback_;
+	SwFilterAddCallback sw_filter_add_callback_;
+	SwFilterDelCallback sw_filter_del_callback_;
+	SwFilterListCallback sw_filter_list_callback_;
 	WriteCallback write_callback_;
 	WriteSeqCallback write_seq_callback_;
+	SeqListCallback seq_list_callback_;
+	SeqStopCallback seq_stop_callback_;
+	SeqDataCallback seq_data_callback_;
+	ReplayStatusCallback replay_status_callback_;
+	ReplayStopCallback replay_stop_callback_;
+	TraceAddCallback trace_add_callback_;
+	TraceControlCallback trace_control_callback_;
 	ReadRawCallback read_raw_callback_;
 	ReadParsedCallback read_parsed_callback_;
+	ReadBinaryCallback read_binary_callback_;
+	ReadColorCallback read_color_callback_;
+	ReadChangesCallback read_changes_callback_;
 	ErrorCallback error_callback_;
 	HandleBusLoadMonitorCallback handle_bus_load_monitor_callback_;
 	HandleBusLoadStatusCallback  handle_bus_load_status_callback_;
+	StatsCallback stats_callback_;
+	StatsResetCallback stats_reset_callback_;
 };
 
 
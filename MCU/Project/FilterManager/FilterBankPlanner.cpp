@@ -0,0 +1,263 @@
+/*
+ * FilterBankPlanner.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "FilterBankPlanner.h"
+#include <cstring>
+
+// Раскладка полей в регистрах фильтра (RM0090, "Filter bank scale and mode")
+// 32 бита: STID[10:0] EXID[17:0] IDE RTR 0
+// 16 бит:  STID[10:0] RTR IDE EXID[17:15]
+static constexpr uint32_t REG32_IDE = 0x04;
+static constexpr uint32_t REG32_RTR = 0x02;
+static constexpr uint32_t REG16_IDE = 0x08;
+static constexpr uint32_t REG16_RTR = 0x10;
+
+static inline uint32_t reg32Id(uint32_t id, bool is_extended) {
+    return is_extended ? ((id << 3) | REG32_IDE) : (id << 21);
+}
+
+// Бит IDE в маске сравнивается всегда: STD-фильтр не пропускает EXT и наоборот
+static inline uint32_t reg32Mask(uint32_t mask, bool is_extended) {
+    return is_extended ? ((mask << 3) | REG32_IDE) : ((mask << 21) | REG32_IDE);
+}
+
+static inline uint32_t reg16Id(uint32_t id) {
+    return id << 5;
+}
+
+static inline uint32_t reg16Mask(uint32_t mask) {
+    return (mask << 5) | REG16_IDE;
+}
+
+// Пара слотов list-режима под один точный STD ID: младший - данные, старший - RTR
+static inline uint32_t reg16Pair(uint32_t id) {
+    return ((reg16Id(id) | REG16_RTR) << 16) | reg16Id(id);
+}
+
+FilterBankPlanner::FilterBankPlanner() {
+    memset(&plan_, 0, sizeof(plan_));
+    build(nullptr, 0);
+}
+
+const char* FilterBankPlanner::layoutToString(Layout layout) {
+    switch (layout) {
+        case Layout::List16: return "LIST16";
+        case Layout::Mask16: return "MASK16";
+        case Layout::List32: return "LIST32";
+        case Layout::Mask32: return "MASK32";
+        default: return "UNKNOWN";
+    }
+}
+
+bool FilterBankPlanner::covers(const Entry& outer, const Entry& inner) {
+    return outer.is_extended == inner.is_extended
+        && (outer.mask & ~inner.mask) == 0
+        && ((outer.id ^ inner.id) & outer.mask) == 0;
+}
+
+bool FilterBankPlanner::reduceOnce(Entry* entries, uint16_t& count, bool combine) {
+    for (uint16_t i = 0; i < count; i++) {
+        for (uint16_t j = 0; j < count; j++) {
+            if (i != j && covers(entries[j], entries[i])) {
+                entries[i] = entries[--count];
+                return true;
+            }
+        }
+    }
+
+    if (!combine) {
+        return false;
+    }
+
+    // Одинаковые маски, ID различаются ровно одним битом: этот бит - в "не важно"
+    for (uint16_t i = 0; i < count; i++) {
+        for (uint16_t j = i + 1; j < count; j++) {
+            uint32_t diff = entries[i].id ^ entries[j].id;
+            if (entries[i].is_extended == entries[j].is_extended
+                && entries[i].mask == entries[j].mask
+                && diff != 0 && (diff & (diff - 1)) == 0) {
+                entries[i].mask &= ~diff;
+                entries[i].id &= entries[i].mask;
+                entries[j] = entries[--count];
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+uint16_t FilterBankPlanner::reduce(Entry* entries, uint16_t count, bool combine) {
+    while (reduceOnce(entries, count, combine)) {
+    }
+    return count;
+}
+
+FilterBankPlanner::Counts FilterBankPlanner::countKinds(const Entry* entries, uint16_t count) {
+    Counts counts = {};
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (entries[i].is_extended) {
+            isExact(entries[i]) ? counts.ext_ids++ : counts.ext_masks++;
+        } else {
+            isExact(entries[i]) ? counts.std_ids++ : counts.std_masks++;
+        }
+    }
+    return counts;
+}
+
+uint16_t FilterBankPlanner::banksNeeded(const Counts& counts) {
+    // Нечетный хвост STD масок оставляет слот под точный STD ID
+    uint16_t free_slots = counts.std_masks & 1;
+    uint16_t std_ids = (counts.std_ids > free_slots) ? counts.std_ids - free_slots : 0;
+
+    return counts.ext_masks
+         + counts.ext_ids
+         + (counts.std_masks + 1) / 2
+         + (std_ids + 1) / 2;
+}
+
+uint8_t FilterBankPlanner::addBank(Plan& plan, Layout layout, uint32_t fr1, uint32_t fr2) {
+    uint8_t bank = plan.bank_count++;
+    plan.banks[bank] = { layout, fr1, fr2 };
+    return bank;
+}
+
+bool FilterBankPlanner::layout(const Entry* entries, uint16_t count, Plan& plan) {
+    if (banksNeeded(countKinds(entries, count)) > MAX_BANKS) {
+        return false;
+    }
+
+    plan.bank_count = 0;
+    plan.entry_count = count;
+    plan.accept_all = false;
+
+    // Незанятые слоты заполняются копией первого значения банка
+    int16_t open_mask16 = -1;
+    int16_t open_list16 = -1;
+
+    for (uint16_t i = 0; i < count; i++) {
+        const Entry& entry = entries[i];
+        if (!entry.is_extended || isExact(entry)) continue;
+
+        entry_bank_[i] = addBank(plan, Layout::Mask32, reg32Id(entry.id, true), reg32Mask(entry.mask, true));
+        entry_slot_[i] = 0;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        const Entry& entry = entries[i];
+        if (!entry.is_extended || !isExact(entry)) continue;
+
+        uint32_t value = reg32Id(entry.id, true);
+        entry_bank_[i] = addBank(plan, Layout::List32, value, value | REG32_RTR);
+        entry_slot_[i] = 0;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        const Entry& entry = entries[i];
+        if (entry.is_extended || isExact(entry)) continue;
+
+        uint32_t value = (reg16Mask(entry.mask) << 16) | reg16Id(entry.id);
+        if (open_mask16 >= 0) {
+            plan.banks[open_mask16].fr2 = value;
+            entry_bank_[i] = open_mask16;
+            entry_slot_[i] = 1;
+            open_mask16 = -1;
+        } else {
+            open_mask16 = entry_bank_[i] = addBank(plan, Layout::Mask16, value, value);
+            entry_slot_[i] = 0;
+        }
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        const Entry& entry = entries[i];
+        if (entry.is_extended || !isExact(entry)) continue;
+
+        if (open_mask16 >= 0) {
+            plan.banks[open_mask16].fr2 = (reg16Mask(STD_ID_MASK) << 16) | reg16Id(entry.id);
+            entry_bank_[i] = open_mask16;
+            entry_slot_[i] = 1;
+            open_mask16 = -1;
+        } else if (open_list16 < 0) {
+            uint32_t value = reg16Pair(entry.id);
+            open_list16 = entry_bank_[i] = addBank(plan, Layout::List16, value, value);
+            entry_slot_[i] = 0;
+        } else {
+            // Слоты по порядку: FR1[15:0], FR1[31:16], FR2[15:0], FR2[31:16]
+            plan.banks[open_list16].fr2 = reg16Pair(entry.id);
+            entry_bank_[i] = open_list16;
+            entry_slot_[i] = 2;
+            open_list16 = -1;
+        }
+    }
+
+    plan.spare_std_slots = (open_mask16 >= 0) + (open_list16 >= 0);
+    return true;
+}
+
+uint16_t FilterBankPlanner::getExactStdRoom() const {
+    if (plan_.accept_all) {
+        return MAX_BANKS * 2;
+    }
+    return (MAX_BANKS - plan_.bank_count) * 2 + plan_.spare_std_slots;
+}
+
+bool FilterBankPlanner::build(const Request* requests, uint16_t count) {
+    if (count > MAX_REQUESTS) {
+        return false;
+    }
+
+    if (count == 0) {
+        // Как CanDriver::setFilterAcceptAll: пара банков делит поток по STID[0]
+        candidate_.bank_count = 0;
+        candidate_.entry_count = 0;
+        candidate_.accept_all = true;
+        candidate_.spare_std_slots = 0;
+        addBank(candidate_, Layout::Mask32, reg32Id(0, false), 1U << 21);
+        addBank(candidate_, Layout::Mask32, reg32Id(1, false), 1U << 21);
+        plan_ = candidate_;
+        return true;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t mask = requests[i].mask & fullMask(requests[i].is_extended);
+        covering_[i] = { requests[i].id & mask, mask, requests[i].is_extended };
+        merged_[i] = covering_[i];
+    }
+
+    // Склейка пар может как сэкономить банки (4 ID -> 1 маска), так и
+    // добавить (2 ID из списка -> отдельная маска) - берем лучший вариант
+    uint16_t covering_count = reduce(covering_, count, false);
+    uint16_t merged_count = reduce(merged_, count, true);
+
+    const Entry* entries = covering_;
+    uint16_t entry_count = covering_count;
+    if (banksNeeded(countKinds(merged_, merged_count)) < banksNeeded(countKinds(covering_, covering_count))) {
+        entries = merged_;
+        entry_count = merged_count;
+    }
+
+    if (!layout(entries, entry_count, candidate_)) {
+        return false;
+    }
+
+    for (uint16_t r = 0; r < count; r++) {
+        uint32_t mask = requests[r].mask & fullMask(requests[r].is_extended);
+        Entry request = { requests[r].id & mask, mask, requests[r].is_extended };
+
+        for (uint16_t e = 0; e < entry_count; e++) {
+            if (covers(entries[e], request)) {
+                candidate_.bank_of[r] = entry_bank_[e];
+                candidate_.slot_of[r] = entry_slot_[e];
+                break;
+            }
+        }
+    }
+
+    plan_ = candidate_;
+    return true;
+}
@@ -0,0 +1,110 @@
+/*
+ * FilterBankPlanner.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef FILTERMANAGER_FILTERBANKPLANNER_H_
+#define FILTERMANAGER_FILTERBANKPLANNER_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Раскладка набора фильтров по банкам bxCAN с минимальным числом банков.
+// Емкость банка по видам фильтров:
+//   16-bit list - 2 точных STD ID     16-bit mask - 2 STD маски
+//   32-bit list - 1 точный EXT ID     32-bit mask - 1 маска (нужна для EXT)
+// List-режим сравнивает и бит RTR, поэтому точный ID занимает два слота:
+// кадр данных и remote-кадр - как маска, которой RTR безразличен.
+// Перед раскладкой поглощенные фильтры выбрасываются, а пары с одной
+// маской, отличающиеся одним битом, склеиваются в маску пошире (без
+// изменения множества принимаемых ID). Свободный слот в банке 16-bit mask
+// занимает оставшийся точный STD ID.
+// Цена приема RTR: точных STD ID помещается 28 (2 на банк), а не 56.
+// MAX_REQUESTS остается 56 - столько запросов вмещает план, если часть
+// из них поглощается или склеивается в маски.
+class FilterBankPlanner {
+public:
+    static constexpr uint8_t  MAX_BANKS    = 14;   // Банки CAN1 (14..27 отданы CAN2)
+    static constexpr uint16_t MAX_REQUESTS = MAX_BANKS * 4;
+
+    static constexpr uint32_t STD_ID_MASK = 0x7FF;
+    static constexpr uint32_t EXT_ID_MASK = 0x1FFFFFFF;
+
+    struct Request {
+        uint32_t id;
+        uint32_t mask;
+        bool is_extended;
+    };
+
+    enum class Layout : uint8_t {
+        List16,
+        Mask16,
+        List32,
+        Mask32
+    };
+
+    // Готовые значения регистров банка (CAN_FxR1 / CAN_FxR2)
+    struct Bank {
+        Layout layout;
+        uint32_t fr1;
+        uint32_t fr2;
+    };
+
+    struct Plan {
+        Bank banks[MAX_BANKS];
+        uint8_t bank_count;
+        uint16_t entry_count;              // Фильтров после склейки
+        bool accept_all;                   // Запросов нет - пара банков "принимать все"
+        uint8_t spare_std_slots;           // Свободные слоты под точный STD ID в занятых банках
+        uint8_t bank_of[MAX_REQUESTS];     // Куда попал каждый запрос
+        uint8_t slot_of[MAX_REQUESTS];
+    };
+
+    FilterBankPlanner();
+
+    // false - набор не помещается в MAX_BANKS банков, прошлый план не тронут
+    bool build(const Request* requests, uint16_t count);
+    const Plan& getPlan() const { return plan_; }
+
+    // Сколько еще точных STD ID гарантированно поместится в текущий план
+    uint16_t getExactStdRoom() const;
+
+    static const char* layoutToString(Layout layout);
+
+private:
+    struct Entry {
+        uint32_t id;    // Уже умножен на mask
+        uint32_t mask;
+        bool is_extended;
+    };
+
+    struct Counts {
+        uint16_t std_ids;
+        uint16_t std_masks;
+        uint16_t ext_ids;
+        uint16_t ext_masks;
+    };
+
+    Entry covering_[MAX_REQUESTS];   // Только поглощение
+    Entry merged_[MAX_REQUESTS];     // Поглощение + склейка пар
+    uint8_t entry_bank_[MAX_REQUESTS];
+    uint8_t entry_slot_[MAX_REQUESTS];
+    Plan candidate_;
+    Plan plan_;
+
+    static uint32_t fullMask(bool is_extended) { return is_extended ? EXT_ID_MASK : STD_ID_MASK; }
+    static bool isExact(const Entry& entry) { return entry.mask == fullMask(entry.is_extended); }
+    static bool covers(const Entry& outer, const Entry& inner);
+
+    static bool reduceOnce(Entry* entries, uint16_t& count, bool combine);
+    static uint16_t reduce(Entry* entries, uint16_t count, bool combine);
+    static Counts countKinds(const Entry* entries, uint16_t count);
+    static uint16_t banksNeeded(const Counts& counts);
+
+    bool layout(const Entry* entries, uint16_t count, Plan& plan);
+    uint8_t addBank(Plan& plan, Layout layout, uint32_t fr1, uint32_t fr2);
+};
+
+#endif /* FILTERMANAGER_FILTERBANKPLANNER_H_ */
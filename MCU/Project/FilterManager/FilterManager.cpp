@@ -7,21 +7,16 @@
 #include "FilterManager.h"
 #include <cstdio>
 
-FilterManager::FilterManager(PrintCallback print_cb,
-							ConfigureFilterCallback config_filter_cb,
-							DisableFilterCallback disable_filter_cb,
-							DisableAllFiltersCallback disable_all_filters_cb)
+FilterManager::FilterManager(PrintCallback print_cb, ApplyPlanCallback apply_plan_cb)
     : active_filter_count_(0),
-      used_bank_count_(0),
+      loading_(false),
+      saved_filter_count_(0),
 	  print_callback_(print_cb),
-	  config_filter_callback_(config_filter_cb),
-	  disable_filter_callback_(disable_filter_cb),
-	  disable_all_filters_callback_(disable_all_filters_callback_){
-    // Инициализация всех банков
-    for (auto& bank : banks_) {
-        bank.is_used = false;
-        bank.used_slots = 0;
+	  apply_plan_callback_(apply_plan_cb){
+    for (auto& filter : filters_) {
+        filter.clear();
     }
+    rebuildIndex();
 }
 
 bool FilterManager::addFilter(uint32_t id, uint32_t mask, FilterType type) {
@@ -38,79 +33,66 @@ bool FilterManager::addFilter(uint32_t id, uint32_t mask, FilterType type) {
         return false;
     }
 
-    if (active_filter_count_ >= MAX_FILTERS) {
+    int index = findFreeIndex();
+    if (index < 0) {
     	print_callback_("ERROR: Filter limit reached (%zu/%zu)\r\n",
                active_filter_count_, MAX_FILTERS);
         return false;
     }
 
-    FilterSlot slot = findFreeSlot();
-    if (!slot.isValid()) {
-    	print_callback_("ERROR: No free filter slots available\r\n");
-        return false;
-    }
-
-    uint8_t bank_num = slot.bank;
-    uint8_t slot_num = slot.slot;
-
-    Bank& bank = banks_[bank_num];
-
-    FilterInfo& filter_info = bank.filters[slot_num];
+    FilterInfo& filter_info = filters_[index];
     filter_info.id = id;
     filter_info.mask = mask;
     filter_info.type = type;
     filter_info.status = FilterStatus::ACTIVE;
-    filter_info.bank_number = bank_num;
-    filter_info.filter_index = slot_num;
+    active_filter_count_++;
+    indexInsert(index);
 
-    if (!config_filter_callback_(bank_num, slot_num, id, mask, (bool)type)) {
-    	print_callback_("ERROR: Failed to configure hardware filter\r\n");
-        filter_info.status = FilterStatus::ERROR;
-        return false;
+    if (loading_) {
+        return true;
     }
 
-    if (!bank.is_used) {
-        bank.is_used = true;
-        used_bank_count_++;
+    if (!replan()) {
+        indexErase(id);
+        filter_info.clear();
+        active_filter_count_--;
+        return false;
     }
 
-    bank.used_slots++;
-    active_filter_count_++;
-
     print_callback_("OK: Filter added - ID: 0x%08lX, Mask: 0x%08lX, Type: %s, Bank: %d, Slot: %d\r\n",
-           id, mask, filterTypeToString(type), bank_num, slot_num);
+           id, mask, filterTypeToString(type), filter_info.bank_number, filter_info.filter_index);
 
     return true;
 }
 
 bool FilterManager::removeFilter(uint32_t id) {
-    FilterSlot slot = findFilterSlot(id);
-    if (!slot.isValid()) {
+    int index = findFilterIndex(id);
+    if (index < 0) {
     	print_callback_("ERROR: Filter with ID 0x%08lX not found\r\n", id);
         return false;
     }
 
-    uint8_t bank_num = slot.bank;
-    uint8_t slot_num = slot.slot;
-
-    Bank& bank = banks_[bank_num];
-    FilterInfo& filter_info = bank.filters[slot_num];
-
-    if (!disable_filter_callback_(bank_num, slot_num)) {
-    	print_callback_("WARNING: Failed to disable hardware filter\r\n");
-    }
+    FilterInfo& filter_info = filters_[index];
+    FilterInfo saved = filter_info;
 
+    indexErase(id);
     filter_info.status = FilterStatus::INACTIVE;
-    bank.used_slots--;
     active_filter_count_--;
 
-    if (bank.used_slots == 0) {
-        bank.is_used = false;
-        used_bank_count_--;
+    if (loading_) {
+        return true;
+    }
+
+    if (!replan()) {
+        // Меньший набор помещается всегда, не удалось только программирование
+        filter_info = saved;
+        active_filter_count_++;
+        indexInsert(index);
+        return false;
     }
 
     print_callback_("OK: Filter removed - ID: 0x%08lX, Bank: %d, Slot: %d\r\n",
-           id, bank_num, slot_num);
+           id, saved.bank_number, saved.filter_index);
 
     return true;
 }
@@ -118,27 +100,66 @@ bool FilterManager::removeFilter(uint32_t id) {
 void FilterManager::removeAllFilters() {
 	print_callback_("Removing all filters...\r\n");
 
-    disable_all_filters_callback_();
+    for (auto& filter : filters_) {
+        filter.clear();
+    }
+    active_filter_count_ = 0;
+    rebuildIndex();
+
+    // Пустой набор - снова "принимать все"
+    if (!loading_) {
+        replan();
+    }
 
-    for (auto& bank : banks_) {
-        bank.is_used = false;
-        bank.used_slots = 0;
+    print_callback_("OK: All filters removed\r\n");
+}
 
-        for (auto& filter : bank.filters) {
-            filter.status = FilterStatus::INACTIVE;
+void FilterManager::beginLoad() {
+    if (!loading_) {
+        for (size_t i = 0; i < MAX_FILTERS; i++) {
+            saved_filters_[i] = filters_[i];
         }
+        saved_filter_count_ = active_filter_count_;
     }
 
+    for (auto& filter : filters_) {
+        filter.clear();
+    }
     active_filter_count_ = 0;
-    used_bank_count_ = 0;
+    rebuildIndex();
+    loading_ = true;
+}
 
-    print_callback_("OK: All filters removed\r\n");
+bool FilterManager::commitLoad() {
+    if (!loading_) {
+        return false;
+    }
+    loading_ = false;
+
+    if (replan()) {
+        print_callback_("OK: %zu filters loaded into %zu banks\r\n",
+               active_filter_count_, getUsedBankCount());
+        return true;
+    }
+
+    // Банки не трогались: прежний набор в них и остался
+    abortLoad();
+    return false;
+}
+
+void FilterManager::abortLoad() {
+    loading_ = false;
+    for (size_t i = 0; i < MAX_FILTERS; i++) {
+        filters_[i] = saved_filters_[i];
+    }
+    active_filter_count_ = saved_filter_count_;
+    rebuildIndex();
 }
 
 const FilterManager::FilterInfo* FilterManager::findFilter(uint32_t id) const {
-    FilterSlot slot = findFilterSlot(id);
-    if (slot.isValid()) {
-        return &banks_[slot.bank].filters[slot.slot];
+    int index = findFilterIndex(id);
+    if (index >= 0) {
+        return &filters_[index];
     }
     return nullptr;
 }
@@ -147,19 +168,21 @@ bool FilterManager::filterExists(uint32_t id) const {
     return findFilter(id) != nullptr;
 }
 
+size_t FilterManager::getFreeFilterCount() const {
+    size_t free_entries = MAX_FILTERS - active_filter_count_;
+    size_t room = planner_.getExactStdRoom();
+    return (room < free_entries) ? room : free_entries;
+}
+
 size_t FilterManager::getActiveFilters(FilterInfo* buffer, size_t buffer_size) const {
     if (!buffer || buffer_size == 0) {
         return 0;
     }
 
     size_t count = 0;
-    for (const auto& bank : banks_) {
-        if (!bank.is_used) continue;
-
-        for (const auto& filter : bank.filters) {
-            if (filter.status == FilterStatus::ACTIVE && count < buffer_size) {
-                buffer[count++] = filter;
-            }
+    for (const auto& filter : filters_) {
+        if (filter.status == FilterStatus::ACTIVE && count < buffer_size) {
+            buffer[count++] = filter;
         }
     }
 
@@ -167,33 +190,31 @@ size_t FilterManager::getActiveFilters(FilterInfo* buffer, size_t buffer_size) c
 }
 
 void FilterManager::printFilterList() const {
+    const FilterBankPlanner::Plan& plan = planner_.getPlan();
+
     print_callback_("\r\n=== Active Filters ===\r\n");
-    print_callback_("Total: %zu/%zu filters, %zu/%zu banks used\r\n",
+    print_callback_("Total: %zu/%zu filters, %u/%zu banks used, %u after merge\r\n",
            active_filter_count_, MAX_FILTERS,
-           used_bank_count_, MAX_BANKS);
+           plan.bank_count, MAX_BANKS, plan.entry_count);
     print_callback_("--------------------------------\r\n");
 
     if (active_filter_count_ == 0) {
     	print_callback_("No active filters\r\n");
     } else {
-    	print_callback_("#  Bank Slot ID         Mask        Type Status\r\n");
+    	print_callback_("#  Bank Slot ID         Mask        Type Layout\r\n");
     	print_callback_("-- ---- ---- ---------- ---------- ---- ------\r\n");
 
         size_t index = 1;
-        for (const auto& bank : banks_) {
-            if (!bank.is_used) continue;
-
-            for (const auto& filter : bank.filters) {
-                if (filter.status == FilterStatus::ACTIVE) {
-                	print_callback_("%-2zu %-4d %-4d 0x%08lX 0x%08lX %-4s %-6s\r\n",
-                           index++,
-                           filter.bank_number,
-                           filter.filter_index,
-                           filter.id,
-                           filter.mask,
-                           filterTypeToString(filter.type),
-                           filterStatusToString(filter.status));
-                }
+        for (const auto& filter : filters_) {
+            if (filter.status == FilterStatus::ACTIVE) {
+            	print_callback_("%-2zu %-4d %-4d 0x%08lX 0x%08lX %-4s %-6s\r\n",
+                       index++,
+                       filter.bank_number,
+                       filter.filter_index,
+                       filter.id,
+                       filter.mask,
+                       filterTypeToString(filter.type),
+                       FilterBankPlanner::layoutToString(plan.banks[filter.bank_number].layout));
             }
         }
     }
@@ -252,46 +273,101 @@ bool FilterManager::isValidMask(uint32_t mask, FilterType type) {
 
 // Private methods
 
-FilterManager::FilterSlot FilterManager::findFreeSlot() {
-    // Сначала ищем банк с одним свободным слотом
-    for (uint8_t bank_num = 0; bank_num < MAX_BANKS; bank_num++) {
-        Bank& bank = banks_[bank_num];
+bool FilterManager::replan() {
+    uint16_t count = 0;
+    for (uint8_t i = 0; i < MAX_FILTERS; i++) {
+        const FilterInfo& filter = filters_[i];
+        if (filter.status != FilterStatus::ACTIVE) continue;
 
-        if (bank.is_used && bank.hasFreeSlot()) {
-            uint8_t slot = bank.getFreeSlot();
-            if (slot < 2) {
-                return FilterSlot(bank_num, slot);
-            }
-        }
+        requests_[count] = { filter.id, filter.mask, filter.type == FilterType::EXT };
+        request_owner_[count] = i;
+        count++;
     }
 
-    // Если нет, ищем полностью свободный банк
-    for (uint8_t bank_num = 0; bank_num < MAX_BANKS; bank_num++) {
-        Bank& bank = banks_[bank_num];
+    if (!planner_.build(requests_, count)) {
+    	print_callback_("ERROR: Filter set does not fit into %zu banks\r\n", MAX_BANKS);
+        return false;
+    }
 
-        if (!bank.is_used) {
-            return FilterSlot(bank_num, 0);  // Первый слот свободного банка
-        }
+    const FilterBankPlanner::Plan& plan = planner_.getPlan();
+    if (!apply_plan_callback_(plan)) {
+    	print_callback_("ERROR: Failed to configure hardware filters\r\n");
+        return false;
+    }
+
+    for (uint16_t r = 0; r < count; r++) {
+        FilterInfo& filter = filters_[request_owner_[r]];
+        filter.bank_number = plan.bank_of[r];
+        filter.filter_index = plan.slot_of[r];
     }
 
-    return FilterSlot();  // Нет свободных мест
+    return true;
 }
 
-FilterManager::FilterSlot FilterManager::findFilterSlot(uint32_t id) const {
-    for (uint8_t bank_num = 0; bank_num < MAX_BANKS; bank_num++) {
-        const Bank& bank = banks_[bank_num];
+int FilterManager::findFreeIndex() const {
+    if (free_slots_ == 0) {
+        return -1;
+    }
+    return __builtin_ctzll(free_slots_);
+}
 
-        if (!bank.is_used) continue;
+int FilterManager::findFilterIndex(uint32_t id) const {
+    uint8_t slot = slotFor(id);
 
-        for (uint8_t slot = 0; slot < 2; slot++) {
-            if (bank.filters[slot].status == FilterStatus::ACTIVE &&
-                bank.filters[slot].id == id) {
-                return FilterSlot(bank_num, slot);
-            }
+    while (index_[slot] != EMPTY_SLOT) {
+        uint8_t filter_index = index_[slot] - 1;
+        if (filters_[filter_index].id == id) {
+            return filter_index;
         }
+        slot = (slot + 1) & INDEX_MASK;
     }
+    return -1;  // Не найден
+}
+
+void FilterManager::indexInsert(uint8_t filter_index) {
+    uint8_t slot = slotFor(filters_[filter_index].id);
+
+    while (index_[slot] != EMPTY_SLOT) {
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    index_[slot] = filter_index + 1;
+    free_slots_ &= ~(1ULL << filter_index);
+}
+
+void FilterManager::indexErase(uint32_t id) {
+    uint8_t hole = slotFor(id);
+
+    while (index_[hole] != EMPTY_SLOT && filters_[index_[hole] - 1].id != id) {
+        hole = (hole + 1) & INDEX_MASK;
+    }
+    if (index_[hole] == EMPTY_SLOT) {
+        return;
+    }
+    // Карта свободных слотов ведется парой indexInsert/indexErase
+    free_slots_ |= (1ULL << (index_[hole] - 1));
+
+    // Сдвигаем назад элементы цепочки, чей "домашний" слот не между дырой и ними
+    uint8_t next = (hole + 1) & INDEX_MASK;
+    while (index_[next] != EMPTY_SLOT) {
+        uint8_t home = slotFor(filters_[index_[next] - 1].id);
+        if (((next - home) & INDEX_MASK) >= ((next - hole) & INDEX_MASK)) {
+            index_[hole] = index_[next];
+            hole = next;
+        }
+        next = (next + 1) & INDEX_MASK;
+    }
+    index_[hole] = EMPTY_SLOT;
+}
+
+void FilterManager::rebuildIndex() {
+    memset(index_, EMPTY_SLOT, sizeof(index_));
+    free_slots_ = (MAX_FILTERS == 64) ? ~0ULL : ((1ULL << MAX_FILTERS) - 1);
 
-    return FilterSlot();  // Не найден
+    for (uint8_t i = 0; i < MAX_FILTERS; i++) {
+        if (filters_[i].status == FilterStatus::ACTIVE) {
+            indexInsert(i);
+        }
+    }
 }
 
 uint32_t FilterManager::getDefaultMask(FilterType type) const {
@@ -11,28 +11,14 @@
 #include <cstdint>
 #include <cstddef>
 #include <cstring>
+#include "FilterBankPlanner.h"
 
 class FilterManager {
 public:
 
     typedef void (*PrintCallback)(const char* format, ...);
-    typedef bool (*ConfigureFilterCallback)(uint8_t bank, uint8_t slot,
-											uint32_t id, uint32_t mask,
-											bool is_extended);
-    typedef bool (*DisableFilterCallback) (uint8_t bank, uint8_t slot);
-    typedef void (*DisableAllFiltersCallback)(void);
-
-
-    struct FilterSlot {
-        uint8_t bank;
-        uint8_t slot;
-        bool valid;
-
-        FilterSlot() : bank(0xFF), slot(0xFF), valid(false) {}
-        FilterSlot(uint8_t b, uint8_t s) : bank(b), slot(s), valid(true) {}
-
-        bool isValid() const { return valid; }
-    };
+    // Атомарно программирует банки по плану (CanDriver::applyFilterPlan)
+    typedef bool (*ApplyPlanCallback)(const FilterBankPlanner::Plan& plan);
 
     enum class FilterType {
         STD = 0,  // Стандартный (11-bit)
@@ -51,7 +37,7 @@ public:
         FilterType type;
         FilterStatus status;
         uint8_t bank_number;
-        uint8_t filter_index;  // 0 или 1 для 16-битного режима
+        uint8_t filter_index;  // Слот в банке: 0 или 2 для 16-bit list (ID + RTR), 0..1 для остальных
 
         FilterInfo() : id(0), mask(0), type(FilterType::STD),
                       status(FilterStatus::INACTIVE),
@@ -68,21 +54,28 @@ public:
     };
 
     // Конфигурация
-    static constexpr size_t MAX_FILTERS = 28;      // Максимум фильтров (14 банков × 2)
-    static constexpr size_t MAX_BANKS = 14;        // Для STM32F1xx
+    static constexpr size_t MAX_FILTERS = FilterBankPlanner::MAX_REQUESTS;  // Записей; точных STD ID - не больше 28
+    static constexpr size_t MAX_BANKS = FilterBankPlanner::MAX_BANKS;
     static constexpr uint32_t STD_MASK_DEFAULT = 0x7FF;      // Маска по умолчанию для STD
     static constexpr uint32_t EXT_MASK_DEFAULT = 0x1FFFFFFF; // Маска по умолчанию для EXT
 
-    FilterManager(PrintCallback print_cb,
-    		ConfigureFilterCallback config_filter_cb,
-			DisableFilterCallback disable_filter_cb,
-			DisableAllFiltersCallback disable_all_filters_cb);
+    FilterManager(PrintCallback print_cb, ApplyPlanCallback apply_plan_cb);
 
-    // Основные методы
+    // Основные методы. Любое изменение пересчитывает раскладку всех фильтров
+    // по банкам; если новый набор не помещается, остается прежний
     bool addFilter(uint32_t id, uint32_t mask = 0, FilterType type = FilterType::STD);
     bool removeFilter(uint32_t id);
     void removeAllFilters();
 
+    // Пакетная загрузка: beginLoad() очищает набор, addFilter()/removeFilter()
+    // только копят изменения (без перепрограммирования и без вывода),
+    // commitLoad() программирует банки один раз. Если новый набор не
+    // помещается, commitLoad()/abortLoad() возвращают прежний.
+    void beginLoad();
+    bool commitLoad();
+    void abortLoad();
+    bool isLoading() const { return loading_; }
+
     // Поиск фильтров
     const FilterInfo* findFilter(uint32_t id) const;
     bool filterExists(uint32_t id) const;
@@ -90,8 +83,10 @@ public:
     // Получение информации
     size_t getActiveFilterCount() const { return active_filter_count_; }
     size_t getTotalFilterCount() const { return MAX_FILTERS; }
-    size_t getUsedBankCount() const { return used_bank_count_; }
-    size_t getFreeFilterCount() const { return MAX_FILTERS - active_filter_count_; }
+    size_t getUsedBankCount() const { return planner_.getPlan().bank_count; }
+    // Свободно: сколько еще точных STD ID точно поместится (по 2 на банк),
+    // но не больше свободных записей. Маски часто склеиваются и влезают сверх
+    size_t getFreeFilterCount() const;
     size_t getActiveFilters(FilterInfo* buffer, size_t buffer_size) const;
 
     // Утилиты
@@ -105,37 +100,42 @@ public:
     static bool isValidMask(uint32_t mask, FilterType type);
 
 private:
-    struct Bank {
-        FilterInfo filters[2];  // 2 фильтра в 16-битном режиме
-        bool is_used;
-        uint8_t used_slots;
-
-        Bank() : is_used(false), used_slots(0) {
-            memset(filters, 0, sizeof(filters));
-        }
+    static constexpr uint8_t INDEX_BITS = 7;
+    static constexpr uint8_t INDEX_SIZE = 1 << INDEX_BITS;  // Не меньше 2 * MAX_FILTERS
+    static constexpr uint8_t INDEX_MASK = INDEX_SIZE - 1;
+    static constexpr uint8_t EMPTY_SLOT = 0;                // В индексе хранится номер + 1
 
-        bool hasFreeSlot() const { return used_slots < 2; }
-        uint8_t getFreeSlot() const {
-            for (uint8_t i = 0; i < 2; i++) {
-                if (filters[i].status != FilterStatus::ACTIVE) {
-                    return i;
-                }
-            }
-            return 2;  // Нет свободных слотов
-        }
-    };
+    static_assert(MAX_FILTERS <= 64, "free_slots_ is a 64-bit map");
 
-    Bank banks_[MAX_BANKS];
+    FilterInfo filters_[MAX_FILTERS];
     size_t active_filter_count_;
-    size_t used_bank_count_;
 
-    PrintCallback print_callback_;
-    ConfigureFilterCallback config_filter_callback_;
-    DisableFilterCallback disable_filter_callback_;
-    DisableAllFiltersCallback disable_all_filters_callback_;
+    // ID -> номер в filters_ (открытая адресация, удаление сдвигом без "надгробий")
+    uint8_t index_[INDEX_SIZE];
+    uint64_t free_slots_;                  // Бит i - filters_[i] свободен
 
-    FilterSlot findFreeSlot();
-    FilterSlot findFilterSlot(uint32_t id) const;
+    // Набор до beginLoad() на случай отката
+    bool loading_;
+    FilterInfo saved_filters_[MAX_FILTERS];
+    size_t saved_filter_count_;
+
+    FilterBankPlanner planner_;
+    FilterBankPlanner::Request requests_[MAX_FILTERS];
+    uint8_t request_owner_[MAX_FILTERS];   // Индекс в filters_ для каждого запроса
+
+    PrintCallback print_callback_;
+    ApplyPlanCallback apply_plan_callback_;
+
+    static inline uint8_t slotFor(uint32_t id) {
+        return (id * 0x9E3779B1U) >> (32 - INDEX_BITS);
+    }
+
+    int findFilterIndex(uint32_t id) const;
+    int findFreeIndex() const;
+    void indexInsert(uint8_t filter_index);
+    void indexErase(uint32_t id);
+    void rebuildIndex();
+    bool replan();
     uint32_t getDefaultMask(FilterType type) const;
 };
 
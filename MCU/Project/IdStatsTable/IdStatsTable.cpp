@@ -0,0 +1,165 @@
+/*
+ * IdStatsTable.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "IdStatsTable.h"
+#include <algorithm>
+#include <cstring>
+
+// Секция .ccm_noinit (NOLOAD) не занимает флеш и не обнуляется при старте -
+// индекс чистит reset(), order_ и changed_bytes_ заполняются до чтения
+__attribute__((section(".ccm_noinit")))
+uint16_t IdStatsTable::index_[IdStatsTable::INDEX_SIZE];
+__attribute__((section(".ccm_noinit")))
+uint16_t IdStatsTable::order_[IdStatsTable::MAX_IDS];
+__attribute__((section(".ccm_noinit")))
+uint8_t IdStatsTable::changed_bytes_[IdStatsTable::MAX_IDS];
+
+IdStatsTable::IdStatsTable()
+    : used_(0),
+      untracked_frames_(0) {
+    reset();
+}
+
+void IdStatsTable::reset() {
+    memset(index_, 0, sizeof(index_));
+    used_ = 0;
+    untracked_frames_ = 0;
+}
+
+IdStatsTable::Entry* IdStatsTable::findOrInsert(uint32_t key) {
+    uint32_t slot = slotFor(key);
+
+    // Индекс никогда не заполнен больше чем наполовину - пустой слот найдется
+    while (index_[slot] != EMPTY_SLOT) {
+        Entry& entry = entries_[index_[slot] - 1];
+        if (entry.key == key) {
+            return &entry;
+        }
+        slot = (slot + 1) & INDEX_MASK;
+    }
+
+    if (used_ >= MAX_IDS) {
+        return nullptr;
+    }
+
+    Entry& entry = entries_[used_];
+    memset(&entry, 0, sizeof(entry));
+    entry.key = key;
+    entry.min_period = PERIOD_MAX;
+    changed_bytes_[used_] = 0xFF;
+
+    index_[slot] = ++used_;
+    return &entry;
+}
+
+const IdStatsTable::Entry* IdStatsTable::find(bool is_extended, uint32_t id) const {
+    uint32_t key = makeKey(is_extended, id);
+    uint32_t slot = slotFor(key);
+
+    while (index_[slot] != EMPTY_SLOT) {
+        const Entry& entry = entries_[index_[slot] - 1];
+        if (entry.key == key) {
+            return &entry;
+        }
+        slot = (slot + 1) & INDEX_MASK;
+    }
+
+    return nullptr;
+}
+
+void IdStatsTable::update(bool is_extended, uint32_t id, uint8_t dlc, const uint8_t* data,
+                          bool is_remote, uint32_t timestamp_us) {
+    Entry* entry = findOrInsert(makeKey(is_extended, id));
+    if (entry == nullptr) {
+        untracked_frames_++;
+        return;
+    }
+
+    if (dlc > 8) {
+        dlc = 8;
+    }
+
+    if (entry->count == 0) {
+        // Первый кадр: периода еще нет, данные - точка отсчета для изменений
+        entry->count = 1;
+        entry->last_us = timestamp_us;
+        entry->dlc = dlc;
+        if (!is_remote) {
+            memcpy(entry->data, data, dlc);
+        }
+        return;
+    }
+
+    uint32_t period_us = timestamp_us - entry->last_us;
+    entry->last_us = timestamp_us;
+
+    uint32_t period = period_us >> PERIOD_SHIFT;
+    if (period > PERIOD_MAX) {
+        period = PERIOD_MAX;
+    }
+
+    if (entry->count > 1) {
+        // J += (|D| - J) / 16 в фиксированной точке, с насыщением
+        uint32_t delta = (period > entry->last_period) ? period - entry->last_period
+                                                       : entry->last_period - period;
+        uint32_t jitter = entry->jitter_x16 + delta - ((entry->jitter_x16 + 8U) >> 4);
+        entry->jitter_x16 = (jitter > UINT16_MAX) ? UINT16_MAX : (uint16_t)jitter;
+    }
+    entry->last_period = (uint16_t)period;
+
+    if (period < entry->min_period) {
+        entry->min_period = (uint16_t)period;
+    }
+    if (period > entry->max_period) {
+        entry->max_period = (uint16_t)period;
+    }
+
+    entry->count++;
+
+    // У remote-кадра данных нет, сравнивается только DLC
+    uint8_t diff = 0;
+    if (entry->dlc != dlc) {
+        diff = 0xFF;
+    } else if (!is_remote) {
+        for (uint8_t i = 0; i < dlc; i++) {
+            if (entry->data[i] != data[i]) {
+                diff |= (1U << i);
+            }
+        }
+    }
+
+    if (diff != 0) {
+        if (entry->changes < MAX_CHANGES) {
+            entry->changes = entry->changes + 1;
+        }
+        entry->dlc = dlc;
+        if (!is_remote) {
+            memcpy(entry->data, data, dlc);
+        }
+        changed_bytes_[entry - entries_] |= diff;
+    }
+}
+
+void IdStatsTable::markAllChanged() {
+    memset(changed_bytes_, 0xFF, used_);
+}
+
+uint16_t IdStatsTable::rankByCount() {
+    for (uint16_t i = 0; i < used_; i++) {
+        order_[i] = i;
+    }
+
+    // Сортируются 16-битные номера, а не 32-байтные записи
+    std::sort(order_, order_ + used_, [this](uint16_t a, uint16_t b) {
+        if (entries_[a].count != entries_[b].count) {
+            return entries_[a].count > entries_[b].count;
+        }
+        return entries_[a].key < entries_[b].key;
+    });
+
+    return used_;
+}
@@ -0,0 +1,111 @@
+/*
+ * IdStatsTable.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef IDSTATSTABLE_IDSTATSTABLE_H_
+#define IDSTATSTABLE_IDSTATSTABLE_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Статистика по каждому идентификатору (аналог cansniffer/candump -s).
+// Память фиксирована: плотный пул записей + индекс с открытой адресацией
+// (линейное пробирование). Индекс вдвое больше пула, поэтому заполнение
+// не превышает 50% и обновление на кадр - O(1) в среднем, 1-2 пробы.
+// Записи не удаляются по одной, только reset() целиком.
+// Память: записи по 32 байта (64 КБ) в SRAM, индекс, порядок и маски
+// изменений (14 КБ) - в CCM RAM рядом с буфером трассы.
+class IdStatsTable {
+public:
+    static constexpr uint16_t MAX_IDS    = 2048;          // Размер пула записей
+    static constexpr uint16_t INDEX_BITS = 12;
+    static constexpr uint16_t INDEX_SIZE = 1 << INDEX_BITS;  // Степень двойки, >= 2 * MAX_IDS
+    static constexpr uint16_t INDEX_MASK = INDEX_SIZE - 1;
+
+    static constexpr uint32_t KEY_EXTENDED = 0x80000000;  // Флаг IDE в ключе (ID занимает 29 бит)
+    static constexpr uint32_t MAX_CHANGES  = 0x0FFFFFFF;  // Насыщение счетчика изменений
+
+    // Периоды хранятся в тиках по 16 мкс: 16 бит покрывают ~1 с,
+    // длиннее - насыщение на PERIOD_MAX
+    static constexpr uint8_t  PERIOD_SHIFT = 4;
+    static constexpr uint16_t PERIOD_MAX   = 0xFFFF;
+
+    struct Entry {
+        uint32_t key;             // ID | KEY_EXTENDED
+        uint32_t count;           // Принято кадров
+        uint32_t last_us;         // Метка времени последнего кадра (младшие 32 бита)
+        uint16_t last_period;     // Последний период в тиках
+        uint16_t min_period;
+        uint16_t max_period;
+        uint16_t jitter_x16;      // Сглаженное |изменение периода| * 16 в тиках, как в RFC 3550
+        uint32_t changes : 28;    // Сколько раз менялись данные или DLC
+        uint32_t dlc     : 4;     // DLC последнего кадра
+        uint8_t  data[8];         // Данные последнего кадра
+
+        bool isExtended() const { return (key & KEY_EXTENDED) != 0; }
+        uint32_t id() const { return key & ~KEY_EXTENDED; }
+        bool hasPeriod() const { return count > 1; }
+        uint32_t lastPeriodUs() const { return (uint32_t)last_period << PERIOD_SHIFT; }
+        uint32_t minPeriodUs() const { return hasPeriod() ? (uint32_t)min_period << PERIOD_SHIFT : 0; }
+        uint32_t maxPeriodUs() const { return (uint32_t)max_period << PERIOD_SHIFT; }
+        uint32_t jitterUs() const { return ((uint32_t)jitter_x16 << PERIOD_SHIFT) >> 4; }
+    };
+
+    static_assert(sizeof(Entry) == 32, "IdStatsTable::Entry layout");
+
+    IdStatsTable();
+
+    void reset();
+
+    // Учет одного кадра. Кадры новых ID сверх MAX_IDS только считаются.
+    void update(bool is_extended, uint32_t id, uint8_t dlc, const uint8_t* data,
+                bool is_remote, uint32_t timestamp_us);
+
+    const Entry* find(bool is_extended, uint32_t id) const;
+
+    // Упорядочивает записи по убыванию числа кадров, возвращает их количество.
+    // Порядок фиксируется до следующего вызова, значения в записях живые.
+    uint16_t rankByCount();
+    const Entry& ranked(uint16_t position) const { return entries_[order_[position]]; }
+
+    // Байты, менявшиеся с прошлого takeChangedBytes() (бит i - байт i).
+    // Новый ID или смена DLC дают 0xFF. Основа режима "read changes".
+    uint8_t takeChangedBytes(uint16_t index) {
+        uint8_t mask = changed_bytes_[index];
+        changed_bytes_[index] = 0;
+        return mask;
+    }
+    bool hasChanges(uint16_t index) const { return changed_bytes_[index] != 0; }
+    void markAllChanged();
+    const Entry& entryAt(uint16_t index) const { return entries_[index]; }
+
+    uint16_t getIdCount() const { return used_; }
+    uint32_t getUntrackedFrames() const { return untracked_frames_; }
+
+private:
+    static constexpr uint16_t EMPTY_SLOT = 0;  // В индексе хранится номер записи + 1
+
+    Entry entries_[MAX_IDS];
+    // В CCM RAM, см. IdStatsTable.cpp. Экземпляр таблицы один
+    static uint16_t index_[INDEX_SIZE];
+    static uint16_t order_[MAX_IDS];
+    static uint8_t changed_bytes_[MAX_IDS];
+    uint16_t used_;
+    uint32_t untracked_frames_;
+
+    static inline uint32_t makeKey(bool is_extended, uint32_t id) {
+        return is_extended ? (id | KEY_EXTENDED) : id;
+    }
+
+    // Мультипликативное (фибоначчиево) хеширование: старшие биты произведения
+    static inline uint32_t slotFor(uint32_t key) {
+        return (key * 0x9E3779B1U) >> (32 - INDEX_BITS);
+    }
+
+    Entry* findOrInsert(uint32_t key);
+};
+
+#endif /* IDSTATSTABLE_IDSTATSTABLE_H_ */
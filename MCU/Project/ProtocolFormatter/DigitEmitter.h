@@ -0,0 +1,93 @@
+/*
+ * DigitEmitter.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef PROTOCOLFORMATTER_DIGITEMITTER_H_
+#define PROTOCOLFORMATTER_DIGITEMITTER_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Табличный вывод цифр без printf и без кучи.
+// Все функции пишут в dst и возвращают число записанных символов.
+class DigitEmitter {
+public:
+    static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+    static constexpr char DEC_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    // Два hex-символа на байт
+    static inline uint8_t hexByte(uint8_t* dst, uint8_t value) {
+        dst[0] = HEX_DIGITS[value >> 4];
+        dst[1] = HEX_DIGITS[value & 0x0F];
+        return 2;
+    }
+
+    // Hex фиксированной ширины (старшие разряды - нули)
+    static inline uint8_t hex(uint8_t* dst, uint32_t value, uint8_t digits) {
+        for (int8_t i = digits - 1; i >= 0; i--) {
+            dst[i] = HEX_DIGITS[value & 0x0F];
+            value >>= 4;
+        }
+        return digits;
+    }
+
+    // Десятичное фиксированной ширины с ведущими нулями (лишние старшие разряды отсекаются)
+    static inline uint8_t decimalPadded(uint8_t* dst, uint32_t value, uint8_t width) {
+        int8_t pos = width;
+
+        while (pos >= 2) {
+            uint32_t pair = (value % 100) * 2;
+            value /= 100;
+            pos -= 2;
+            dst[pos]     = DEC_PAIRS[pair];
+            dst[pos + 1] = DEC_PAIRS[pair + 1];
+        }
+        if (pos == 1) {
+            dst[0] = '0' + (value % 10);
+        }
+        return width;
+    }
+
+    // Десятичное без ведущих нулей, но не короче min_width (аналог %0*lu)
+    static inline uint8_t decimal(uint8_t* dst, uint32_t value, uint8_t min_width = 1) {
+        uint8_t digits = 1;
+        for (uint32_t v = value; v >= 10; v /= 10) {
+            digits++;
+        }
+        return decimalPadded(dst, value, (digits > min_width) ? digits : min_width);
+    }
+
+    // Hex без ведущих нулей, но не короче min_width (аналог %0*lX)
+    static inline uint8_t hexMinWidth(uint8_t* dst, uint32_t value, uint8_t min_width) {
+        uint8_t digits = 1;
+        for (uint32_t v = value; v >= 16; v >>= 4) {
+            digits++;
+        }
+        return hex(dst, value, (digits > min_width) ? digits : min_width);
+    }
+
+    // Копирует строку-литерал без завершающего нуля
+    template <size_t N>
+    static inline uint8_t literal(uint8_t* dst, const char (&str)[N]) {
+        for (size_t i = 0; i < N - 1; i++) {
+            dst[i] = str[i];
+        }
+        return N - 1;
+    }
+};
+
+#endif /* PROTOCOLFORMATTER_DIGITEMITTER_H_ */
@@ -6,10 +6,16 @@
  */
 
 #include "ProtocolFormatter.h"
+#include "DigitEmitter.h"
 #include "COBSLib/cobs.h"
-#include <cstdio>
+#include "Timing/Timebase.h"
 
-ProtocolFormatter::ProtocolFormatter(Format fmt) : format_(fmt) {}
+ProtocolFormatter::ProtocolFormatter(Format fmt)
+    : format_(fmt),
+      batch_count_(0),
+      batch_seq_(0),
+      last_timestamp_(0),
+      has_last_timestamp_(false) {}
 
 uint16_t ProtocolFormatter::format(const CanMessage_t& msg,
                                   uint8_t* buffer,
@@ -25,6 +31,8 @@ uint16_t ProtocolFormatter::format(const CanMessage_t& msg,
             return cobsFormat(msg, buffer, buffer_size);
         case Format::Ascii:
             return asciiFormat(msg, buffer, buffer_size);
+        case Format::Binary:
+            return binaryFormat(msg, buffer, buffer_size);
         default:
             return 0;
     }
@@ -50,43 +58,14 @@ void ProtocolFormatter::formatTypeIdentifier(const CanMessage_t& msg,
     pos++;
 }
 
-static void setFormatedDatagramIdentifer(uint32_t idNum, uint8_t* pExitBuffer,
-                                        uint16_t* pCursor, int len) {
-    char* id = (char*)malloc(sizeof(char) * (len + 1));
-    int numOfDigits = 0;
-    int valueToConsume = idNum;
-
-    while (valueToConsume != 0) {
-        valueToConsume /= 10;     // n = n/10
-        ++numOfDigits;
-    }
-
-    // Если idNum = 0, то numOfDigits будет 0, исправляем
-    if (numOfDigits == 0) {
-        numOfDigits = 1;
-    }
-
-    sprintf(id + (len - numOfDigits), "%d", (int)idNum);
-    for (int eraser = 0; eraser < (len - numOfDigits); eraser++) {
-        id[eraser] = '0';
-    }
-
-    id[len] = '\0';  // Завершаем строку
-    memcpy((char*)pExitBuffer + *pCursor, id, len);
-    free(id);
-    *pCursor = *pCursor + len;
-}
-
 void ProtocolFormatter::formatIdentifier(const CanMessage_t& msg,
                                         uint8_t* buffer,
                                         uint16_t& pos) {
-    // Аналог setDatagramIdentifer + setFormatedDatagramIdentifer
-    char id_str[10] = {0};
-
+    // Десятичный ID с ведущими нулями: 4 знака для STD, 9 для EXT
     if (msg.header.IDE == CAN_ID_EXT) {
-    	setFormatedDatagramIdentifer(msg.header.ExtId, buffer, &pos, 9);
+        pos += DigitEmitter::decimalPadded(&buffer[pos], msg.header.ExtId, 9);
     } else if (msg.header.IDE == CAN_ID_STD) {
-    	setFormatedDatagramIdentifer(msg.header.StdId, buffer, &pos, 4);
+        pos += DigitEmitter::decimalPadded(&buffer[pos], msg.header.StdId, 4);
     }
 }
 
@@ -111,11 +90,13 @@ void ProtocolFormatter::formatData(const CanMessage_t& msg,
 void ProtocolFormatter::formatTimestamp(const CanMessage_t& msg,
                                        uint8_t* buffer,
                                        uint16_t& pos) {
-    // Вспомогательный метод для ASCII формата
-    char time_str[12];
-    snprintf(time_str, sizeof(time_str), "%010lu", msg.timestamp_ms);
-    memcpy(&buffer[pos], time_str, 10);
-    pos += 10;
+    // Вспомогательный метод для ASCII формата: секунды.микросекунды
+    uint32_t seconds, micros;
+    Timebase::split(msg.timestamp_us, seconds, micros);
+
+    pos += DigitEmitter::decimal(&buffer[pos], seconds, 6);
+    buffer[pos++] = '.';
+    pos += DigitEmitter::decimalPadded(&buffer[pos], micros, 6);
 }
 
 // Статические методы для прямого использования (без создания объекта)
@@ -125,6 +106,10 @@ uint16_t ProtocolFormatter::rawFormat(const CanMessage_t& msg,
                                      uint16_t buffer_size) {
     uint16_t pos = 0;
 
+    if (buffer_size < RAW_MAX_SIZE) {
+        return 0;
+    }
+
     // 1. Тип сообщения (1 байт)
     formatTypeIdentifier(msg, buffer, pos);
 
@@ -172,56 +157,182 @@ uint16_t ProtocolFormatter::asciiFormat(const CanMessage_t& msg,
                                        uint8_t* buffer,
                                        uint16_t buffer_size) {
     // Формат: [TIME] TYPE ID DLC DATA
-    // Пример: [0012345678] T001234567 8 01 02 03 04
+    // Пример: [000012.345678] EXT_DATA 0x01234567 DLC:4 DATA:01 02 03 04
+
+    if (buffer_size < ASCII_MAX_SIZE) {
+        return 0;
+    }
 
-    char* buf = reinterpret_cast<char*>(buffer);
-    int pos = 0;
+    uint16_t pos = 0;
+    bool is_std = (msg.header.IDE == CAN_ID_STD);
+    bool is_data = (msg.header.RTR == CAN_RTR_DATA);
 
     // 1. Временная метка
-    pos += snprintf(buf + pos, buffer_size - pos, "[%010lu] ",
-                    msg.timestamp_ms);
+    buffer[pos++] = '[';
+    formatTimestamp(msg, buffer, pos);
+    pos += DigitEmitter::literal(&buffer[pos], "] ");
 
     // 2. Тип сообщения
-    if (msg.header.IDE == CAN_ID_STD) {
-        if (msg.header.RTR == CAN_RTR_DATA) {
-            pos += snprintf(buf + pos, buffer_size - pos, "STD_DATA ");
-        } else {
-            pos += snprintf(buf + pos, buffer_size - pos, "STD_REMOTE ");
-        }
+    if (is_std) {
+        pos += is_data ? DigitEmitter::literal(&buffer[pos], "STD_DATA ")
+                       : DigitEmitter::literal(&buffer[pos], "STD_REMOTE ");
     } else {
-        if (msg.header.RTR == CAN_RTR_DATA) {
-            pos += snprintf(buf + pos, buffer_size - pos, "EXT_DATA ");
-        } else {
-            pos += snprintf(buf + pos, buffer_size - pos, "EXT_REMOTE ");
-        }
+        pos += is_data ? DigitEmitter::literal(&buffer[pos], "EXT_DATA ")
+                       : DigitEmitter::literal(&buffer[pos], "EXT_REMOTE ");
     }
 
     // 3. Идентификатор
-    if (msg.header.IDE == CAN_ID_STD) {
-        pos += snprintf(buf + pos, buffer_size - pos, "0x%03X ",
-                       msg.header.StdId);
+    pos += DigitEmitter::literal(&buffer[pos], "0x");
+    if (is_std) {
+        pos += DigitEmitter::hex(&buffer[pos], msg.header.StdId, 3);
     } else {
-        pos += snprintf(buf + pos, buffer_size - pos, "0x%08lX ",
-                       msg.header.ExtId);
+        pos += DigitEmitter::hex(&buffer[pos], msg.header.ExtId, 8);
     }
+    buffer[pos++] = ' ';
 
     // 4. DLC
-    pos += snprintf(buf + pos, buffer_size - pos, "DLC:%d ",
-                   msg.header.DLC);
+    pos += DigitEmitter::literal(&buffer[pos], "DLC:");
+    pos += DigitEmitter::decimal(&buffer[pos], msg.header.DLC);
+    buffer[pos++] = ' ';
 
     // 5. Данные (если есть)
-    if (msg.header.RTR == CAN_RTR_DATA && msg.header.DLC > 0) {
-        pos += snprintf(buf + pos, buffer_size - pos, "DATA:");
-        for (int i = 0; i < msg.header.DLC; i++) {
-            pos += snprintf(buf + pos, buffer_size - pos, "%02X", msg.data[i]);
-            if (i < msg.header.DLC - 1) {
-                pos += snprintf(buf + pos, buffer_size - pos, " ");
+    if (is_data && msg.header.DLC > 0) {
+        uint8_t dlc = (msg.header.DLC > 8) ? 8 : msg.header.DLC;
+
+        pos += DigitEmitter::literal(&buffer[pos], "DATA:");
+        for (uint8_t i = 0; i < dlc; i++) {
+            pos += DigitEmitter::hexByte(&buffer[pos], msg.data[i]);
+            if (i < dlc - 1) {
+                buffer[pos++] = ' ';
             }
         }
     }
 
     // Завершаем строку
-    pos += snprintf(buf + pos, buffer_size - pos, "\r\n");
+    buffer[pos++] = '\r';
+    buffer[pos++] = '\n';
 
     return pos;
 }
+
+static inline void putLe32(uint8_t* dst, uint32_t value) {
+    dst[0] = (uint8_t)(value);
+    dst[1] = (uint8_t)(value >> 8);
+    dst[2] = (uint8_t)(value >> 16);
+    dst[3] = (uint8_t)(value >> 24);
+}
+
+uint16_t ProtocolFormatter::binaryFormat(const CanMessage_t& msg,
+                                        uint8_t* buffer,
+                                        uint16_t buffer_size) {
+    uint16_t out_len = 0;
+
+    // Пакет остался полным с прошлого раза - сначала освобождаем его
+    if (batch_count_ >= BINARY_BATCH_MAX_RECORDS) {
+        out_len = flushBatch(buffer, buffer_size);
+        if (out_len == 0) {
+            return 0;
+        }
+    }
+
+    appendRecord(msg);
+
+    if (batch_count_ < BINARY_BATCH_MAX_RECORDS) {
+        return out_len;
+    }
+
+    return out_len + flushBatch(buffer + out_len, buffer_size - out_len);
+}
+
+uint16_t ProtocolFormatter::hold(const CanMessage_t& msg) {
+    switch (format_) {
+        case Format::Raw:
+            return RAW_MAX_SIZE;
+        case Format::Cobs:
+            return COBS_ENCODE_DST_BUF_LEN_MAX(RAW_MAX_SIZE + 1) + 2;
+        case Format::Ascii:
+            return ASCII_MAX_SIZE;
+        default:
+            break;
+    }
+
+    // Этот кадр заполнит пакет (или полный пакет еще ждет места) - нужен вывод
+    if (batch_count_ + 1 >= BINARY_BATCH_MAX_RECORDS) {
+        return COBS_ENCODE_DST_BUF_LEN_MAX(BINARY_BATCH_MAX_SIZE) + 1;
+    }
+
+    appendRecord(msg);
+    return 0;
+}
+
+void ProtocolFormatter::appendRecord(const CanMessage_t& msg) {
+    // Дельта от предыдущего кадра, первый кадр потока - 0
+    uint64_t elapsed = has_last_timestamp_ ? (msg.timestamp_us - last_timestamp_) : 0;
+    uint32_t delta = (elapsed > BINARY_DELTA_MAX) ? BINARY_DELTA_MAX : (uint32_t)elapsed;
+    last_timestamp_ = msg.timestamp_us;
+    has_last_timestamp_ = true;
+
+    uint32_t id_flags;
+    if (msg.header.IDE == CAN_ID_EXT) {
+        id_flags = (msg.header.ExtId & 0x1FFFFFFF) | BINARY_FLAG_IDE;
+    } else {
+        id_flags = msg.header.StdId & 0x7FF;
+    }
+    if (msg.header.RTR == CAN_RTR_REMOTE) {
+        id_flags |= BINARY_FLAG_RTR;
+    }
+
+    uint8_t dlc = msg.header.DLC & 0x0F;
+    uint8_t* record = &batch_[BINARY_BATCH_HEADER_SIZE + batch_count_ * BINARY_RECORD_SIZE];
+
+    putLe32(&record[0], delta | ((uint32_t)dlc << 28));
+    putLe32(&record[4], id_flags);
+
+    memset(&record[8], 0, 8);
+    if (msg.header.RTR == CAN_RTR_DATA && dlc > 0) {
+        memcpy(&record[8], msg.data, (dlc > 8) ? 8 : dlc);
+    }
+
+    batch_count_++;
+}
+
+void ProtocolFormatter::resetBatch() {
+    batch_count_ = 0;
+    batch_seq_ = 0;
+    last_timestamp_ = 0;
+    has_last_timestamp_ = false;
+}
+
+uint16_t ProtocolFormatter::pendingBatchSize() const {
+    if (batch_count_ == 0) {
+        return 0;
+    }
+
+    return COBS_ENCODE_DST_BUF_LEN_MAX(BINARY_BATCH_HEADER_SIZE + batch_count_ * BINARY_RECORD_SIZE) + 1;
+}
+
+uint16_t ProtocolFormatter::flushBatch(uint8_t* buffer, uint16_t buffer_size) {
+    if (batch_count_ == 0 || buffer == nullptr) {
+        return 0;
+    }
+
+    uint16_t raw_len = BINARY_BATCH_HEADER_SIZE + batch_count_ * BINARY_RECORD_SIZE;
+    batch_[0] = batch_seq_;
+    batch_[1] = batch_count_;
+
+    if (buffer_size < COBS_ENCODE_DST_BUF_LEN_MAX(raw_len) + 1) {
+        return 0;  // Пакет остается ждать следующего прохода
+    }
+
+    cobs_encode_result result = cobs_encode(buffer, buffer_size - 1, batch_, raw_len);
+    if (result.status != COBS_ENCODE_OK) {
+        return 0;
+    }
+
+    buffer[result.out_len] = 0x00;  // Разделитель кадров
+
+    batch_count_ = 0;
+    batch_seq_++;
+
+    return result.out_len + 1;
+}
@@ -17,23 +17,66 @@ public:
     enum class Format {
         Raw,     // Сырые данные
         Cobs,    // COBS кодирование
-        Ascii    // Человекочитаемый ASCII
+        Ascii,   // Человекочитаемый ASCII
+        Binary   // Пакеты бинарных записей в одном COBS-кадре
     };
 
+    // Бинарная запись (16 байт, little-endian):
+    //   [0..3]  биты 0..27 - дельта времени от предыдущего кадра в мкс
+    //           (насыщается на ~268 с),
+    //           биты 28..31 - DLC
+    //   [4..7]  биты 0..28 - ID, бит 29 - RTR, бит 30 - IDE
+    //   [8..15] данные, дополненные нулями
+    // Пакет: [seq][count][записи...] -> COBS -> 0x00
+    static constexpr uint16_t BINARY_RECORD_SIZE       = 16;
+    static constexpr uint16_t BINARY_BATCH_HEADER_SIZE = 2;
+    static constexpr uint8_t  BINARY_BATCH_MAX_RECORDS = 15;  // Пакет <= 254 байт: один блок COBS
+    static constexpr uint16_t BINARY_BATCH_MAX_SIZE    =
+            BINARY_BATCH_HEADER_SIZE + BINARY_RECORD_SIZE * BINARY_BATCH_MAX_RECORDS;
+    static constexpr uint16_t BINARY_BATCH_MAX_ENCODED = BINARY_BATCH_MAX_SIZE + 2;
+
+    // Худший случай длины для текстовых форматов
+    static constexpr uint16_t RAW_MAX_SIZE   = 1 + 9 + 1 + 8;
+    static constexpr uint16_t ASCII_MAX_SIZE = 20 + 11 + 11 + 6 + 5 + 8 * 3 + 2;
+
+    static constexpr uint32_t BINARY_DELTA_MAX = 0x0FFFFFFF;
+    static constexpr uint32_t BINARY_FLAG_RTR  = 1UL << 29;
+    static constexpr uint32_t BINARY_FLAG_IDE  = 1UL << 30;
+
     ProtocolFormatter(Format fmt = Format::Cobs);
 
     uint16_t format(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size);
 
-    void setFormat(Format fmt) { format_ = fmt; }
+    void setFormat(Format fmt) { format_ = fmt; resetBatch(); }
     Format getFormat() const { return format_; }
 
     uint16_t rawFormat(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size);
     uint16_t cobsFormat(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size);
     uint16_t asciiFormat(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size);
 
+    // Добавляет запись в пакет; пакет кодируется в buffer, когда заполнен
+    uint16_t binaryFormat(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size);
+    // Кодирует незаполненный пакет (конец прохода выборки)
+    uint16_t flushBatch(uint8_t* buffer, uint16_t buffer_size);
+    // Место под незаполненный пакет вместе с разделителем (0 - пакета нет)
+    uint16_t pendingBatchSize() const;
+    // Кадр без буфера вывода. Binary: запись ложится в пакет, если он после
+    // нее не заполнится - возврат 0. Иначе кадр не тронут, возврат - сколько
+    // места нужно под format() с буфером (текстовые форматы - худший случай)
+    uint16_t hold(const CanMessage_t& msg);
+    // Начинает бинарный поток заново (seq и дельты с нуля)
+    void resetBatch();
+
 private:
     Format format_;
 
+    uint8_t  batch_[BINARY_BATCH_MAX_SIZE];
+    uint8_t  batch_count_;
+    uint8_t  batch_seq_;
+    uint64_t last_timestamp_;
+    bool     has_last_timestamp_;
+
+    void appendRecord(const CanMessage_t& msg);
     void formatTypeIdentifier(const CanMessage_t& msg, uint8_t* buffer, uint16_t& pos);
     void formatIdentifier(const CanMessage_t& msg, uint8_t* buffer, uint16_t& pos);
     void formatDLC(const CanMessage_t& msg, uint8_t* buffer, uint16_t& pos);
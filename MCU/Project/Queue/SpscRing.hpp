@@ -0,0 +1,130 @@
+/*
+ * SpscRing.hpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef QUEUE_SPSCRING_HPP_
+#define QUEUE_SPSCRING_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Кольцевой буфер один писатель / один читатель (ISR -> superloop).
+// Писатель меняет только head_, читатель только tail_, поэтому блокировки
+// не нужны: публикация слота - release-запись индекса, чтение - acquire.
+// Индексы свободно бегут по uint32_t, в слот отображаются маской.
+template <typename T, uint32_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    static constexpr uint32_t CAPACITY = Capacity;
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    SpscRing() : head_(0), tail_(0), overflow_count_(0) {}
+
+    // ===== Сторона писателя =====
+
+    // Слот для заполнения на месте, nullptr если буфер полон
+    T* acquire() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+
+        if (head - tail >= Capacity) {
+            overflow_count_++;
+            return nullptr;
+        }
+        return &slots_[head & MASK];
+    }
+
+    // Публикует слот, полученный через acquire()
+    void commit() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    bool push(const T& item) {
+        T* slot = acquire();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = item;
+        commit();
+        return true;
+    }
+
+    // Пакетная запись: возвращает, сколько элементов поместилось.
+    // Не поместившиеся отбрасываются и считаются в overflow поштучно
+    uint32_t write(const T* items, uint32_t count) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t free = Capacity - (head - tail);
+
+        if (count > free) {
+            overflow_count_ += count - free;
+            count = free;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            slots_[(head + i) & MASK] = items[i];
+        }
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // ===== Сторона читателя =====
+
+    // Самый старый элемент без извлечения, nullptr если пусто
+    T* peek() {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+
+        if (head == tail) {
+            return nullptr;
+        }
+        return &slots_[tail & MASK];
+    }
+
+    // Освобождает слот, полученный через peek()
+    void release() {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    bool pop(T& item) {
+        T* slot = peek();
+        if (slot == nullptr) {
+            return false;
+        }
+        item = *slot;
+        release();
+        return true;
+    }
+
+    // ===== Состояние =====
+
+    uint32_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const { return size() == 0; }
+    bool isFull() const { return size() >= Capacity; }
+    uint32_t freeSpace() const { return Capacity - size(); }
+    uint32_t getOverflowCount() const { return overflow_count_; }
+
+    // Только со стороны читателя: отбрасывает все накопленные элементы
+    void flush() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    T slots_[Capacity];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    volatile uint32_t overflow_count_;
+};
+
+#endif /* QUEUE_SPSCRING_HPP_ */
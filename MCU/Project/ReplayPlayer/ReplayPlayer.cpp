@@ -0,0 +1,238 @@
+/*
+ * ReplayPlayer.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "ReplayPlayer.h"
+#include "Timing/Timebase.h"
+#include <cstring>
+
+ReplayPlayer::ReplayPlayer(CanSendCallback send_cb)
+    : send_callback_(send_cb),
+      state_(State::IDLE),
+      prebuffer_(0),
+      last_due_us_(0),
+      waiting_(false),
+      received_(0),
+      sent_(0),
+      dropped_(0),
+      tx_retries_(0),
+      underruns_(0),
+      underrun_us_(0),
+      late_min_us_(INT32_MAX),
+      late_max_us_(INT32_MIN),
+      late_sum_us_(0) {
+}
+
+void ReplayPlayer::begin(uint32_t prebuffer) {
+    stop();
+
+    if (prebuffer == 0) {
+        prebuffer = CAPACITY / 2;
+    }
+    if (prebuffer > MAX_PREBUFFER) {
+        prebuffer = MAX_PREBUFFER;
+    }
+
+    prebuffer_ = prebuffer;
+    received_ = 0;
+    sent_ = 0;
+    dropped_ = 0;
+    tx_retries_ = 0;
+    underruns_ = 0;
+    underrun_us_ = 0;
+    late_min_us_ = INT32_MAX;
+    late_max_us_ = INT32_MIN;
+    late_sum_us_ = 0;
+    state_ = State::BUFFERING;
+}
+
+void ReplayPlayer::end() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (state_ == State::BUFFERING) {
+        // Поток короче prebuffer - играем то, что есть
+        startPlayback();
+    }
+    if (state_ == State::PLAYING) {
+        state_ = State::DRAINING;
+        if (waiting_) {
+            state_ = State::IDLE;
+        }
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void ReplayPlayer::stop() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    Timebase::cancelAlarm(Timebase::Alarm::REPLAY);
+    ring_.flush();
+    waiting_ = false;
+    state_ = State::IDLE;
+
+    __set_PRIMASK(primask);
+}
+
+bool ReplayPlayer::push(uint32_t delta_us, uint32_t id, bool is_extended, bool is_remote,
+                        const uint8_t* data, uint8_t dlc) {
+    if (!isAccepting() || dlc > 8) {
+        return false;
+    }
+
+    Frame* frame = ring_.acquire();
+    if (frame == nullptr) {
+        return false;
+    }
+
+    frame->delta_us = (delta_us > MAX_DELTA_US) ? MAX_DELTA_US : delta_us;
+    frame->id = id;
+    frame->flags = (is_extended ? FLAG_EXT : 0) | (is_remote ? FLAG_RTR : 0);
+    frame->dlc = dlc;
+    memset(frame->data, 0, sizeof(frame->data));
+    if (!is_remote) {
+        memcpy(frame->data, data, dlc);
+    }
+    ring_.commit();
+    received_++;
+
+    if (state_ == State::BUFFERING && ring_.size() >= prebuffer_) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        startPlayback();
+        __set_PRIMASK(primask);
+    } else if (waiting_) {
+        kick();
+    }
+    return true;
+}
+
+void ReplayPlayer::onAlarm() {
+    if (state_ == State::PLAYING || state_ == State::DRAINING) {
+        service();
+    }
+}
+
+void ReplayPlayer::getStats(Stats& stats) const {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    stats.state = state_;
+    stats.buffered = ring_.size();
+    stats.prebuffer = prebuffer_;
+    stats.received = received_;
+    stats.sent = sent_;
+    stats.dropped = dropped_;
+    stats.tx_retries = tx_retries_;
+    stats.underruns = underruns_;
+    stats.underrun_us = underrun_us_;
+    stats.late_min_us = (sent_ > 0) ? late_min_us_ : 0;
+    stats.late_max_us = (sent_ > 0) ? late_max_us_ : 0;
+    stats.late_avg_us = (sent_ > 0) ? (int32_t)(late_sum_us_ / (int64_t)sent_) : 0;
+
+    __set_PRIMASK(primask);
+}
+
+// Под запретом прерываний: отсчет расписания - от текущего момента
+void ReplayPlayer::startPlayback() {
+    state_ = State::PLAYING;
+    last_due_us_ = Timebase::micros32();
+    waiting_ = false;
+    service();
+}
+
+// Новый кадр после опустевшего кольца: будильник снят, прерывание
+// не придет, поэтому обслуживаем сами
+void ReplayPlayer::kick() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // Кадр мог уйти из прерывания между commit() и проверкой waiting_
+    const Frame* frame = ring_.peek();
+    if (frame != nullptr && waiting_ &&
+        (state_ == State::PLAYING || state_ == State::DRAINING)) {
+        uint32_t now = Timebase::micros32();
+        uint32_t due = last_due_us_ + frame->delta_us;
+
+        // Кадр опоздал к своему дедлайну - это и есть underrun.
+        // Сдвигаем расписание, чтобы хвост не ушел пачкой
+        if (before(due, now)) {
+            underruns_++;
+            underrun_us_ += now - due;
+            last_due_us_ = now - frame->delta_us;
+        }
+
+        waiting_ = false;
+        service();
+    }
+
+    __set_PRIMASK(primask);
+}
+
+// Отправляет все наступившие кадры и взводит будильник на следующий.
+// Вызывается из прерывания или из основного цикла под запретом прерываний.
+void ReplayPlayer::service() {
+    for (;;) {
+        uint32_t now = Timebase::micros32();
+        uint32_t due = 0;
+        Frame* frame;
+
+        while ((frame = ring_.peek()) != nullptr) {
+            due = last_due_us_ + frame->delta_us;
+            if (before(now, due)) {
+                break;
+            }
+
+            SendResult result = send_callback_(frame->id, (frame->flags & FLAG_EXT) != 0,
+                                               (frame->flags & FLAG_RTR) != 0,
+                                               frame->data, frame->dlc);
+            if (result == SendResult::RETRY) {
+                // Дедлайн кадра не меняется: задержка войдет в его опоздание
+                tx_retries_++;
+                due = now + TX_RETRY_US;
+                break;
+            }
+
+            if (result == SendResult::SENT) {
+                recordLateness((int32_t)(now - due));
+                sent_++;
+            } else {
+                dropped_++;
+            }
+
+            last_due_us_ = due;
+            ring_.release();
+            now = Timebase::micros32();
+        }
+
+        if (frame == nullptr) {
+            Timebase::cancelAlarm(Timebase::Alarm::REPLAY);
+            if (state_ == State::DRAINING) {
+                state_ = State::IDLE;
+            } else {
+                waiting_ = true;
+            }
+            return;
+        }
+
+        // Дедлайн мог наступить, пока взводили сравнение - тогда еще круг
+        if (Timebase::setAlarm(due, Timebase::Alarm::REPLAY)) {
+            return;
+        }
+    }
+}
+
+void ReplayPlayer::recordLateness(int32_t late) {
+    if (late < late_min_us_) {
+        late_min_us_ = late;
+    }
+    if (late > late_max_us_) {
+        late_max_us_ = late;
+    }
+    late_sum_us_ += late;
+}
@@ -0,0 +1,137 @@
+/*
+ * ReplayPlayer.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef REPLAYPLAYER_REPLAYPLAYER_H_
+#define REPLAYPLAYER_REPLAYPLAYER_H_
+
+#include "Queue/SpscRing.hpp"
+#include <cstdint>
+#include <cstddef>
+
+// Емкость буфера воспроизведения в кадрах, переопределяется флагом
+// -DREPLAY_BUFFER_FRAMES=N (степень двойки)
+#ifndef REPLAY_BUFFER_FRAMES
+#define REPLAY_BUFFER_FRAMES 1024
+#endif
+
+// Воспроизведение записанного трафика потоком с хоста.
+// Кадры с относительными метками времени копятся в кольце (пишет
+// superloop, читает прерывание TIM2 CC2). Дедлайн кадра - дедлайн
+// предыдущего плюс его delta_us, поэтому задержки обработки не
+// накапливаются, а опоздание каждой отправки считается в статистике.
+// Пустое кольцо само по себе не ошибка: underrun - только когда
+// следующий кадр пришел позже своего дедлайна. Тогда расписание
+// сдвигается на потерянное время, а не отправляется пачкой.
+// Переполнения нет: пока места мало, двоичный канал не забирает
+// кадр из USB, и хост получает NAK на уровне endpoint.
+class ReplayPlayer {
+public:
+    enum class SendResult : uint8_t {
+        SENT,
+        RETRY,      // Очередь передачи полна - повторить позже
+        DROPPED,    // Кадр не может быть отправлен (CAN остановлен)
+    };
+
+    typedef SendResult (*CanSendCallback)(uint32_t id, bool is_extended, bool is_remote,
+                                          const uint8_t* data, uint8_t dlc);
+
+    enum class State : uint8_t {
+        IDLE,
+        BUFFERING,  // Ждем prebuffer кадров до старта
+        PLAYING,
+        DRAINING,   // Хост закончил поток, доигрываем остаток
+    };
+
+    static constexpr uint32_t CAPACITY = REPLAY_BUFFER_FRAMES;
+    static constexpr uint32_t TX_RETRY_US = 50;
+    // Дедлайны сравниваются по модулю 2^32, как у последовательностей
+    static constexpr uint32_t MAX_DELTA_US = 1000000000;
+    // Наибольший пакет STREAM_DATA: 509 байт тела по 9 байт на запись RTR - 56 кадров
+    static constexpr uint32_t MAX_BATCH_FRAMES = 64;
+    // Пока идет предзагрузка, пакет обязан поместиться: отложенный пакет
+    // не дал бы дойти до старта, и входное кольцо встало бы навсегда
+    static constexpr uint32_t MAX_PREBUFFER = CAPACITY - MAX_BATCH_FRAMES;
+
+    static_assert(CAPACITY >= 2 * MAX_BATCH_FRAMES, "REPLAY_BUFFER_FRAMES too small");
+
+    // Снимок состояния для "replay status"
+    struct Stats {
+        State state;
+        uint32_t buffered;
+        uint32_t prebuffer;
+        uint32_t received;
+        uint32_t sent;
+        uint32_t dropped;
+        uint32_t tx_retries;
+        uint32_t underruns;
+        uint32_t underrun_us;   // Суммарный сдвиг расписания из-за underrun
+        int32_t late_min_us;    // Опоздание отправки относительно дедлайна
+        int32_t late_max_us;
+        int32_t late_avg_us;
+    };
+
+    ReplayPlayer(CanSendCallback send_cb);
+
+    // Сбрасывает буфер и статистику. prebuffer 0 - половина буфера,
+    // больше MAX_PREBUFFER не бывает
+    void begin(uint32_t prebuffer);
+    // Конец потока: доиграть буфер и остановиться
+    void end();
+    // Немедленная остановка, буфер отбрасывается
+    void stop();
+
+    // Вызываются из superloop. push(): false - нет места или поток не начат
+    bool push(uint32_t delta_us, uint32_t id, bool is_extended, bool is_remote,
+              const uint8_t* data, uint8_t dlc);
+    uint32_t getFreeSpace() const { return ring_.freeSpace(); }
+    bool isAccepting() const { return state_ == State::BUFFERING || state_ == State::PLAYING; }
+
+    // Вызывается из прерывания сравнения TIM2 CC2
+    void onAlarm();
+
+    void getStats(Stats& stats) const;
+
+private:
+    struct Frame {
+        uint32_t delta_us;
+        uint32_t id;
+        uint8_t flags;
+        uint8_t dlc;
+        uint8_t data[8];
+    };
+
+    static constexpr uint8_t FLAG_EXT = 0x01;
+    static constexpr uint8_t FLAG_RTR = 0x02;
+
+    SpscRing<Frame, CAPACITY> ring_;
+    CanSendCallback send_callback_;
+
+    volatile State state_;
+    uint32_t prebuffer_;
+    uint32_t last_due_us_;      // Дедлайн последнего отправленного кадра
+    volatile bool waiting_;     // Кольцо опустело, будильник снят
+
+    uint32_t received_;
+    volatile uint32_t sent_;
+    volatile uint32_t dropped_;
+    volatile uint32_t tx_retries_;
+    volatile uint32_t underruns_;
+    volatile uint32_t underrun_us_;
+    int32_t late_min_us_;
+    int32_t late_max_us_;
+    int64_t late_sum_us_;
+
+    void startPlayback();
+    void kick();
+    void service();
+    void recordLateness(int32_t late);
+
+    // Сравнение по модулю 2^32: a раньше b
+    static inline bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+};
+
+#endif /* REPLAYPLAYER_REPLAYPLAYER_H_ */
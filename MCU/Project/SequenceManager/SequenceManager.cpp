@@ -6,137 +6,348 @@
  */
 
 #include "SequenceManager.h"
+#include "Timing/Timebase.h"
 #include <cstring>
 
 SequenceManager::SequenceManager(CanSendCallback send_cb)
-    : active_count_(0),
+    : heap_size_(0),
+      free_count_(MAX_SEQUENCES),
+      active_count_(0),
       send_callback_(send_cb) {
-    for (auto& seq : sequences_) {
-        seq.is_active = false;
+    // Первым выдается слот 0
+    for (uint16_t i = 0; i < MAX_SEQUENCES; i++) {
+        free_slots_[i] = MAX_SEQUENCES - 1 - i;
     }
+    memset(index_, EMPTY_SLOT, sizeof(index_));
 }
 
 bool SequenceManager::startSequence(uint32_t id,
                       const uint8_t* data,
                       uint8_t dlc,
                       uint32_t count,
-                      uint32_t interval_ms){
+                      uint32_t interval_us){
 	if (dlc == 0 || dlc > 8) return false;
 
-	if (interval_ms < MIN_INTERVAL_MS)
-		interval_ms = MIN_INTERVAL_MS;
+	if (interval_us < MIN_INTERVAL_US)
+		interval_us = MIN_INTERVAL_US;
+	if (interval_us > MAX_INTERVAL_US)
+		interval_us = MAX_INTERVAL_US;
 
-	if (active_count_ >= MAX_SEQUENCES){
-		return false; // Достигнут лимит последовательностей // TODO добавить точный статус
-	}
+	// Куча общая с прерыванием таймера
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
 
     // Проверяем, нет ли уже активной последовательности с таким ID
     Sequence* existing_seq = findSequenceById(id);
-    if (existing_seq && existing_seq->is_active) {
-        // Можно либо остановить старую, либо вернуть ошибку
-        stopSequence(id);
+    if (existing_seq) {
+        deactivate(*existing_seq);
     }
 
-    // Находим свободный слот
-    Sequence* seq = findFreeSlot();
-    if (!seq) {
-        return false;
+    if (free_count_ == 0) {
+    	__set_PRIMASK(primask);
+        return false; // Достигнут лимит последовательностей // TODO добавить точный статус
     }
 
+    uint16_t index = free_slots_[--free_count_];
+    Sequence* seq = &sequences_[index];
+
     // Инициализируем последовательность
     seq->id = id;
     seq->dlc = dlc;
     memcpy(seq->data, data, dlc);
     seq->total_count = count;
     seq->sent_count = 0;
-    seq->interval_ms = interval_ms;
-    seq->last_sent_time = 0;  // Будет установлено при первой отправке
+    seq->interval_us = interval_us;
+    seq->next_due_us = Timebase::micros32();  // Первая отправка - сразу
+    seq->missed = 0;
+    seq->failed = 0;
+    seq->late_min_us = INT32_MAX;
+    seq->late_max_us = INT32_MIN;
+    seq->late_sum_us = 0;
     seq->is_extended = (id > 0x7FF);
     seq->is_active = true;
     seq->infinite = (count == 0) ? true : false; // если cnt == 0 это бесконечная оптравка
 
     active_count_++;
+    indexInsert(index);
+    heapPush(index);
+    service();
 
+    __set_PRIMASK(primask);
     return true;
 }
 
 bool SequenceManager::stopSequence(uint32_t id) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
     Sequence* seq = findSequenceById(id);
-    if (!seq || !seq->is_active) {
-        return false;
+    if (seq) {
+        deactivate(*seq);
+        service();
     }
 
-    seq->is_active = false;
-    active_count_--;
-
-    return true;
+    __set_PRIMASK(primask);
+    return seq != nullptr;
 }
 
 void SequenceManager::stopAllSequences() {
-    for (auto& seq : sequences_) {
-        if (seq.is_active) {
-            seq.is_active = false;
-        }
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+    for (uint16_t i = 0; i < MAX_SEQUENCES; i++) {
+        sequences_[i].is_active = false;
+        free_slots_[i] = MAX_SEQUENCES - 1 - i;
     }
+    free_count_ = MAX_SEQUENCES;
+    memset(index_, EMPTY_SLOT, sizeof(index_));
+    heap_size_ = 0;
     active_count_ = 0;
+    Timebase::cancelAlarm();
+
+    __set_PRIMASK(primask);
 }
 
-void SequenceManager::update(uint32_t current_time_ms) {
-    if (!send_callback_) {
-        return;  // Нет callback для отправки
+bool SequenceManager::updateData(uint32_t id, const uint8_t* data, uint8_t dlc) {
+    if (dlc == 0 || dlc > 8) return false;
+
+    // Кадр не должен уйти из прерывания наполовину обновленным
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+    Sequence* seq = findSequenceById(id);
+    if (seq) {
+        seq->dlc = dlc;
+        memcpy(seq->data, data, dlc);
     }
 
-    for (auto& seq : sequences_) {
-        if (!seq.is_active) {
-            continue;  // Пропускаем неактивные
-        }
+    __set_PRIMASK(primask);
+    return seq != nullptr;
+}
 
-        // Проверяем, нужно ли отправить сообщение
-        if (seq.last_sent_time == 0) {
-            // Первая отправка - отправляем сразу
-            sendMessage(seq, current_time_ms);
-        } else {
-            // Проверяем интервал
-            uint32_t time_since_last = current_time_ms - seq.last_sent_time;
-
-            if (time_since_last >= seq.interval_ms) {
-                sendMessage(seq, current_time_ms);
-
-                // Проверяем завершение конечной последовательности
-                if (!seq.infinite && seq.sent_count >= seq.total_count) {
-                    seq.is_active = false;
-                    active_count_--;
-                }
-            }
-        }
+void SequenceManager::onAlarm() {
+    service();
+}
+
+bool SequenceManager::getTimingStats(uint16_t index, TimingStats& stats) const {
+    if (index >= MAX_SEQUENCES) {
+        return false;
     }
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+    const Sequence& seq = sequences_[index];
+    if (!seq.is_active) {
+        __set_PRIMASK(primask);
+        return false;
+    }
+
+    stats.id = seq.id;
+    stats.interval_us = seq.interval_us;
+    stats.sent_count = seq.sent_count;
+    stats.total_count = seq.infinite ? 0 : seq.total_count;
+    stats.missed = seq.missed;
+    stats.failed = seq.failed;
+    stats.dlc = seq.dlc;
+    memcpy(stats.data, seq.data, sizeof(stats.data));
+    if (seq.sent_count != 0) {
+        stats.late_min_us = seq.late_min_us;
+        stats.late_max_us = seq.late_max_us;
+        stats.late_avg_us = (int32_t)(seq.late_sum_us / seq.sent_count);
+    } else {
+        stats.late_min_us = stats.late_max_us = stats.late_avg_us = 0;
+    }
+
+    __set_PRIMASK(primask);
+    return true;
 }
 
 SequenceManager::Sequence* SequenceManager::findSequenceById(uint32_t id) {
-    for (auto& seq : sequences_) {
+    uint16_t slot = slotFor(id);
+
+    while (index_[slot] != EMPTY_SLOT) {
+        Sequence& seq = sequences_[index_[slot] - 1];
         if (seq.id == id) {
             return &seq;
         }
+        slot = (slot + 1) & INDEX_MASK;
     }
     return nullptr;
 }
 
-SequenceManager::Sequence* SequenceManager::findFreeSlot() {
-    for (auto& seq : sequences_) {
-        if (!seq.is_active) {
-            return &seq;
+void SequenceManager::indexInsert(uint16_t index) {
+    uint16_t slot = slotFor(sequences_[index].id);
+
+    while (index_[slot] != EMPTY_SLOT) {
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    index_[slot] = index + 1;
+}
+
+void SequenceManager::indexErase(uint32_t id) {
+    uint16_t hole = slotFor(id);
+
+    while (index_[hole] != EMPTY_SLOT && sequences_[index_[hole] - 1].id != id) {
+        hole = (hole + 1) & INDEX_MASK;
+    }
+    if (index_[hole] == EMPTY_SLOT) {
+        return;
+    }
+
+    // Сдвигаем назад записи цепочки, которые могут занять освободившийся слот
+    uint16_t next = (hole + 1) & INDEX_MASK;
+    while (index_[next] != EMPTY_SLOT) {
+        uint16_t home = slotFor(sequences_[index_[next] - 1].id);
+        if (((next - home) & INDEX_MASK) >= ((next - hole) & INDEX_MASK)) {
+            index_[hole] = index_[next];
+            hole = next;
         }
+        next = (next + 1) & INDEX_MASK;
     }
-    return nullptr;
+    index_[hole] = EMPTY_SLOT;
 }
 
-void SequenceManager::sendMessage(Sequence& seq, uint32_t current_time) {
-    if (!send_callback_) {
+void SequenceManager::deactivate(Sequence& seq) {
+    indexErase(seq.id);
+    heapRemove(seq.heap_pos);
+    seq.is_active = false;
+    free_slots_[free_count_++] = &seq - sequences_;
+    active_count_--;
+}
+
+// Отправляет наступившие дедлайны, не больше SERVICE_BUDGET за вызов, и
+// взводит будильник на следующий.
+// Вызывается из прерывания или из основного цикла под запретом прерываний.
+void SequenceManager::service() {
+    uint16_t budget = SERVICE_BUDGET;
+
+    for (;;) {
+        uint32_t now = Timebase::micros32();
+        uint32_t due = 0;
+
+        while (heap_size_ > 0) {
+            Sequence& seq = sequences_[heap_[0]];
+            due = seq.next_due_us;
+            if (before(now, due)) {
+                break;
+            }
+
+            if (budget == 0) {
+                // Перегрузка: остаток - со следующего прерывания
+                due = now + SERVICE_YIELD_US;
+                break;
+            }
+            budget--;
+
+            sendMessage(seq, now);
+
+            if (!seq.infinite && seq.sent_count + seq.failed >= seq.total_count) {
+                deactivate(seq);
+            } else {
+                seq.next_due_us += seq.interval_us;
+                if (!before(now, seq.next_due_us)) {
+                    // Опоздали больше чем на период: догонять пачкой нельзя,
+                    // переходим на ближайший будущий дедлайн той же сетки
+                    uint32_t skipped = (now - seq.next_due_us) / seq.interval_us + 1;
+                    seq.next_due_us += skipped * seq.interval_us;
+                    seq.missed += skipped;
+                }
+                siftDown(0);
+            }
+
+            now = Timebase::micros32();
+        }
+
+        if (heap_size_ == 0) {
+            Timebase::cancelAlarm();
+            return;
+        }
+
+        // Дедлайн мог наступить, пока взводили сравнение - тогда еще круг
+        if (Timebase::setAlarm(due)) {
+            return;
+        }
+    }
+}
+
+void SequenceManager::sendMessage(Sequence& seq, uint32_t now_us) {
+    // Неудачная попытка тоже занимает период из count, но в опоздание не входит
+    if (send_callback_ == nullptr
+        || !send_callback_(seq.id, seq.is_extended, false, seq.data, seq.dlc)) {
+        seq.failed++;
         return;
     }
 
-    send_callback_(seq.id, seq.is_extended, false, seq.data, seq.dlc);
+    int32_t late = (int32_t)(now_us - seq.next_due_us);
+    if (late < seq.late_min_us) {
+        seq.late_min_us = late;
+    }
+    if (late > seq.late_max_us) {
+        seq.late_max_us = late;
+    }
+    seq.late_sum_us += late;
 
     seq.sent_count++;
-    seq.last_sent_time = current_time;
+}
+
+void SequenceManager::heapSwap(uint16_t i, uint16_t j) {
+    uint16_t tmp = heap_[i];
+    heap_[i] = heap_[j];
+    heap_[j] = tmp;
+    sequences_[heap_[i]].heap_pos = i;
+    sequences_[heap_[j]].heap_pos = j;
+}
+
+void SequenceManager::heapPush(uint16_t index) {
+    uint16_t pos = heap_size_++;
+    heap_[pos] = index;
+    sequences_[index].heap_pos = pos;
+    siftUp(pos);
+}
+
+void SequenceManager::heapRemove(uint16_t pos) {
+    uint16_t last = --heap_size_;
+    if (pos == last) {
+        return;
+    }
+
+    // На место удаленного встает последний элемент - он может уйти в любую сторону
+    heapSwap(pos, last);
+    if (pos > 0 && heapLess(pos, (pos - 1) / 2)) {
+        siftUp(pos);
+    } else {
+        siftDown(pos);
+    }
+}
+
+void SequenceManager::siftUp(uint16_t pos) {
+    while (pos > 0) {
+        uint16_t parent = (pos - 1) / 2;
+        if (!heapLess(pos, parent)) {
+            break;
+        }
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void SequenceManager::siftDown(uint16_t pos) {
+    for (;;) {
+        uint16_t smallest = pos;
+        uint16_t left = 2 * pos + 1;
+        uint16_t right = left + 1;
+
+        if (left < heap_size_ && heapLess(left, smallest)) {
+            smallest = left;
+        }
+        if (right < heap_size_ && heapLess(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        heapSwap(pos, smallest);
+        pos = smallest;
+    }
 }
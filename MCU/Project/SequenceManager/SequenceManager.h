@@ -11,31 +11,88 @@
 #include <cstdint>
 #include <cstddef>
 
+// Емкость пула последовательностей, переопределяется флагом -DSEQUENCE_POOL_SIZE=N
+#ifndef SEQUENCE_POOL_SIZE
+#define SEQUENCE_POOL_SIZE 256
+#endif
+
+// Разрядность хеш-индекса: размер - степень двойки не меньше 2 * capacity
+constexpr uint8_t sequenceIndexBits(uint32_t capacity) {
+    uint8_t bits = 1;
+    while ((1U << bits) < 2 * capacity) {
+        bits++;
+    }
+    return bits;
+}
+
+// Периодическая отправка кадров по аппаратному таймеру.
+// Дедлайны абсолютные (next += period) в микросекундах шкалы
+// Timebase::micros32(), поэтому задержки обработки не накапливаются.
+// Активные последовательности лежат в min-куче по ближайшему дедлайну,
+// канал сравнения TIM2 CC1 будит onAlarm() точно к вершине кучи.
+// Если обработчик опоздал больше чем на период, пропущенные отправки
+// не догоняются пачкой, а считаются в missed - фаза сохраняется.
+// Записи берутся из пула фиксированного размера (стек свободных слотов),
+// поиск по ID - хеш-индекс, выбор следующего дедлайна - O(log n).
 class SequenceManager {
 public:
-    // Callback тип для embedded (без std::function)
-    typedef void (*CanSendCallback)(uint32_t id, bool is_extended,
+    // Callback тип для embedded (без std::function).
+    // false - кадр не принят в передачу (очередь полна, CAN остановлен):
+    // период не повторяется, отправка считается в failed
+    typedef bool (*CanSendCallback)(uint32_t id, bool is_extended,
             						bool is_remote, uint8_t* data,
 									uint8_t dlc);
 
-    static constexpr size_t MAX_SEQUENCES = 4;
-    static constexpr uint32_t MIN_INTERVAL_MS = 1;
+    static constexpr uint16_t MAX_SEQUENCES = SEQUENCE_POOL_SIZE;
+    static constexpr uint32_t MIN_INTERVAL_US = 100;
+    // Дедлайны сравниваются по модулю 2^32 - период меньше четверти оборота счетчика
+    static constexpr uint32_t MAX_INTERVAL_US = 1000000000;
+    // Работа одного вызова service(): пул с короткими периодами может
+    // требовать больше отправок, чем успевается, и прерывание не отпустило бы
+    // CAN RX и USB. Остаток - через SERVICE_YIELD_US, опоздания уйдут в missed
+    static constexpr uint16_t SERVICE_BUDGET = 32;
+    static constexpr uint32_t SERVICE_YIELD_US = 10;
+
+    static_assert(MAX_SEQUENCES >= 1 && MAX_SEQUENCES <= 4096, "SEQUENCE_POOL_SIZE out of range");
+
+    // Снимок точности отправки одной последовательности
+    struct TimingStats {
+        uint32_t id;
+        uint32_t interval_us;
+        uint32_t sent_count;
+        uint32_t total_count;   // 0 - бесконечная
+        uint32_t missed;        // Пропущенные периоды
+        uint32_t failed;        // Периоды, где кадр не приняли в передачу
+        int32_t late_min_us;    // Опоздание отправки относительно дедлайна
+        int32_t late_max_us;
+        int32_t late_avg_us;
+        uint8_t dlc;
+        uint8_t data[8];
+    };
 
     SequenceManager(CanSendCallback send_cb);
 
+    // Последовательность с уже занятым ID перезапускается
     bool startSequence(uint32_t id,
                       const uint8_t* data,
                       uint8_t dlc,
                       uint32_t count = 0,
-                      uint32_t interval_ms = 100);
+                      uint32_t interval_us = 100000);
 
     bool stopSequence(uint32_t id);
     void stopAllSequences();
 
-    void update(uint32_t current_time_ms);
+    // Новые данные уходят со следующей отправки, расписание не сбрасывается
+    bool updateData(uint32_t id, const uint8_t* data, uint8_t dlc);
+
+    // Вызывается из прерывания сравнения TIM2 CC1
+    void onAlarm();
 
     size_t getActiveCount() const { return active_count_; }
 
+    // Обход пула: false - слот index свободен
+    bool getTimingStats(uint16_t index, TimingStats& stats) const;
+
     void setSendCallback(CanSendCallback callback) {
         send_callback_ = callback;
     }
@@ -45,26 +102,60 @@ private:
         uint32_t id;
         uint8_t data[8];
         uint8_t dlc;
-        uint32_t total_count;
-        uint32_t sent_count;
-        uint32_t interval_ms;
-        uint32_t last_sent_time;
         bool is_extended;
         bool is_active;
         bool infinite;
-
-        Sequence() : id(0), dlc(0), total_count(0), sent_count(0),
-                    interval_ms(0), last_sent_time(0),
-                    is_extended(false), is_active(false), infinite(false) {}
+        uint16_t heap_pos;
+        uint32_t total_count;
+        uint32_t sent_count;
+        uint32_t interval_us;
+        uint32_t next_due_us;
+        uint32_t missed;
+        uint32_t failed;
+        int32_t late_min_us;
+        int32_t late_max_us;
+        int64_t late_sum_us;
+
+        Sequence() : id(0), dlc(0), is_extended(false), is_active(false), infinite(false),
+                    heap_pos(0), total_count(0), sent_count(0), interval_us(0), next_due_us(0), missed(0),
+                    failed(0), late_min_us(0), late_max_us(0), late_sum_us(0) {}
     };
 
+    static constexpr uint8_t  INDEX_BITS = sequenceIndexBits(MAX_SEQUENCES);
+    static constexpr uint16_t INDEX_SIZE = 1 << INDEX_BITS;  // Не меньше 2 * MAX_SEQUENCES
+    static constexpr uint16_t INDEX_MASK = INDEX_SIZE - 1;
+    static constexpr uint16_t EMPTY_SLOT = 0;                // В индексе хранится номер + 1
+
     Sequence sequences_[MAX_SEQUENCES];
-    size_t active_count_;
+    uint16_t heap_[MAX_SEQUENCES];         // Номера последовательностей, вершина - ближайший дедлайн
+    uint16_t heap_size_;
+    uint16_t free_slots_[MAX_SEQUENCES];   // Стек свободных номеров
+    uint16_t free_count_;
+    uint16_t index_[INDEX_SIZE];           // ID -> номер (открытая адресация, удаление сдвигом)
+    volatile size_t active_count_;
     CanSendCallback send_callback_;
 
+    static inline uint16_t slotFor(uint32_t id) {
+        return (id * 0x9E3779B1U) >> (32 - INDEX_BITS);
+    }
+
     Sequence* findSequenceById(uint32_t id);
-    Sequence* findFreeSlot();
-    void sendMessage(Sequence& seq, uint32_t current_time);
+    void indexInsert(uint16_t index);
+    void indexErase(uint32_t id);
+    void deactivate(Sequence& seq);
+    void service();
+    void sendMessage(Sequence& seq, uint32_t now_us);
+
+    // Сравнение по модулю 2^32: a раньше b
+    static inline bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+    bool heapLess(uint16_t i, uint16_t j) const {
+        return before(sequences_[heap_[i]].next_due_us, sequences_[heap_[j]].next_due_us);
+    }
+    void heapSwap(uint16_t i, uint16_t j);
+    void heapPush(uint16_t index);
+    void heapRemove(uint16_t pos);
+    void siftUp(uint16_t pos);
+    void siftDown(uint16_t pos);
 };
 
 
@@ -0,0 +1,215 @@
+/*
+ * SoftwareFilter.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "SoftwareFilter.h"
+#include <cstring>
+
+SoftwareFilter::SoftwareFilter()
+    : rule_count_(0),
+      ext_range_count_(0),
+      ext_mask_count_(0),
+      ext_set_count_(0) {
+    compile();
+}
+
+SoftwareFilter::Status SoftwareFilter::addRule(const Rule& rule) {
+    if (!isValid(rule)) {
+        return Status::InvalidRule;
+    }
+    if (rule_count_ >= MAX_RULES) {
+        return Status::RulesFull;
+    }
+
+    rules_[rule_count_++] = rule;
+
+    Status status = compile();
+    if (status != Status::OK) {
+        // Правило не помещается в скомпилированный вид - откатываемся
+        rule_count_--;
+        compile();
+    }
+    return status;
+}
+
+SoftwareFilter::Status SoftwareFilter::removeRule(uint16_t index) {
+    if (index >= rule_count_) {
+        return Status::NotFound;
+    }
+
+    for (uint16_t i = index; i + 1 < rule_count_; i++) {
+        rules_[i] = rules_[i + 1];
+    }
+    rule_count_--;
+
+    return compile();
+}
+
+void SoftwareFilter::clear() {
+    rule_count_ = 0;
+    compile();
+}
+
+bool SoftwareFilter::isValid(const Rule& rule) {
+    uint32_t id_max = rule.is_extended ? EXT_ID_MAX : STD_ID_MAX;
+
+    switch (rule.kind) {
+        case RuleKind::Id:
+            return rule.first <= id_max;
+        case RuleKind::Range:
+            return rule.first <= rule.second && rule.second <= id_max;
+        case RuleKind::Mask:
+            return rule.first <= id_max && rule.second <= id_max;
+        default:
+            return false;
+    }
+}
+
+SoftwareFilter::Status SoftwareFilter::compile() {
+    memset(std_bitmap_, 0, sizeof(std_bitmap_));
+    ext_range_count_ = 0;
+    ext_mask_count_ = 0;
+    ext_set_count_ = 0;
+    for (uint16_t i = 0; i < EXT_SET_SIZE; i++) {
+        ext_set_[i] = EMPTY_KEY;
+    }
+
+    for (uint16_t r = 0; r < rule_count_; r++) {
+        const Rule& rule = rules_[r];
+
+        if (!rule.is_extended) {
+            compileStd(rule);
+            continue;
+        }
+
+        uint32_t first = rule.first;
+        uint32_t mask = (rule.kind == RuleKind::Mask) ? rule.second : EXT_ID_MAX;
+
+        if (rule.kind == RuleKind::Range) {
+            ext_ranges_[ext_range_count_++] = { rule.first, rule.second };
+            continue;
+        }
+
+        // Маска без дыр в старших битах (xxx...x000) - это просто диапазон
+        uint32_t wildcard = ~mask & EXT_ID_MAX;
+        if (wildcard != 0 && (wildcard & (wildcard + 1)) == 0) {
+            ext_ranges_[ext_range_count_++] = { first & mask, (first & mask) | wildcard };
+            continue;
+        }
+
+        uint8_t group = 0;
+        while (group < ext_mask_count_ && ext_masks_[group] != mask) {
+            group++;
+        }
+        if (group == ext_mask_count_) {
+            if (ext_mask_count_ >= MAX_EXT_MASKS) {
+                return Status::ExtMasksFull;
+            }
+            ext_masks_[ext_mask_count_++] = mask;
+        }
+
+        Status status = insertExtKey((first & mask) | ((uint32_t)group << 29));
+        if (status != Status::OK) {
+            return status;
+        }
+    }
+
+    // Сортировка вставками (правил немного) и слияние пересечений
+    for (uint16_t i = 1; i < ext_range_count_; i++) {
+        Range range = ext_ranges_[i];
+        uint16_t j = i;
+        while (j > 0 && ext_ranges_[j - 1].first > range.first) {
+            ext_ranges_[j] = ext_ranges_[j - 1];
+            j--;
+        }
+        ext_ranges_[j] = range;
+    }
+
+    uint16_t merged = 0;
+    for (uint16_t i = 0; i < ext_range_count_; i++) {
+        if (merged > 0 && ext_ranges_[i].first <= ext_ranges_[merged - 1].last + 1) {
+            if (ext_ranges_[i].last > ext_ranges_[merged - 1].last) {
+                ext_ranges_[merged - 1].last = ext_ranges_[i].last;
+            }
+        } else {
+            ext_ranges_[merged++] = ext_ranges_[i];
+        }
+    }
+    ext_range_count_ = merged;
+
+    return Status::OK;
+}
+
+void SoftwareFilter::compileStd(const Rule& rule) {
+    uint32_t first = rule.first;
+    uint32_t last = rule.first;
+
+    if (rule.kind == RuleKind::Range) {
+        last = rule.second;
+    } else if (rule.kind == RuleKind::Mask) {
+        // 2048 проверок - только при изменении правил
+        for (uint32_t id = 0; id <= STD_ID_MAX; id++) {
+            if (((id ^ rule.first) & rule.second) == 0) {
+                std_bitmap_[id >> 5] |= (1U << (id & 31));
+            }
+        }
+        return;
+    }
+
+    for (uint32_t id = first; id <= last; id++) {
+        std_bitmap_[id >> 5] |= (1U << (id & 31));
+    }
+}
+
+SoftwareFilter::Status SoftwareFilter::insertExtKey(uint32_t key) {
+    uint32_t slot = slotFor(key);
+
+    while (ext_set_[slot] != EMPTY_KEY) {
+        if (ext_set_[slot] == key) {
+            return Status::OK;
+        }
+        slot = (slot + 1) & EXT_SET_MASK;
+    }
+
+    if (ext_set_count_ >= EXT_SET_SIZE / 2) {
+        return Status::ExtIdsFull;
+    }
+
+    ext_set_[slot] = key;
+    ext_set_count_++;
+    return Status::OK;
+}
+
+bool SoftwareFilter::acceptsExtended(uint32_t id) const {
+    // Последний диапазон с first <= id
+    uint16_t low = 0;
+    uint16_t high = ext_range_count_;
+    while (low < high) {
+        uint16_t middle = (low + high) / 2;
+        if (ext_ranges_[middle].first <= id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low > 0 && id <= ext_ranges_[low - 1].last) {
+        return true;
+    }
+
+    for (uint8_t group = 0; group < ext_mask_count_; group++) {
+        uint32_t key = (id & ext_masks_[group]) | ((uint32_t)group << 29);
+        uint32_t slot = slotFor(key);
+
+        while (ext_set_[slot] != EMPTY_KEY) {
+            if (ext_set_[slot] == key) {
+                return true;
+            }
+            slot = (slot + 1) & EXT_SET_MASK;
+        }
+    }
+
+    return false;
+}
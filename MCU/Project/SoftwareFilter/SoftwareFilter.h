@@ -0,0 +1,110 @@
+/*
+ * SoftwareFilter.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef SOFTWAREFILTER_SOFTWAREFILTER_H_
+#define SOFTWAREFILTER_SOFTWAREFILTER_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Вторая ступень фильтрации после аппаратных банков bxCAN.
+// Банки остаются грубым префильтром, а здесь задается любое количество
+// ID, диапазонов и масок (до MAX_RULES). Правила компилируются в:
+//   - STD: битовую карту на все 2048 ID - проверка одним обращением;
+//   - EXT: отсортированный список непересекающихся диапазонов (бинарный
+//     поиск) и хеш-множество кодов (id & mask) для каждой из различных
+//     масок (не больше MAX_EXT_MASKS, точный ID - это маска 0x1FFFFFFF).
+// Проверка кадра - O(1) для STD и O(log n + MAX_EXT_MASKS) для EXT.
+// Пустой набор правил пропускает все кадры.
+class SoftwareFilter {
+public:
+    enum class RuleKind : uint8_t {
+        Id,      // first
+        Range,   // first..second включительно
+        Mask     // (id & second) == (first & second)
+    };
+
+    struct Rule {
+        uint32_t first;
+        uint32_t second;
+        RuleKind kind;
+        bool is_extended;
+    };
+
+    enum class Status {
+        OK,
+        InvalidRule,
+        RulesFull,
+        ExtMasksFull,   // Слишком много различных EXT-масок
+        ExtIdsFull,     // Хеш-множество EXT заполнено
+        NotFound
+    };
+
+    static constexpr uint16_t MAX_RULES     = 128;
+    static constexpr uint8_t  MAX_EXT_MASKS = 4;
+    static constexpr uint16_t EXT_SET_BITS  = 8;
+    static constexpr uint16_t EXT_SET_SIZE  = 1 << EXT_SET_BITS;   // Заполнение не выше 50%
+    static constexpr uint16_t EXT_SET_MASK  = EXT_SET_SIZE - 1;
+
+    static constexpr uint32_t STD_ID_MAX = 0x7FF;
+    static constexpr uint32_t EXT_ID_MAX = 0x1FFFFFFF;
+
+    SoftwareFilter();
+
+    Status addRule(const Rule& rule);
+    Status removeRule(uint16_t index);
+    void clear();
+
+    // Вызывается на каждый кадр
+    inline bool accepts(bool is_extended, uint32_t id) const {
+        if (rule_count_ == 0) {
+            return true;
+        }
+        if (!is_extended) {
+            return (std_bitmap_[(id & STD_ID_MAX) >> 5] >> (id & 31)) & 1U;
+        }
+        return acceptsExtended(id);
+    }
+
+    bool isActive() const { return rule_count_ != 0; }
+    uint16_t getRuleCount() const { return rule_count_; }
+    const Rule& getRule(uint16_t index) const { return rules_[index]; }
+    uint8_t getExtMaskCount() const { return ext_mask_count_; }
+    uint16_t getExtRangeCount() const { return ext_range_count_; }
+
+private:
+    struct Range {
+        uint32_t first;
+        uint32_t last;
+    };
+
+    static constexpr uint32_t EMPTY_KEY = 0xFFFFFFFF;  // Номер маски < 4, бит 31 ключа всегда 0
+
+    Rule rules_[MAX_RULES];
+    uint16_t rule_count_;
+
+    // Скомпилированное представление
+    uint32_t std_bitmap_[(STD_ID_MAX + 1) / 32];
+    Range ext_ranges_[MAX_RULES];
+    uint16_t ext_range_count_;
+    uint32_t ext_masks_[MAX_EXT_MASKS];
+    uint8_t ext_mask_count_;
+    uint32_t ext_set_[EXT_SET_SIZE];     // (id & mask) | (номер маски << 29)
+    uint16_t ext_set_count_;
+
+    static bool isValid(const Rule& rule);
+    static inline uint32_t slotFor(uint32_t key) {
+        return (key * 0x9E3779B1U) >> (32 - EXT_SET_BITS);
+    }
+
+    Status compile();
+    void compileStd(const Rule& rule);
+    Status insertExtKey(uint32_t key);
+    bool acceptsExtended(uint32_t id) const;
+};
+
+#endif /* SOFTWAREFILTER_SOFTWAREFILTER_H_ */
@@ -0,0 +1,183 @@
+/*
+ * TextFrameFormatter.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "TextFrameFormatter.h"
+#include "ProtocolFormatter/DigitEmitter.h"
+#include "Timing/Timebase.h"
+#include <cstring>
+
+#define SEGMENT(str) { str, sizeof(str) - 1 }
+
+#define ANSI_RESET  "\033[0m"
+#define ANSI_GREEN  "\033[32m"
+#define ANSI_CYAN   "\033[36m"
+#define ANSI_YELLOW "\033[33m"
+#define ANSI_RED    "\033[31m"
+
+// Цвет начала и переходы "сброс + пробел + цвет" для каждого вида кадра
+const TextFrameFormatter::Segment TextFrameFormatter::COLOR_START[KIND_COUNT] = {
+    SEGMENT(ANSI_GREEN), SEGMENT(ANSI_CYAN), SEGMENT(ANSI_YELLOW)
+};
+const TextFrameFormatter::Segment TextFrameFormatter::COLOR_RESET_SPACE_START[KIND_COUNT] = {
+    SEGMENT(ANSI_RESET " " ANSI_GREEN),
+    SEGMENT(ANSI_RESET " " ANSI_CYAN),
+    SEGMENT(ANSI_RESET " " ANSI_YELLOW)
+};
+const TextFrameFormatter::Segment TextFrameFormatter::COLOR_RESET = SEGMENT(ANSI_RESET);
+const TextFrameFormatter::Segment TextFrameFormatter::COLOR_NONE  = { "", 0 };
+const TextFrameFormatter::Segment TextFrameFormatter::SPACE       = SEGMENT(" ");
+const TextFrameFormatter::Segment TextFrameFormatter::CHANGED_START = SEGMENT(" " ANSI_RED);
+const TextFrameFormatter::Segment TextFrameFormatter::CHANGED_END   = SEGMENT(ANSI_RESET);
+
+TextFrameFormatter::TextFrameFormatter(Layout layout, bool colors)
+    : layout_(layout),
+      colors_(colors) {}
+
+uint16_t TextFrameFormatter::format(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size) {
+    if (buffer == nullptr || buffer_size < MAX_LINE_SIZE) {
+        return 0;
+    }
+
+    if (layout_ == Layout::Parsed) {
+        return formatParsed(msg, buffer);
+    }
+    return formatRaw(msg, buffer);
+}
+
+TextFrameFormatter::Kind TextFrameFormatter::frameKind(const CanMessage_t& msg) {
+    if (msg.header.RTR == CAN_RTR_REMOTE) return KIND_RTR;
+    if (msg.header.IDE == CAN_ID_STD) return KIND_STD;
+    return KIND_EXT;
+}
+
+uint16_t TextFrameFormatter::put(uint8_t* dst, const Segment& segment) {
+    memcpy(dst, segment.text, segment.length);
+    return segment.length;
+}
+
+uint16_t TextFrameFormatter::formatTimestamp(uint64_t timestamp_us, uint8_t* dst, uint8_t seconds_width) {
+    // Секунды.микросекунды, как в candump
+    uint32_t seconds, micros;
+    Timebase::split(timestamp_us, seconds, micros);
+
+    uint16_t pos = DigitEmitter::decimal(dst, seconds, seconds_width);
+    dst[pos++] = '.';
+    pos += DigitEmitter::decimalPadded(&dst[pos], micros, 6);
+    return pos;
+}
+
+uint16_t TextFrameFormatter::formatRaw(const CanMessage_t& msg, uint8_t* buffer) {
+    // 000012.345678 T 123 [8] 01 02 03 04 05 06 07 08
+    Kind kind = frameKind(msg);
+    uint8_t dlc = (msg.header.DLC > 8) ? 8 : msg.header.DLC;
+    uint32_t id = (msg.header.IDE == CAN_ID_STD) ? msg.header.StdId : msg.header.ExtId;
+    uint16_t pos = 0;
+
+    pos += put(&buffer[pos], colors_ ? COLOR_START[kind] : COLOR_NONE);
+    pos += formatTimestamp(msg.timestamp_us, &buffer[pos], 6);
+    pos += put(&buffer[pos], colors_ ? COLOR_RESET_SPACE_START[kind] : SPACE);
+    buffer[pos++] = (kind == KIND_RTR) ? 'R' : 'T';
+    pos += put(&buffer[pos], colors_ ? COLOR_RESET : COLOR_NONE);
+
+    buffer[pos++] = ' ';
+    pos += DigitEmitter::hexMinWidth(&buffer[pos], id, 3);
+    pos += DigitEmitter::literal(&buffer[pos], " [");
+    buffer[pos++] = '0' + dlc;
+    pos += DigitEmitter::literal(&buffer[pos], "] ");
+
+    for (uint8_t i = 0; i < dlc; i++) {
+        pos += DigitEmitter::hexByte(&buffer[pos], msg.data[i]);
+        buffer[pos++] = ' ';
+    }
+
+    // Выравнивание под 8 байт
+    for (uint8_t i = dlc; i < 8; i++) {
+        pos += DigitEmitter::literal(&buffer[pos], "   ");
+    }
+
+    pos += DigitEmitter::literal(&buffer[pos], "\r\n");
+    return pos;
+}
+
+uint16_t TextFrameFormatter::formatParsed(const CanMessage_t& msg, uint8_t* buffer) {
+    Kind kind = frameKind(msg);
+    const Segment& start = colors_ ? COLOR_START[kind] : COLOR_NONE;
+    const Segment& reset = colors_ ? COLOR_RESET : COLOR_NONE;
+    bool is_std = (msg.header.IDE == CAN_ID_STD);
+    uint8_t dlc = (msg.header.DLC > 8) ? 8 : msg.header.DLC;
+    uint16_t pos = 0;
+
+    pos += DigitEmitter::literal(&buffer[pos], "\r\n");
+    pos += put(&buffer[pos], start);
+    pos += DigitEmitter::literal(&buffer[pos], "=== CAN Message ===");
+    pos += put(&buffer[pos], reset);
+
+    pos += DigitEmitter::literal(&buffer[pos], "\r\nTimestamp: ");
+    pos += formatTimestamp(msg.timestamp_us, &buffer[pos], 1);
+    pos += DigitEmitter::literal(&buffer[pos], " s\r\nID:        ");
+
+    pos += put(&buffer[pos], start);
+    pos += DigitEmitter::literal(&buffer[pos], "0x");
+    pos += DigitEmitter::hex(&buffer[pos], is_std ? msg.header.StdId : msg.header.ExtId, 8);
+    pos += put(&buffer[pos], reset);
+
+    pos += is_std ? DigitEmitter::literal(&buffer[pos], " (STD, ")
+                  : DigitEmitter::literal(&buffer[pos], " (EXT, ");
+    pos += (kind == KIND_RTR) ? DigitEmitter::literal(&buffer[pos], "RTR)\r\n")
+                              : DigitEmitter::literal(&buffer[pos], "DATA)\r\n");
+
+    pos += DigitEmitter::literal(&buffer[pos], "DLC:       ");
+    buffer[pos++] = '0' + dlc;
+    pos += DigitEmitter::literal(&buffer[pos], " bytes\r\nData:      ");
+
+    for (uint8_t i = 0; i < dlc; i++) {
+        pos += DigitEmitter::hexByte(&buffer[pos], msg.data[i]);
+        buffer[pos++] = ' ';
+    }
+
+    pos += DigitEmitter::literal(&buffer[pos], "\r\nASCII:    \"");
+    for (uint8_t i = 0; i < dlc; i++) {
+        uint8_t c = msg.data[i];
+        buffer[pos++] = (c >= 32 && c <= 126) ? c : '.';
+    }
+    pos += DigitEmitter::literal(&buffer[pos], "\"\r\n");
+
+    return pos;
+}
+
+uint16_t TextFrameFormatter::formatChange(const IdStatsTable::Entry& entry, uint8_t changed_bytes,
+                                          uint8_t* buffer, uint16_t buffer_size) {
+    // 00010000 123 [8] 01 02*03 04 05 06 07 08
+    if (buffer == nullptr || buffer_size < MAX_LINE_SIZE) {
+        return 0;
+    }
+
+    uint16_t pos = DigitEmitter::decimal(buffer, entry.lastPeriodUs(), 8);
+    buffer[pos++] = ' ';
+    pos += entry.isExtended() ? DigitEmitter::hex(&buffer[pos], entry.id(), 8)
+                              : DigitEmitter::hex(&buffer[pos], entry.id(), 3);
+    pos += DigitEmitter::literal(&buffer[pos], " [");
+    buffer[pos++] = '0' + entry.dlc;
+    buffer[pos++] = ']';
+
+    for (uint8_t i = 0; i < entry.dlc; i++) {
+        if ((changed_bytes & (1U << i)) == 0) {
+            buffer[pos++] = ' ';
+            pos += DigitEmitter::hexByte(&buffer[pos], entry.data[i]);
+        } else if (colors_) {
+            pos += put(&buffer[pos], CHANGED_START);
+            pos += DigitEmitter::hexByte(&buffer[pos], entry.data[i]);
+            pos += put(&buffer[pos], CHANGED_END);
+        } else {
+            buffer[pos++] = '*';
+            pos += DigitEmitter::hexByte(&buffer[pos], entry.data[i]);
+        }
+    }
+
+    pos += DigitEmitter::literal(&buffer[pos], "\r\n");
+    return pos;
+}
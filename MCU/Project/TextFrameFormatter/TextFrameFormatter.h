@@ -0,0 +1,77 @@
+/*
+ * TextFrameFormatter.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef TEXTFRAMEFORMATTER_TEXTFRAMEFORMATTER_H_
+#define TEXTFRAMEFORMATTER_TEXTFRAMEFORMATTER_H_
+
+#include "CanProcessor/CanProcessor.h"
+#include "IdStatsTable/IdStatsTable.h"
+#include <cstdint>
+
+// Текстовый вывод кадров для режимов "read raw" и "read parsed".
+// Без printf: ANSI-префиксы заранее посчитаны, байты - через таблицу nibble -> hex.
+class TextFrameFormatter {
+public:
+    enum class Layout {
+        Raw,     // Одна строка на кадр
+        Parsed   // Подробный разбор с ASCII
+    };
+
+    static constexpr uint16_t MAX_LINE_SIZE = 256;  // Худший случай одного кадра
+
+    TextFrameFormatter(Layout layout = Layout::Raw, bool colors = true);
+
+    // Возвращает число записанных байт, 0 если буфер меньше MAX_LINE_SIZE
+    uint16_t format(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size);
+
+    void setLayout(Layout layout) { layout_ = layout; }
+    Layout getLayout() const { return layout_; }
+
+    // Строка режима "read changes": последний период, ID и данные, измененные
+    // байты выделены красным (без цветов - звездочкой перед байтом)
+    uint16_t formatChange(const IdStatsTable::Entry& entry, uint8_t changed_bytes,
+                          uint8_t* buffer, uint16_t buffer_size);
+
+    // Без цветов строка короче на 18 байт
+    void setColors(bool enable) { colors_ = enable; }
+    bool getColors() const { return colors_; }
+
+private:
+    // Вид кадра определяет цвет: STD - зеленый, EXT - голубой, RTR - желтый
+    enum Kind : uint8_t {
+        KIND_STD = 0,
+        KIND_EXT,
+        KIND_RTR,
+        KIND_COUNT
+    };
+
+    struct Segment {
+        const char* text;
+        uint8_t length;
+    };
+
+    // Заранее собранные ANSI-последовательности
+    static const Segment COLOR_START[KIND_COUNT];
+    static const Segment COLOR_RESET_SPACE_START[KIND_COUNT];
+    static const Segment COLOR_RESET;
+    static const Segment COLOR_NONE;
+    static const Segment SPACE;
+    static const Segment CHANGED_START;
+    static const Segment CHANGED_END;
+
+    Layout layout_;
+    bool colors_;
+
+    static Kind frameKind(const CanMessage_t& msg);
+    static uint16_t put(uint8_t* dst, const Segment& segment);
+    static uint16_t formatTimestamp(uint64_t timestamp_us, uint8_t* dst, uint8_t seconds_width);
+
+    uint16_t formatRaw(const CanMessage_t& msg, uint8_t* buffer);
+    uint16_t formatParsed(const CanMessage_t& msg, uint8_t* buffer);
+};
+
+#endif /* TEXTFRAMEFORMATTER_TEXTFRAMEFORMATTER_H_ */
@@ -0,0 +1,35 @@
+/*
+ * CycleCounter.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef TIMING_CYCLECOUNTER_H_
+#define TIMING_CYCLECOUNTER_H_
+
+#include "main.h"
+#include <cstdint>
+
+// Счётчик тактов ядра на DWT CYCCNT. Переполняется каждые ~67 с при 64 МГц,
+// поэтому годится только для коротких интервалов (разность по модулю 2^32).
+class CycleCounter {
+public:
+    static void init() {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    static inline uint32_t now() { return DWT->CYCCNT; }
+
+    static inline uint32_t elapsed(uint32_t start) { return DWT->CYCCNT - start; }
+
+    static inline uint32_t cyclesPerMicro() { return SystemCoreClock / 1000000U; }
+
+    static inline uint32_t microsToCycles(uint32_t us) { return us * cyclesPerMicro(); }
+
+    static inline uint32_t cyclesToMicros(uint32_t cycles) { return cycles / cyclesPerMicro(); }
+};
+
+#endif /* TIMING_CYCLECOUNTER_H_ */
@@ -0,0 +1,49 @@
+/*
+ * IsrProfiler.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef TIMING_ISRPROFILER_H_
+#define TIMING_ISRPROFILER_H_
+
+#include "Timing/CycleCounter.h"
+#include <cstdint>
+
+// Худшее и среднее время обработчика прерывания в тактах DWT.
+// Использование: start = CycleCounter::now() в начале, record(start) в конце.
+// Пишет только прерывание, читает superloop (среднее может быть рассогласовано
+// на один вызов - для статистики это неважно).
+class IsrProfiler {
+public:
+    inline void record(uint32_t start_cycles) {
+        uint32_t cycles = CycleCounter::elapsed(start_cycles);
+
+        calls_++;
+        total_cycles_ += cycles;
+        if (cycles > worst_cycles_) {
+            worst_cycles_ = cycles;
+        }
+    }
+
+    uint32_t getCalls() const { return calls_; }
+    uint32_t getWorstCycles() const { return worst_cycles_; }
+    uint32_t getAverageCycles() const {
+        uint32_t calls = calls_;
+        return (calls != 0) ? (uint32_t)(total_cycles_ / calls) : 0;
+    }
+
+    void reset() {
+        calls_ = 0;
+        total_cycles_ = 0;
+        worst_cycles_ = 0;
+    }
+
+private:
+    volatile uint32_t calls_ = 0;
+    volatile uint64_t total_cycles_ = 0;
+    volatile uint32_t worst_cycles_ = 0;
+};
+
+#endif /* TIMING_ISRPROFILER_H_ */
@@ -0,0 +1,93 @@
+/*
+ * Timebase.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef TIMING_TIMEBASE_H_
+#define TIMING_TIMEBASE_H_
+
+#include "main.h"
+#include "tim.h"
+#include <cstdint>
+
+// Микросекундная шкала времени на TIM2: 32 бита, 1 МГц, свободный счет.
+// Аппаратный счетчик переполняется каждые ~71.6 мин, старшее слово
+// досчитывается программно - micros() нужно вызывать хотя бы раз за период
+// (superloop делает это через update()).
+class Timebase {
+public:
+    static constexpr uint32_t TICKS_PER_SECOND = 1000000;
+
+    static void init() {
+        high_ = 0;
+        last_low_ = 0;
+        __HAL_TIM_SET_COUNTER(&htim2, 0);
+        HAL_TIM_Base_Start(&htim2);
+    }
+
+    // Младшие 32 бита - для коротких интервалов (разность по модулю 2^32)
+    static inline uint32_t micros32() { return htim2.Instance->CNT; }
+
+    // Полное 64-битное время. Безопасно из прерываний и из superloop.
+    static inline uint64_t micros() {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        uint32_t low = htim2.Instance->CNT;
+        if (low < last_low_) {
+            high_++;
+        }
+        last_low_ = low;
+        uint64_t now = ((uint64_t)high_ << 32) | low;
+
+        __set_PRIMASK(primask);
+        return now;
+    }
+
+    static inline void update() { (void)micros(); }
+
+    // Будильники на каналах сравнения того же счетчика
+    enum class Alarm : uint8_t {
+        SEQUENCE,   // CC1 - SequenceManager
+        REPLAY,     // CC2 - ReplayPlayer
+        TRACE,      // CC3 - TracePlayer
+    };
+
+    // Прерывание TIM2 в момент deadline_us. false - момент уже наступил
+    // (совпадение при записи CCRx могло не сработать), вызывающий
+    // обслуживает его сам.
+    static inline bool setAlarm(uint32_t deadline_us, Alarm alarm = Alarm::SEQUENCE) {
+        __HAL_TIM_SET_COMPARE(&htim2, channelOf(alarm), deadline_us);
+        __HAL_TIM_CLEAR_IT(&htim2, interruptOf(alarm));
+        __HAL_TIM_ENABLE_IT(&htim2, interruptOf(alarm));
+        return (int32_t)(deadline_us - micros32()) > 0;
+    }
+
+    static inline void cancelAlarm(Alarm alarm = Alarm::SEQUENCE) {
+        __HAL_TIM_DISABLE_IT(&htim2, interruptOf(alarm));
+        __HAL_TIM_CLEAR_IT(&htim2, interruptOf(alarm));
+    }
+
+    // Разбивка на секунды и микросекунды для текстового вывода
+    static inline void split(uint64_t timestamp_us, uint32_t& seconds, uint32_t& micros) {
+        seconds = (uint32_t)(timestamp_us / TICKS_PER_SECOND);
+        micros = (uint32_t)(timestamp_us - (uint64_t)seconds * TICKS_PER_SECOND);
+    }
+
+private:
+    static inline uint32_t high_ = 0;
+    static inline uint32_t last_low_ = 0;
+
+    static constexpr uint32_t channelOf(Alarm alarm) {
+        return (alarm == Alarm::SEQUENCE) ? TIM_CHANNEL_1 :
+               (alarm == Alarm::REPLAY)   ? TIM_CHANNEL_2 : TIM_CHANNEL_3;
+    }
+    static constexpr uint32_t interruptOf(Alarm alarm) {
+        return (alarm == Alarm::SEQUENCE) ? TIM_IT_CC1 :
+               (alarm == Alarm::REPLAY)   ? TIM_IT_CC2 : TIM_IT_CC3;
+    }
+};
+
+#endif /* TIMING_TIMEBASE_H_ */
@@ -0,0 +1,282 @@
+/*
+ * TracePlayer.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "TracePlayer.h"
+#include "Timing/Timebase.h"
+#include <cstring>
+
+// Секция .ccm_noinit (NOLOAD) не занимает флеш, не копируется и не
+// обнуляется при старте - содержимое до первой загрузки не определено,
+// поэтому действует только count_
+__attribute__((section(".ccm_noinit")))
+TracePlayer::Record TracePlayer::records_[TracePlayer::MAX_RECORDS];
+
+TracePlayer::TracePlayer(CanSendCallback send_cb)
+    : count_(0),
+      send_callback_(send_cb),
+      state_(State::IDLE),
+      report_ready_(false),
+      position_(0),
+      pass_sent_(0),
+      scale_q16_(1 << 16),
+      last_due_us_(0),
+      start_us_(0),
+      pause_start_us_(0),
+      paused_us_(0),
+      run_(),
+      late_sum_us_(0) {
+}
+
+bool TracePlayer::clear() {
+    if (state_ != State::IDLE) {
+        return false;
+    }
+    count_ = 0;
+    return true;
+}
+
+bool TracePlayer::add(uint32_t delta_us, uint32_t id, bool is_extended, bool is_remote,
+                      const uint8_t* data, uint8_t dlc) {
+    if (state_ != State::IDLE || count_ >= MAX_RECORDS || dlc > 8) {
+        return false;
+    }
+
+    Record& record = records_[count_];
+    record.delta_us = (delta_us > MAX_DELTA_US) ? MAX_DELTA_US : delta_us;
+    record.id = id;
+    record.flags = (is_extended ? FLAG_EXT : 0) | (is_remote ? FLAG_RTR : 0);
+    record.dlc = dlc;
+    memset(record.data, 0, sizeof(record.data));
+    if (!is_remote) {
+        memcpy(record.data, data, dlc);
+    }
+
+    count_++;
+    return true;
+}
+
+bool TracePlayer::play(uint32_t loops, uint16_t speed_percent) {
+    if (count_ == 0) {
+        return false;
+    }
+
+    if (speed_percent == 0) {
+        speed_percent = 100;
+    }
+    if (speed_percent < MIN_SPEED_PERCENT) {
+        speed_percent = MIN_SPEED_PERCENT;
+    }
+    if (speed_percent > MAX_SPEED_PERCENT) {
+        speed_percent = MAX_SPEED_PERCENT;
+    }
+
+    // Повторный play перезапускает прогон без отчета о прерванном
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    Timebase::cancelAlarm(Timebase::Alarm::TRACE);
+
+    run_ = RunStats();
+    run_.records = count_;
+    run_.loops = loops;
+    run_.speed_percent = speed_percent;
+    run_.late_min_us = INT32_MAX;
+    run_.late_max_us = INT32_MIN;
+    late_sum_us_ = 0;
+    report_ready_ = false;
+
+    scale_q16_ = (100UL << 16) / speed_percent;
+    position_ = 0;
+    pass_sent_ = 0;
+    paused_us_ = 0;
+    start_us_ = Timebase::micros32();
+    last_due_us_ = start_us_;
+    state_ = State::PLAYING;
+    service();
+
+    __set_PRIMASK(primask);
+    return true;
+}
+
+bool TracePlayer::pause() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    bool paused = (state_ == State::PLAYING);
+    if (paused) {
+        Timebase::cancelAlarm(Timebase::Alarm::TRACE);
+        pause_start_us_ = Timebase::micros32();
+        state_ = State::PAUSED;
+    }
+
+    __set_PRIMASK(primask);
+    return paused;
+}
+
+bool TracePlayer::resume() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    bool resumed = (state_ == State::PAUSED);
+    if (resumed) {
+        // Расписание сдвигается целиком: следующий кадр ждет столько же,
+        // сколько оставалось до паузы
+        uint32_t paused = Timebase::micros32() - pause_start_us_;
+        last_due_us_ += paused;
+        paused_us_ += paused;
+        state_ = State::PLAYING;
+        service();
+    }
+
+    __set_PRIMASK(primask);
+    return resumed;
+}
+
+void TracePlayer::stop() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (state_ == State::PAUSED) {
+        paused_us_ += Timebase::micros32() - pause_start_us_;
+    }
+    if (state_ != State::IDLE) {
+        finish(false);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void TracePlayer::onAlarm() {
+    if (state_ == State::PLAYING) {
+        service();
+    }
+}
+
+void TracePlayer::getStats(RunStats& stats) const {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    stats = run_;
+    if (run_.sent > 0) {
+        stats.late_avg_us = (int32_t)(late_sum_us_ / (int64_t)run_.sent);
+    } else {
+        stats.late_min_us = 0;
+        stats.late_max_us = 0;
+        stats.late_avg_us = 0;
+    }
+    if (state_ != State::IDLE) {
+        uint32_t now = (state_ == State::PAUSED) ? pause_start_us_ : Timebase::micros32();
+        stats.duration_us = now - start_us_ - paused_us_;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+bool TracePlayer::takeReport(RunStats& stats) {
+    if (!report_ready_) {
+        return false;
+    }
+
+    getStats(stats);
+    report_ready_ = false;
+    return true;
+}
+
+// Отправляет наступившие записи, не больше SERVICE_BUDGET за вызов, и
+// взводит будильник на следующую.
+// Вызывается из прерывания или из основного цикла под запретом прерываний.
+void TracePlayer::service() {
+    uint16_t budget = SERVICE_BUDGET;
+
+    for (;;) {
+        uint32_t now = Timebase::micros32();
+        uint32_t due;
+
+        for (;;) {
+            if (budget == 0) {
+                // Остаток - со следующего прерывания, опоздание сохранится
+                due = now + SERVICE_YIELD_US;
+                break;
+            }
+            budget--;
+
+            const Record& record = records_[position_];
+            due = last_due_us_ + scaled(record.delta_us);
+            if (before(now, due)) {
+                break;
+            }
+
+            SendResult result = send_callback_(record.id, (record.flags & FLAG_EXT) != 0,
+                                               (record.flags & FLAG_RTR) != 0,
+                                               record.data, record.dlc);
+            if (result == SendResult::RETRY) {
+                // Дедлайн записи не меняется: задержка войдет в ее опоздание
+                run_.tx_retries++;
+                due = now + TX_RETRY_US;
+                break;
+            }
+
+            if (result == SendResult::SENT) {
+                recordLateness((int32_t)(now - due));
+                run_.sent++;
+                pass_sent_++;
+            } else {
+                run_.dropped++;
+            }
+
+            last_due_us_ = due;
+            if (++position_ >= count_) {
+                position_ = 0;
+                run_.loops_done++;
+                if (run_.loops != 0 && run_.loops_done >= run_.loops) {
+                    finish(true);
+                    return;
+                }
+                // Круг без единой отправки (CAN остановлен) - крутить дальше незачем
+                if (pass_sent_ == 0) {
+                    finish(false);
+                    return;
+                }
+                pass_sent_ = 0;
+            }
+            now = Timebase::micros32();
+        }
+
+        // Дедлайн мог наступить, пока взводили сравнение - тогда еще круг
+        if (Timebase::setAlarm(due, Timebase::Alarm::TRACE)) {
+            return;
+        }
+    }
+}
+
+void TracePlayer::finish(bool completed) {
+    Timebase::cancelAlarm(Timebase::Alarm::TRACE);
+
+    run_.duration_us = Timebase::micros32() - start_us_ - paused_us_;
+    run_.completed = completed;
+    state_ = State::IDLE;
+    report_ready_ = true;
+}
+
+void TracePlayer::recordLateness(int32_t late) {
+    if (late < run_.late_min_us) {
+        run_.late_min_us = late;
+    }
+    if (late > run_.late_max_us) {
+        run_.late_max_us = late;
+    }
+    if (late > LATE_THRESHOLD_US) {
+        run_.late_over++;
+    }
+    late_sum_us_ += late;
+}
+
+// 64-битное произведение - одна инструкция UMULL, без деления в прерывании
+uint32_t TracePlayer::scaled(uint32_t delta_us) const {
+    uint64_t value = ((uint64_t)delta_us * scale_q16_) >> 16;
+    return (value > MAX_DELTA_US) ? MAX_DELTA_US : (uint32_t)value;
+}
@@ -0,0 +1,139 @@
+/*
+ * TracePlayer.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef TRACEPLAYER_TRACEPLAYER_H_
+#define TRACEPLAYER_TRACEPLAYER_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Емкость трассы в записях, переопределяется флагом -DTRACE_BUFFER_RECORDS=N.
+// Буфер лежит в CCM RAM (64 КБ, CPU-only) - DMA к нему не нужен.
+// 14 КБ CCM занимает индекс IdStatsTable, трассе остается до 2500 записей
+#ifndef TRACE_BUFFER_RECORDS
+#define TRACE_BUFFER_RECORDS 2048
+#endif
+
+// Воспроизведение трассы, загруженной в память устройства.
+// В отличие от потока (ReplayPlayer) трасса хранится целиком, поэтому
+// ее можно проиграть несколько раз, с другой скоростью и с паузами.
+// Дедлайны абсолютные: дедлайн записи - дедлайн предыдущей плюс ее
+// delta_us, деленная на скорость. Будит отправку канал TIM2 CC3.
+// Между кругами delta первой записи отсчитывается от последней.
+// Пауза сдвигает расписание на свою длительность и в опоздание не входит.
+// По окончании прогона (все круги или stop) готовится отчет о
+// точности - основной цикл забирает его через takeReport().
+class TracePlayer {
+public:
+    enum class SendResult : uint8_t {
+        SENT,
+        RETRY,      // Очередь передачи полна - повторить позже
+        DROPPED,    // Кадр не может быть отправлен
+    };
+
+    typedef SendResult (*CanSendCallback)(uint32_t id, bool is_extended, bool is_remote,
+                                          const uint8_t* data, uint8_t dlc);
+
+    enum class State : uint8_t {
+        IDLE,
+        PLAYING,
+        PAUSED,
+    };
+
+    static constexpr uint32_t MAX_RECORDS = TRACE_BUFFER_RECORDS;
+    static constexpr uint32_t TX_RETRY_US = 50;
+    // Работа одного вызова service(): трасса из нулевых delta (или delta,
+    // ставших нулем при ускорении) иначе не отпустила бы прерывание
+    static constexpr uint16_t SERVICE_BUDGET = 32;
+    static constexpr uint32_t SERVICE_YIELD_US = 10;
+    // Дедлайны сравниваются по модулю 2^32 - и после масштабирования
+    static constexpr uint32_t MAX_DELTA_US = 1000000000;
+    static constexpr uint16_t MIN_SPEED_PERCENT = 10;
+    static constexpr uint16_t MAX_SPEED_PERCENT = 1000;
+    // Опоздания больше порога считаются отдельно
+    static constexpr int32_t LATE_THRESHOLD_US = 10;
+
+    // Статистика прогона: текущего или последнего завершенного
+    struct RunStats {
+        uint32_t records;
+        uint32_t loops;         // 0 - бесконечно
+        uint32_t loops_done;
+        uint16_t speed_percent;
+        bool completed;         // false - прерван командой stop или круг не отправил ни кадра
+        uint32_t sent;
+        uint32_t dropped;
+        uint32_t tx_retries;
+        uint32_t late_over;     // Опоздания больше LATE_THRESHOLD_US
+        int32_t late_min_us;
+        int32_t late_max_us;
+        int32_t late_avg_us;
+        uint32_t duration_us;   // Без пауз
+    };
+
+    TracePlayer(CanSendCallback send_cb);
+
+    // Загрузка только в IDLE. add(): false - трасса полна или идет прогон
+    bool clear();
+    bool add(uint32_t delta_us, uint32_t id, bool is_extended, bool is_remote,
+             const uint8_t* data, uint8_t dlc);
+    uint32_t getRecordCount() const { return count_; }
+
+    // loops 0 - бесконечно, speed_percent 100 - исходный темп
+    bool play(uint32_t loops, uint16_t speed_percent);
+    bool pause();
+    bool resume();
+    void stop();
+
+    // Вызывается из прерывания сравнения TIM2 CC3
+    void onAlarm();
+
+    State getState() const { return state_; }
+    uint32_t getPosition() const { return position_; }
+    void getStats(RunStats& stats) const;
+
+    // Из основного цикла: true один раз после окончания прогона
+    bool takeReport(RunStats& stats);
+
+private:
+    struct Record {
+        uint32_t delta_us;
+        uint32_t id;
+        uint8_t flags;
+        uint8_t dlc;
+        uint8_t data[8];
+    };
+
+    static constexpr uint8_t FLAG_EXT = 0x01;
+    static constexpr uint8_t FLAG_RTR = 0x02;
+
+    static Record records_[MAX_RECORDS];   // В CCM RAM, см. TracePlayer.cpp
+    uint32_t count_;
+    CanSendCallback send_callback_;
+
+    volatile State state_;
+    volatile bool report_ready_;
+    uint32_t position_;
+    uint32_t pass_sent_;        // Отправлено за текущий круг
+    uint32_t scale_q16_;        // 100 / speed в формате 16.16
+    uint32_t last_due_us_;
+    uint32_t start_us_;
+    uint32_t pause_start_us_;
+    uint32_t paused_us_;
+
+    RunStats run_;
+    int64_t late_sum_us_;
+
+    void service();
+    void finish(bool completed);
+    void recordLateness(int32_t late);
+    uint32_t scaled(uint32_t delta_us) const;
+
+    // Сравнение по модулю 2^32: a раньше b
+    static inline bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+};
+
+#endif /* TRACEPLAYER_TRACEPLAYER_H_ */
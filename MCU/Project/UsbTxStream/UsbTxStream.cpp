@@ -0,0 +1,170 @@
+/*
+ * UsbTxStream.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "UsbTxStream.h"
+#include "main.h"
+#include "usbd_def.h"
+#include <cstring>
+
+UsbTxStream::UsbTxStream(TransmitCallback transmit_cb)
+    : reserved_in_scratch_(false),
+      head_(0),
+      tail_(0),
+      in_flight_(0),
+      busy_(false),
+      transmit_callback_(transmit_cb) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+bool UsbTxStream::write(const uint8_t* data, uint16_t length) {
+    if (data == nullptr || length == 0) {
+        return true;
+    }
+
+    uint32_t head = head_;
+    uint32_t used = head - tail_;
+
+    if (length > BUFFER_SIZE - used) {
+        stats_.dropped_bytes += length;
+        stats_.overruns++;
+        flush();
+        return false;
+    }
+
+    copyIn(head, data, length);
+    flush();
+    return true;
+}
+
+uint8_t* UsbTxStream::reserve(uint16_t length) {
+    if (length == 0 || length > MAX_RESERVE) {
+        return nullptr;
+    }
+
+    uint32_t head = head_;
+    uint32_t used = head - tail_;
+
+    if (length > BUFFER_SIZE - used) {
+        return nullptr;
+    }
+
+    // Участок до конца кольца мал - пишем во временный буфер, commit() скопирует
+    uint32_t offset = head & BUFFER_MASK;
+    reserved_in_scratch_ = (BUFFER_SIZE - offset < length);
+
+    return reserved_in_scratch_ ? scratch_ : &buffer_[offset];
+}
+
+void UsbTxStream::commit(uint16_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    uint32_t head = head_;
+
+    if (reserved_in_scratch_) {
+        reserved_in_scratch_ = false;
+        copyIn(head, scratch_, length);
+        return;
+    }
+
+    publish(head, length);
+}
+
+void UsbTxStream::copyIn(uint32_t head, const uint8_t* data, uint16_t length) {
+    // Копируем с учетом перехода через конец кольца
+    uint32_t offset = head & BUFFER_MASK;
+    uint32_t first = BUFFER_SIZE - offset;
+    if (first > length) {
+        first = length;
+    }
+
+    memcpy(&buffer_[offset], data, first);
+    if (first < length) {
+        memcpy(&buffer_[0], data + first, length - first);
+    }
+
+    publish(head, length);
+}
+
+void UsbTxStream::publish(uint32_t head, uint16_t length) {
+    // Данные должны лечь в память раньше, чем прерывание увидит новый head_
+    __DMB();
+    head_ = head + length;
+
+    stats_.written_bytes += length;
+    if (head + length - tail_ > stats_.peak_usage) {
+        stats_.peak_usage = head + length - tail_;
+    }
+}
+
+void UsbTxStream::flush() {
+    if (busy_) {
+        return;
+    }
+
+    // Прерывание USB может одновременно завершать передачу
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (!busy_) {
+        startTransfer();
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void UsbTxStream::onTransmitComplete() {
+    tail_ = tail_ + in_flight_;
+    in_flight_ = 0;
+    busy_ = false;
+
+    startTransfer();
+}
+
+void UsbTxStream::reset() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    tail_ = head_;
+    in_flight_ = 0;
+    busy_ = false;
+
+    __set_PRIMASK(primask);
+}
+
+void UsbTxStream::startTransfer() {
+    uint32_t tail = tail_;
+    uint32_t pending = head_ - tail;
+
+    if (pending == 0 || transmit_callback_ == nullptr) {
+        return;
+    }
+
+    // Передаем только непрерывный участок, остаток уйдет следующей передачей
+    uint32_t offset = tail & BUFFER_MASK;
+    uint32_t length = BUFFER_SIZE - offset;
+
+    if (length > pending) {
+        length = pending;
+    }
+    if (length > MAX_TRANSFER) {
+        length = MAX_TRANSFER;
+    }
+
+    in_flight_ = (uint16_t)length;
+    busy_ = true;
+
+    if (transmit_callback_(&buffer_[offset], (uint16_t)length) != USBD_OK) {
+        // Хост не подключен или канал занят - попробуем при следующей записи
+        in_flight_ = 0;
+        busy_ = false;
+        return;
+    }
+
+    stats_.transfers++;
+}
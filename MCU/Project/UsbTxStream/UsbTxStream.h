@@ -0,0 +1,82 @@
+/*
+ * UsbTxStream.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef USBTXSTREAM_USBTXSTREAM_H_
+#define USBTXSTREAM_USBTXSTREAM_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Неблокирующий поток передачи в USB CDC.
+// Писатель (superloop) копирует данные в кольцо, передача идет прямо из
+// кольца и продолжается из CDC_TransmitCplt_FS. Мелкие записи склеиваются
+// в одну передачу, которую USB-стек режет на полные пакеты по 64 байта.
+class UsbTxStream {
+public:
+    // Низкоуровневая передача (CDC_Transmit_FS), возвращает USBD_OK при успехе
+    typedef uint8_t (*TransmitCallback)(uint8_t* buffer, uint16_t length);
+
+    static constexpr uint32_t BUFFER_SIZE  = 8192;  // Степень двойки
+    static constexpr uint32_t BUFFER_MASK  = BUFFER_SIZE - 1;
+    static constexpr uint16_t MAX_TRANSFER = 1024;  // Максимум байт за одну передачу
+    static constexpr uint16_t MAX_RESERVE  = 256;   // Максимум байт для reserve()
+
+    struct Stats {
+        uint32_t written_bytes;  // Принято в кольцо
+        uint32_t dropped_bytes;  // Отброшено из-за нехватки места
+        uint32_t overruns;       // Количество отброшенных записей
+        uint32_t transfers;      // Запущено передач
+        uint32_t peak_usage;     // Максимальное заполнение кольца
+    };
+
+    UsbTxStream(TransmitCallback transmit_cb);
+
+    // Записывает блок целиком или не записывает вовсе (счетчик overruns)
+    bool write(const uint8_t* data, uint16_t length);
+
+    // Запись на месте: reserve() отдает непрерывный участок кольца под
+    // length байт (или nullptr, если места нет), commit() публикует
+    // фактически записанные байты. Передача сама не запускается - см. flush().
+    // Отказ reserve() не считается overrun: потерю учитывает вызывающий,
+    // если данные действительно отброшены, а не отложены.
+    uint8_t* reserve(uint16_t length);
+    void commit(uint16_t length);
+
+    // Запускает передачу, если канал свободен
+    void flush();
+
+    // Вызывается из CDC_TransmitCplt_FS (контекст прерывания USB)
+    void onTransmitComplete();
+
+    // Вызывается при (пере)подключении хоста: всё недоотправленное отбрасывается
+    void reset();
+
+    uint32_t getFreeSpace() const { return BUFFER_SIZE - (head_ - tail_); }
+    uint32_t getUsedSpace() const { return head_ - tail_; }
+    uint32_t getDroppedBytes() const { return stats_.dropped_bytes; }
+    uint32_t getOverrunCount() const { return stats_.overruns; }
+    const Stats& getStats() const { return stats_; }
+
+private:
+    uint8_t buffer_[BUFFER_SIZE];
+    uint8_t scratch_[MAX_RESERVE];  // Для reserve() через границу кольца
+    bool reserved_in_scratch_;
+
+    volatile uint32_t head_;        // Пишет только superloop
+    volatile uint32_t tail_;        // Двигает только прерывание USB
+    volatile uint16_t in_flight_;   // Длина текущей передачи
+    volatile bool busy_;
+
+    TransmitCallback transmit_callback_;
+    Stats stats_;
+
+    void startTransfer();
+    void copyIn(uint32_t head, const uint8_t* data, uint16_t length);
+    void publish(uint32_t head, uint16_t length);
+};
+
+#endif /* USBTXSTREAM_USBTXSTREAM_H_ */
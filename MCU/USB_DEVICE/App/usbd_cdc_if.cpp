@@ -94,6 +94,8 @@ uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
 uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
+/* OUT endpoint is left NAKing while the command ring has no room for a packet */
+static volatile uint8_t rx_paused = 0;
 
 /* USER CODE END PRIVATE_VARIABLES */
 
@@ -155,6 +157,12 @@ static int8_t CDC_Init_FS(void)
   /* Set Application Buffers */
   USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+
+  /* Host (re)connected: drop whatever was in flight */
+  rx_paused = 0;
+  if (sys != NULL && sys->usb_tx != NULL) {
+    sys->usb_tx->reset();
+  }
   return (USBD_OK);
   /* USER CODE END 3 */
 }
@@ -261,11 +269,20 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 6 */
-	  if (sys->command_handler != NULL && Buf != NULL && Len != NULL && *Len > 0) {
-	    sys->command_handler->processBuffer(Buf, *Len);
-	  }
+  /* Only copy the packet out; commands are parsed in the main loop */
+  if (sys->command_handler != NULL && Buf != NULL && Len != NULL && *Len > 0) {
+    sys->command_handler->receive(Buf, *Len);
+  }
 
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
+
+  /* Next packet would not fit: NAK the host until CDC_ResumeReceive_FS() */
+  if (sys->command_handler != NULL &&
+      sys->command_handler->getRxFreeSpace() < CDC_DATA_FS_MAX_PACKET_SIZE) {
+    rx_paused = 1;
+    return (USBD_OK);
+  }
+
   USBD_CDC_ReceivePacket(&hUsbDeviceFS);
   return (USBD_OK);
   /* USER CODE END 6 */
@@ -287,6 +304,9 @@ uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
   uint8_t result = USBD_OK;
   /* USER CODE BEGIN 7 */
   USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+  if (hcdc == NULL){
+    return USBD_FAIL;
+  }
   if (hcdc->TxState != 0){
     return USBD_BUSY;
   }
@@ -315,12 +335,36 @@ static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
   UNUSED(Buf);
   UNUSED(Len);
   UNUSED(epnum);
+
+  /* Continue draining the TX stream from the USB interrupt */
+  if (sys != NULL && sys->usb_tx != NULL) {
+    sys->usb_tx->onTransmitComplete();
+  }
   /* USER CODE END 13 */
   return result;
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
+/**
+  * @brief  Re-arms the OUT endpoint paused by CDC_Receive_FS once the
+  *         command ring has room for a full packet. Called from the main loop.
+  * @retval None
+  */
+void CDC_ResumeReceive_FS(void)
+{
+  if (!rx_paused || sys == NULL || sys->command_handler == NULL ||
+      sys->command_handler->getRxFreeSpace() < CDC_DATA_FS_MAX_PACKET_SIZE) {
+    return;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  rx_paused = 0;
+  USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+  __set_PRIMASK(primask);
+}
+
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
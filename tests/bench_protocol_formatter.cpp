@@ -0,0 +1,285 @@
+/*
+ * bench_protocol_formatter.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+// Замер форматтеров на ПК: нынешний ProtocolFormatter против прежней
+// реализации на malloc/sprintf/snprintf (сохранена ниже как эталон).
+// Запуск: bench_protocol_formatter [итераций]. Raw и Cobs обязаны совпадать
+// с эталоном байт в байт, при расхождении код возврата 1.
+
+#include "ProtocolFormatter/ProtocolFormatter.h"
+#include "COBSLib/cobs.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+namespace legacy {
+
+// Прежний ProtocolFormatter до перехода на DigitEmitter, метка времени в мс
+
+static void formatTypeIdentifier(const CanMessage_t& msg, uint8_t* buffer, uint16_t& pos) {
+    if (msg.header.IDE == CAN_ID_STD) {
+        buffer[pos] = (msg.header.RTR == CAN_RTR_DATA) ? 't' : 'r';
+    } else {
+        buffer[pos] = (msg.header.RTR == CAN_RTR_DATA) ? 'T' : 'R';
+    }
+    pos++;
+}
+
+static void setFormatedDatagramIdentifer(uint32_t idNum, uint8_t* pExitBuffer,
+                                         uint16_t* pCursor, int len) {
+    char* id = (char*)malloc(sizeof(char) * (len + 1));
+    int numOfDigits = 0;
+    int valueToConsume = idNum;
+
+    while (valueToConsume != 0) {
+        valueToConsume /= 10;
+        ++numOfDigits;
+    }
+
+    if (numOfDigits == 0) {
+        numOfDigits = 1;
+    }
+
+    sprintf(id + (len - numOfDigits), "%d", (int)idNum);
+    for (int eraser = 0; eraser < (len - numOfDigits); eraser++) {
+        id[eraser] = '0';
+    }
+
+    id[len] = '\0';
+    memcpy((char*)pExitBuffer + *pCursor, id, len);
+    free(id);
+    *pCursor = *pCursor + len;
+}
+
+static uint16_t rawFormat(const CanMessage_t& msg, uint8_t* buffer) {
+    uint16_t pos = 0;
+
+    formatTypeIdentifier(msg, buffer, pos);
+
+    if (msg.header.IDE == CAN_ID_EXT) {
+        setFormatedDatagramIdentifer(msg.header.ExtId, buffer, &pos, 9);
+    } else {
+        setFormatedDatagramIdentifer(msg.header.StdId, buffer, &pos, 4);
+    }
+
+    buffer[pos++] = '0' + (msg.header.DLC % 10);
+
+    if (msg.header.RTR == CAN_RTR_DATA && msg.header.DLC > 0 && msg.header.DLC <= 8) {
+        memcpy(&buffer[pos], msg.data, msg.header.DLC);
+        pos += msg.header.DLC;
+    }
+    return pos;
+}
+
+static uint16_t cobsFormat(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size) {
+    uint8_t raw_buffer[24] = {0};
+    uint16_t raw_len = rawFormat(msg, raw_buffer);
+
+    raw_buffer[raw_len] = 0x00;
+    raw_len++;
+
+    cobs_encode_result result = cobs_encode(buffer, buffer_size, raw_buffer, raw_len);
+
+    if (result.status == COBS_ENCODE_OK) {
+        if (result.out_len + 1 < buffer_size) {
+            buffer[result.out_len] = 0x00;
+            return result.out_len + 1;
+        }
+    }
+    return 0;
+}
+
+static uint16_t asciiFormat(const CanMessage_t& msg, uint8_t* buffer, uint16_t buffer_size) {
+    char* buf = reinterpret_cast<char*>(buffer);
+    int pos = 0;
+    unsigned long timestamp_ms = (unsigned long)(msg.timestamp_us / 1000);
+
+    pos += snprintf(buf + pos, buffer_size - pos, "[%010lu] ", timestamp_ms);
+
+    if (msg.header.IDE == CAN_ID_STD) {
+        if (msg.header.RTR == CAN_RTR_DATA) {
+            pos += snprintf(buf + pos, buffer_size - pos, "STD_DATA ");
+        } else {
+            pos += snprintf(buf + pos, buffer_size - pos, "STD_REMOTE ");
+        }
+    } else {
+        if (msg.header.RTR == CAN_RTR_DATA) {
+            pos += snprintf(buf + pos, buffer_size - pos, "EXT_DATA ");
+        } else {
+            pos += snprintf(buf + pos, buffer_size - pos, "EXT_REMOTE ");
+        }
+    }
+
+    if (msg.header.IDE == CAN_ID_STD) {
+        pos += snprintf(buf + pos, buffer_size - pos, "0x%03X ", (unsigned)msg.header.StdId);
+    } else {
+        pos += snprintf(buf + pos, buffer_size - pos, "0x%08lX ", (unsigned long)msg.header.ExtId);
+    }
+
+    pos += snprintf(buf + pos, buffer_size - pos, "DLC:%d ", (int)msg.header.DLC);
+
+    if (msg.header.RTR == CAN_RTR_DATA && msg.header.DLC > 0) {
+        pos += snprintf(buf + pos, buffer_size - pos, "DATA:");
+        for (int i = 0; i < (int)msg.header.DLC; i++) {
+            pos += snprintf(buf + pos, buffer_size - pos, "%02X", msg.data[i]);
+            if (i < (int)msg.header.DLC - 1) {
+                pos += snprintf(buf + pos, buffer_size - pos, " ");
+            }
+        }
+    }
+
+    pos += snprintf(buf + pos, buffer_size - pos, "\r\n");
+    return pos;
+}
+
+} // namespace legacy
+
+static constexpr uint16_t FRAME_COUNT = 64;
+static constexpr uint16_t OUT_SIZE = 256;
+
+// Смесь как на шине: STD/EXT, данные и RTR, DLC 0..8
+static void makeFrames(CanMessage_t* frames) {
+    uint32_t seed = 12345;
+    auto next = [&seed]() { seed = seed * 1103515245 + 12345; return seed >> 8; };
+    uint64_t time_us = 1000000;
+
+    for (uint16_t i = 0; i < FRAME_COUNT; i++) {
+        CanMessage_t& msg = frames[i];
+        memset(&msg, 0, sizeof(msg));
+        bool is_extended = (i % 2) != 0;
+        msg.header.IDE = is_extended ? CAN_ID_EXT : CAN_ID_STD;
+        msg.header.StdId = next() & 0x7FF;
+        msg.header.ExtId = next() & 0x1FFFFFFF;
+        msg.header.RTR = (i % 8 == 7) ? CAN_RTR_REMOTE : CAN_RTR_DATA;
+        msg.header.DLC = (i % 4 == 0) ? (next() % 9) : 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            msg.data[b] = (uint8_t)next();
+        }
+        time_us += 100 + next() % 400;
+        msg.timestamp_us = time_us;
+    }
+}
+
+struct Timing {
+    double ns_per_frame;
+    double ticks_per_frame;
+    uint32_t checksum;   // Не дает компилятору выбросить вызовы
+};
+
+template <typename Format>
+static Timing measure(const CanMessage_t* frames, uint32_t iterations, Format format) {
+    static uint8_t out[OUT_SIZE];
+    Timing timing = {};
+
+    auto start = std::chrono::steady_clock::now();
+#ifdef BENCH_HAS_TSC
+    uint64_t tsc_start = __rdtsc();
+#endif
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint16_t len = format(frames[i % FRAME_COUNT], out);
+        timing.checksum += len + out[len / 2];
+    }
+#ifdef BENCH_HAS_TSC
+    timing.ticks_per_frame = (double)(__rdtsc() - tsc_start) / iterations;
+#endif
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    timing.ns_per_frame =
+            (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+    return timing;
+}
+
+static void report(const char* name, const Timing& before, const Timing& after) {
+    printf("%-6s legacy %8.1f ns/frame", name, before.ns_per_frame);
+#ifdef BENCH_HAS_TSC
+    printf(" (%7.0f TSC)", before.ticks_per_frame);
+#endif
+    printf("   new %8.1f ns/frame", after.ns_per_frame);
+#ifdef BENCH_HAS_TSC
+    printf(" (%7.0f TSC)", after.ticks_per_frame);
+#endif
+    printf("   x%.1f\n", before.ns_per_frame / after.ns_per_frame);
+}
+
+// Raw и Cobs не меняли формат вывода - сверяем с эталоном
+static int compareWithLegacy(const CanMessage_t* frames) {
+    ProtocolFormatter formatter;
+    int mismatches = 0;
+
+    for (uint16_t i = 0; i < FRAME_COUNT; i++) {
+        uint8_t expected[OUT_SIZE], actual[OUT_SIZE];
+
+        uint16_t expected_len = legacy::rawFormat(frames[i], expected);
+        uint16_t actual_len = formatter.rawFormat(frames[i], actual, OUT_SIZE);
+        if (expected_len != actual_len || memcmp(expected, actual, actual_len) != 0) {
+            printf("Raw mismatch at frame %u\n", i);
+            mismatches++;
+        }
+
+        expected_len = legacy::cobsFormat(frames[i], expected, OUT_SIZE);
+        actual_len = formatter.cobsFormat(frames[i], actual, OUT_SIZE);
+        if (expected_len != actual_len || memcmp(expected, actual, actual_len) != 0) {
+            printf("Cobs mismatch at frame %u\n", i);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1000000;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    static CanMessage_t frames[FRAME_COUNT];
+    makeFrames(frames);
+
+    if (compareWithLegacy(frames) != 0) {
+        return 1;
+    }
+
+    static ProtocolFormatter formatter;
+    uint32_t checksum = 0;
+
+    printf("%lu frames per mode\n", (unsigned long)iterations);
+
+    Timing before = measure(frames, iterations, [](const CanMessage_t& msg, uint8_t* out) {
+        return legacy::rawFormat(msg, out);
+    });
+    Timing after = measure(frames, iterations, [](const CanMessage_t& msg, uint8_t* out) {
+        return formatter.rawFormat(msg, out, OUT_SIZE);
+    });
+    report("Raw", before, after);
+    checksum += before.checksum + after.checksum;
+
+    before = measure(frames, iterations, [](const CanMessage_t& msg, uint8_t* out) {
+        return legacy::cobsFormat(msg, out, OUT_SIZE);
+    });
+    after = measure(frames, iterations, [](const CanMessage_t& msg, uint8_t* out) {
+        return formatter.cobsFormat(msg, out, OUT_SIZE);
+    });
+    report("Cobs", before, after);
+    checksum += before.checksum + after.checksum;
+
+    before = measure(frames, iterations, [](const CanMessage_t& msg, uint8_t* out) {
+        return legacy::asciiFormat(msg, out, OUT_SIZE);
+    });
+    after = measure(frames, iterations, [](const CanMessage_t& msg, uint8_t* out) {
+        return formatter.asciiFormat(msg, out, OUT_SIZE);
+    });
+    report("Ascii", before, after);
+    checksum += before.checksum + after.checksum;
+
+    printf("checksum %08lX\n", (unsigned long)checksum);
+    return 0;
+}
@@ -0,0 +1,37 @@
+/*
+ * check.h
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef TESTS_CHECK_H_
+#define TESTS_CHECK_H_
+
+#include <cstdio>
+
+// Минимальные проверки без фреймворка: провал печатает место и
+// увеличивает счетчик, main() возвращает CHECK_RESULT()
+static int check_failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            check_failures++;                                              \
+        }                                                                  \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                          \
+    do {                                                                        \
+        long long va_ = (long long)(a), vb_ = (long long)(b);                   \
+        if (va_ != vb_) {                                                       \
+            printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",            \
+                   __FILE__, __LINE__, #a, #b, va_, vb_);                       \
+            check_failures++;                                                   \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_RESULT() (check_failures == 0 ? 0 : (printf("%d check(s) failed\n", check_failures), 1))
+
+#endif /* TESTS_CHECK_H_ */
@@ -0,0 +1,37 @@
+/*
+ * CanProcessor.h (хост)
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef CANPROCESSOR_CANPROCESSOR_H_
+#define CANPROCESSOR_CANPROCESSOR_H_
+
+// Подмена для сборки на ПК: из настоящего CanProcessor.h форматтерам нужен
+// только CanMessage_t, а он тянет HAL. Поля и константы - как в stm32f4xx_hal_can.h
+
+#include <cstdint>
+
+#define CAN_ID_STD     0x00000000U
+#define CAN_ID_EXT     0x00000004U
+#define CAN_RTR_DATA   0x00000000U
+#define CAN_RTR_REMOTE 0x00000002U
+
+typedef struct {
+    uint32_t StdId;
+    uint32_t ExtId;
+    uint32_t IDE;
+    uint32_t RTR;
+    uint32_t DLC;
+    uint32_t Timestamp;
+    uint32_t FilterMatchIndex;
+} CAN_RxHeaderTypeDef;
+
+typedef struct {
+    uint64_t timestamp_us;
+    CAN_RxHeaderTypeDef header;
+    uint8_t data[8];
+} CanMessage_t;
+
+#endif /* CANPROCESSOR_CANPROCESSOR_H_ */
@@ -0,0 +1,25 @@
+/*
+ * Timebase.h (хост)
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#ifndef TIMING_TIMEBASE_H_
+#define TIMING_TIMEBASE_H_
+
+// Подмена для сборки на ПК: только арифметика без таймера
+
+#include <cstdint>
+
+class Timebase {
+public:
+    static constexpr uint32_t TICKS_PER_SECOND = 1000000;
+
+    static inline void split(uint64_t timestamp_us, uint32_t& seconds, uint32_t& micros) {
+        seconds = (uint32_t)(timestamp_us / TICKS_PER_SECOND);
+        micros = (uint32_t)(timestamp_us - (uint64_t)seconds * TICKS_PER_SECOND);
+    }
+};
+
+#endif /* TIMING_TIMEBASE_H_ */
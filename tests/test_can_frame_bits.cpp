@@ -0,0 +1,158 @@
+/*
+ * test_can_frame_bits.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "check.h"
+#include "CanBusLoadCalculator/CanFrameBits.h"
+#include <cstdlib>
+#include <vector>
+
+// Эталон: кадр собирается побитно в вектор, CRC-15 считается побитно
+// по определению, stuff-биты вставляются в поток явно
+static std::vector<uint8_t> referenceStream(bool is_extended, uint32_t id, bool is_remote,
+                                            uint8_t dlc, const uint8_t* data) {
+    std::vector<uint8_t> bits;
+    auto put = [&](uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; i--) {
+            bits.push_back((value >> i) & 1);
+        }
+    };
+
+    put(0, 1);
+    if (is_extended) {
+        put(id >> 18, 11);
+        put(1, 1);                  // SRR
+        put(1, 1);                  // IDE
+        put(id & 0x3FFFF, 18);
+        put(is_remote, 1);
+        put(0, 2);
+    } else {
+        put(id, 11);
+        put(is_remote, 1);
+        put(0, 2);
+    }
+    put(dlc, 4);
+    if (!is_remote) {
+        for (int i = 0; i < ((dlc > 8) ? 8 : dlc); i++) {
+            put(data[i], 8);
+        }
+    }
+
+    uint16_t crc = 0;
+    for (uint8_t bit : bits) {
+        bool xor_poly = bit ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if (xor_poly) {
+            crc ^= CanFrameBits::CRC15_POLY;
+        }
+    }
+    put(crc, 15);
+
+    std::vector<uint8_t> stuffed;
+    int last = -1;
+    int run = 0;
+    for (uint8_t bit : bits) {
+        stuffed.push_back(bit);
+        run = (bit == last) ? run + 1 : 1;
+        last = bit;
+        if (run == 5) {
+            last ^= 1;
+            stuffed.push_back(last);
+            run = 1;
+        }
+    }
+    return stuffed;
+}
+
+static uint32_t referenceFrameBits(bool is_extended, uint32_t id, bool is_remote,
+                                   uint8_t dlc, const uint8_t* data) {
+    return referenceStream(is_extended, id, is_remote, dlc, data).size() + CanFrameBits::TRAILER_BITS;
+}
+
+// Контрольное значение CRC-15/CAN из каталога CRC: "123456789" -> 0x059E
+static void testCrcCheckValue() {
+    const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    CHECK_EQ(CanFrameBits::crc15(check, 72), 0x059E);
+    CHECK_EQ(CanFrameBits::crc15(check, 0), 0);
+}
+
+// Кадр из одних доминантных бит, посчитанный вручную:
+// SOF + ID + RTR/IDE/r0 + DLC = 19 нулей, CRC от нулей - еще 15 нулей.
+// Серия из 34 нулей получает stuff-бит после каждого пятого: 6 бит
+static void testAllDominantFrame() {
+    CHECK_EQ(CanFrameBits::stuffBits(false, 0, false, 0, nullptr), 6);
+    CHECK_EQ(CanFrameBits::frameBits(false, 0, false, 0, nullptr), 34 + 6 + 13);
+    CHECK_EQ(CanFrameBits::nominalBits(false, false, 0), 47);
+
+    std::vector<uint8_t> stream = referenceStream(false, 0, false, 0, nullptr);
+    CHECK_EQ(stream.size(), 40);
+    for (size_t i = 0; i < stream.size(); i++) {
+        CHECK_EQ(stream[i], (i % 6 == 5) ? 1 : 0);
+    }
+}
+
+static void testNominalBits() {
+    CHECK_EQ(CanFrameBits::nominalBits(false, false, 8), 19 + 64 + 15 + 13);
+    CHECK_EQ(CanFrameBits::nominalBits(true, false, 8), 39 + 64 + 15 + 13);
+    CHECK_EQ(CanFrameBits::nominalBits(true, true, 8), 39 + 15 + 13);
+    CHECK_EQ(CanFrameBits::nominalBits(false, false, 15), CanFrameBits::nominalBits(false, false, 8));
+}
+
+// Табличный расчет против побитного эталона на случайных и крайних кадрах.
+// Заодно проверяется граница худшего случая стаффинга:
+// (g + 8n - 1) / 4, g = 34 для STD и 54 для EXT
+static void testAgainstReference() {
+    srand(12);
+    uint32_t mismatches = 0;
+    uint32_t over_bound = 0;
+
+    for (uint32_t i = 0; i < 200000; i++) {
+        bool is_extended = rand() & 1;
+        bool is_remote = (rand() % 5) == 0;
+        uint8_t dlc = rand() % 16;
+        uint32_t id = is_extended ? ((uint32_t)rand() * 65537U) & 0x1FFFFFFF : rand() & 0x7FF;
+        if (i % 7 == 0) {
+            id = 0;
+        } else if (i % 11 == 0) {
+            id = is_extended ? 0x1FFFFFFF : 0x7FF;
+        }
+
+        uint8_t data[8];
+        int pattern = rand() % 4;
+        for (int b = 0; b < 8; b++) {
+            data[b] = (pattern == 0) ? 0x00 : (pattern == 1) ? 0xFF : (pattern == 2) ? 0x0F : rand();
+        }
+
+        uint32_t bits = CanFrameBits::frameBits(is_extended, id, is_remote, dlc, data);
+        if (bits != referenceFrameBits(is_extended, id, is_remote, dlc, data)) {
+            if (mismatches++ < 5) {
+                printf("mismatch: ext %d id %lX rtr %d dlc %u: %lu\n", is_extended,
+                       (unsigned long)id, is_remote, dlc, (unsigned long)bits);
+            }
+        }
+
+        uint32_t n = is_remote ? 0 : ((dlc > 8) ? 8 : dlc);
+        uint32_t bound = ((is_extended ? 54 : 34) + 8 * n - 1) / 4;
+        if (CanFrameBits::stuffBits(is_extended, id, is_remote, dlc, data) > bound) {
+            over_bound++;
+        }
+        if (bits - CanFrameBits::stuffBits(is_extended, id, is_remote, dlc, data)
+            != CanFrameBits::nominalBits(is_extended, is_remote, dlc)) {
+            mismatches++;
+        }
+    }
+
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(over_bound, 0);
+}
+
+int main() {
+    testCrcCheckValue();
+    testAllDominantFrame();
+    testNominalBits();
+    testAgainstReference();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,171 @@
+/*
+ * test_filter_bank_planner.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "check.h"
+#include "FilterManager/FilterBankPlanner.h"
+#include <cstdlib>
+
+typedef FilterBankPlanner Planner;
+
+static constexpr uint32_t STD_MASK = Planner::STD_ID_MASK;
+static constexpr uint32_t EXT_MASK = Planner::EXT_ID_MASK;
+
+// Модель приема bxCAN (RM0090, "Filter bank scale and mode"): кадр
+// раскладывается в поля регистра фильтра и сравнивается с каждым банком
+static uint32_t frame32(uint32_t id, bool is_extended, bool is_remote) {
+    uint32_t value = is_extended ? ((id << 3) | 0x04) : (id << 21);
+    return value | (is_remote ? 0x02 : 0);
+}
+
+static uint32_t frame16(uint32_t id, bool is_extended, bool is_remote) {
+    uint32_t value = is_extended ? (((id >> 18) << 5) | 0x08 | ((id >> 15) & 0x7)) : (id << 5);
+    return value | (is_remote ? 0x10 : 0);
+}
+
+static bool match16(uint32_t value, uint32_t reg) {
+    return ((value ^ (reg & 0xFFFF)) & (reg >> 16)) == 0;
+}
+
+static bool accepts(const Planner::Plan& plan, uint32_t id, bool is_extended, bool is_remote) {
+    uint32_t v32 = frame32(id, is_extended, is_remote);
+    uint32_t v16 = frame16(id, is_extended, is_remote);
+
+    for (uint8_t b = 0; b < plan.bank_count; b++) {
+        const Planner::Bank& bank = plan.banks[b];
+        switch (bank.layout) {
+            case Planner::Layout::Mask32:
+                if (((v32 ^ bank.fr1) & bank.fr2) == 0) return true;
+                break;
+            case Planner::Layout::List32:
+                if (v32 == bank.fr1 || v32 == bank.fr2) return true;
+                break;
+            case Planner::Layout::Mask16:
+                if (match16(v16, bank.fr1) || match16(v16, bank.fr2)) return true;
+                break;
+            case Planner::Layout::List16:
+                if (v16 == (bank.fr1 & 0xFFFF) || v16 == (bank.fr1 >> 16)
+                    || v16 == (bank.fr2 & 0xFFFF) || v16 == (bank.fr2 >> 16)) return true;
+                break;
+        }
+    }
+    return false;
+}
+
+static bool wanted(const Planner::Request* requests, uint16_t count, uint32_t id, bool is_extended) {
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t full = requests[i].is_extended ? EXT_MASK : STD_MASK;
+        if (requests[i].is_extended == is_extended
+            && ((id ^ requests[i].id) & requests[i].mask & full) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Узкое пространство ID, чтобы поглощение и склейка случались часто
+static uint32_t randomId(bool is_extended) {
+    uint32_t id = rand() % 64;
+    return is_extended ? (id | ((rand() % 4) << 20)) : id;
+}
+
+static void testRandomAgainstModel() {
+    static Planner planner;
+    uint32_t mismatches = 0;
+    uint32_t plans = 0;
+
+    srand(1);
+    for (int round = 0; round < 5000; round++) {
+        Planner::Request requests[Planner::MAX_REQUESTS];
+        uint16_t count = 1 + rand() % 30;
+
+        for (uint16_t i = 0; i < count; i++) {
+            bool is_extended = (rand() % 3) == 0;
+            uint32_t full = is_extended ? EXT_MASK : STD_MASK;
+            uint32_t mask = (rand() % 2) ? full : (full & ~(uint32_t)(rand() % 8));
+            requests[i] = { randomId(is_extended), mask, is_extended };
+        }
+
+        if (!planner.build(requests, count)) continue;
+        plans++;
+
+        const Planner::Plan& plan = planner.getPlan();
+        CHECK(plan.bank_count <= Planner::MAX_BANKS);
+
+        for (int t = 0; t < 200; t++) {
+            bool is_extended = (rand() % 3) == 0;
+            uint32_t id = randomId(is_extended);
+            bool is_remote = rand() % 2;
+            if (wanted(requests, count, id, is_extended) != accepts(plan, id, is_extended, is_remote)) {
+                mismatches++;
+            }
+        }
+    }
+
+    CHECK(plans > 1000);
+    CHECK_EQ(mismatches, 0);
+}
+
+// Четное число единиц: любые два ID различаются хотя бы в двух битах
+// и не склеиваются в маску
+static uint32_t unmergeableId(uint16_t n) {
+    uint32_t id = 0;
+    while (true) {
+        if ((__builtin_popcount(id) & 1) == 0 && n-- == 0) return id;
+        id++;
+    }
+}
+
+// Точный STD ID занимает два слота (данные + RTR): 28 на 14 банков
+static void testExactStdCapacity() {
+    static Planner planner;
+    Planner::Request requests[Planner::MAX_REQUESTS];
+
+    CHECK_EQ(planner.getExactStdRoom(), 28);
+
+    for (uint16_t i = 0; i < 29; i++) {
+        requests[i] = { unmergeableId(i), STD_MASK, false };
+    }
+
+    CHECK(planner.build(requests, 27));
+    CHECK_EQ(planner.getExactStdRoom(), 1);
+    CHECK(planner.build(requests, 28));
+    CHECK_EQ(planner.getExactStdRoom(), 0);
+    CHECK_EQ(planner.getPlan().bank_count, 14);
+    CHECK(!planner.build(requests, 29));
+    CHECK_EQ(planner.getPlan().entry_count, 28);   // Прошлый план не тронут
+
+    const Planner::Plan& plan = planner.getPlan();
+    for (uint16_t i = 0; i < 28; i++) {
+        CHECK(accepts(plan, requests[i].id, false, false));
+        CHECK(accepts(plan, requests[i].id, false, true));
+        CHECK(plan.slot_of[i] == 0 || plan.slot_of[i] == 2);
+    }
+}
+
+// Свободный слот банка 16-bit mask отдается точному ID
+static void testSpareMaskSlot() {
+    static Planner planner;
+    Planner::Request requests[] = {
+        { 0x100, 0x700, false },
+        { 0x223, STD_MASK, false },
+    };
+
+    CHECK(planner.build(requests, 1));
+    CHECK_EQ(planner.getExactStdRoom(), 13 * 2 + 1);
+    CHECK(planner.build(requests, 2));
+    CHECK_EQ(planner.getPlan().bank_count, 1);
+    CHECK_EQ(planner.getExactStdRoom(), 13 * 2);
+    CHECK(accepts(planner.getPlan(), 0x223, false, true));
+    CHECK(!accepts(planner.getPlan(), 0x224, false, false));
+}
+
+int main() {
+    testRandomAgainstModel();
+    testExactStdCapacity();
+    testSpareMaskSlot();
+    return CHECK_RESULT();
+}
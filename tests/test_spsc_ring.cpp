@@ -0,0 +1,206 @@
+/*
+ * test_spsc_ring.cpp
+ *
+ *  Created on: 17 окт. 2026 г.
+ *      Author: Dmitry
+ */
+
+#include "check.h"
+#include "Queue/SpscRing.hpp"
+#include <chrono>
+#include <thread>
+
+typedef SpscRing<uint32_t, 8> Ring8;
+
+// Индекс слота многократно проходит через конец массива
+static void testWraparound() {
+    Ring8 ring;
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+
+    for (uint32_t round = 0; round < 100; round++) {
+        // Заполнение каждый раз разное, чтобы начало кольца смещалось
+        uint32_t fill = 1 + round % Ring8::CAPACITY;
+        for (uint32_t i = 0; i < fill; i++) {
+            CHECK(ring.push(next_in++));
+        }
+        CHECK_EQ(ring.size(), fill);
+        CHECK_EQ(ring.freeSpace(), Ring8::CAPACITY - fill);
+
+        uint32_t value;
+        while (ring.pop(value)) {
+            CHECK_EQ(value, next_out++);
+        }
+        CHECK(ring.isEmpty());
+    }
+
+    CHECK_EQ(next_out, next_in);
+    CHECK_EQ(ring.getOverflowCount(), 0);
+}
+
+// acquire/commit и peek/release работают со слотами на месте
+static void testInPlace() {
+    Ring8 ring;
+
+    for (uint32_t i = 0; i < 3 * Ring8::CAPACITY; i++) {
+        uint32_t* slot = ring.acquire();
+        CHECK(slot != nullptr);
+        *slot = i * 3;
+        ring.commit();
+
+        uint32_t* head = ring.peek();
+        CHECK(head != nullptr);
+        CHECK_EQ(*head, i * 3);
+        ring.release();
+        CHECK(ring.peek() == nullptr);
+    }
+}
+
+// Полное кольцо: новые элементы отбрасываются и считаются, старые целы
+static void testOverflow() {
+    Ring8 ring;
+
+    for (uint32_t i = 0; i < Ring8::CAPACITY; i++) {
+        CHECK(ring.push(i));
+    }
+    CHECK(ring.isFull());
+    CHECK_EQ(ring.freeSpace(), 0);
+
+    CHECK(!ring.push(100));
+    CHECK(ring.acquire() == nullptr);
+    CHECK_EQ(ring.getOverflowCount(), 2);
+    CHECK_EQ(ring.size(), Ring8::CAPACITY);
+
+    uint32_t value;
+    CHECK(ring.pop(value));
+    CHECK_EQ(value, 0);
+    CHECK(ring.push(8));
+
+    for (uint32_t i = 1; i <= Ring8::CAPACITY; i++) {
+        CHECK(ring.pop(value));
+        CHECK_EQ(value, i);
+    }
+    CHECK(!ring.pop(value));
+    CHECK_EQ(ring.getOverflowCount(), 2);
+}
+
+// Пакетная запись через конец массива и с частичным отбрасыванием
+static void testBatchWrite() {
+    Ring8 ring;
+    uint32_t items[12];
+    for (uint32_t i = 0; i < 12; i++) {
+        items[i] = 50 + i;
+    }
+
+    uint32_t value;
+    CHECK_EQ(ring.write(items, 5), 5);
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(ring.pop(value));
+    }
+
+    // Голова на слоте 5: запись из 6 элементов переходит через конец
+    CHECK_EQ(ring.write(items, 6), 6);
+    CHECK_EQ(ring.write(items + 6, 6), 2);
+    CHECK_EQ(ring.getOverflowCount(), 4);
+
+    for (uint32_t i = 0; i < 8; i++) {
+        CHECK(ring.pop(value));
+        CHECK_EQ(value, 50 + i);
+    }
+    CHECK(ring.isEmpty());
+}
+
+static void testFlush() {
+    Ring8 ring;
+    for (uint32_t i = 0; i < 5; i++) {
+        ring.push(i);
+    }
+
+    ring.flush();
+    CHECK(ring.isEmpty());
+    CHECK(ring.push(7));
+
+    uint32_t value;
+    CHECK(ring.pop(value));
+    CHECK_EQ(value, 7);
+}
+
+// Запись размером с CanMessage_t; каждое слово несет номер кадра,
+// перемешанный со своим номером слова - рваная запись видна по любому слову
+struct Frame {
+    static constexpr uint32_t WORDS = 12;
+    uint32_t words[WORDS];
+};
+
+static uint32_t frameWord(uint32_t seq, uint32_t word) {
+    return seq ^ (word * 0x9E3779B9u);
+}
+
+// Писатель - как прерывание приема: кадр на месте через acquire()/commit()
+// в темпе шины 1 Мбит/с (~16.7 тыс. кадров/с). Читатель - как superloop:
+// спит, потом разбирает все накопленное через peek()/release().
+// Полное кольцо - писатель ждет, чтобы пропуск номера был ошибкой.
+static void testConcurrent() {
+    static_assert(sizeof(Frame) >= 44, "record should be CanMessage_t-sized");
+    static SpscRing<Frame, 128> ring;
+    const uint32_t COUNT = 16000;
+    const auto FRAME_PERIOD = std::chrono::microseconds(60);
+    const auto CONSUMER_NAP = std::chrono::milliseconds(2);
+    uint32_t gaps = 0;
+    uint32_t torn = 0;
+    uint32_t bursts = 0;
+
+    std::thread consumer([&]() {
+        uint32_t expected = 0;
+        while (expected < COUNT) {
+            std::this_thread::sleep_for(CONSUMER_NAP);
+            bursts++;
+
+            while (Frame* frame = ring.peek()) {
+                uint32_t seq = frame->words[0];
+                for (uint32_t w = 1; w < Frame::WORDS; w++) {
+                    if (frame->words[w] != frameWord(seq, w)) {
+                        torn++;
+                        break;
+                    }
+                }
+                if (seq != expected) {
+                    gaps++;
+                }
+                expected = seq + 1;
+                ring.release();
+            }
+        }
+    });
+
+    auto deadline = std::chrono::steady_clock::now();
+    for (uint32_t seq = 0; seq < COUNT; seq++) {
+        deadline += FRAME_PERIOD;
+        std::this_thread::sleep_until(deadline);
+
+        Frame* frame;
+        while ((frame = ring.acquire()) == nullptr) {
+            std::this_thread::yield();
+        }
+        for (uint32_t w = 0; w < Frame::WORDS; w++) {
+            frame->words[w] = frameWord(seq, w);
+        }
+        ring.commit();
+    }
+    consumer.join();
+
+    CHECK_EQ(gaps, 0);
+    CHECK_EQ(torn, 0);
+    CHECK(bursts > 1);
+    CHECK(ring.isEmpty());
+}
+
+int main() {
+    testWraparound();
+    testInPlace();
+    testOverflow();
+    testBatchWrite();
+    testFlush();
+    testConcurrent();
+    return CHECK_RESULT();
+}